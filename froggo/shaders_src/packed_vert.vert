@@ -0,0 +1,45 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Same as simple_vert, but for meshes using the packed vertex layout
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inNormal;  // Octahedral encoding
+layout(location = 2) in vec2 inTangent; // Octahedral encoding
+layout(location = 3) in vec2 inTexCoord;
+
+// Per-instance data, advancing once per drawn object
+layout(location = 8) in mat4 inModel; // Takes locations 8-11
+layout(location = 12) in vec2 inUVScale;
+
+layout(location = 0) out vec3 outPosition;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec3 outColor;
+layout(location = 3) out vec2 outTexCoord;
+layout(location = 4) out vec3 outTangent;
+
+layout(set = 0, binding = 0) uniform GlobalUniformObject {
+  mat4 projection;
+  mat4 view;
+} gubo;
+
+vec3 octDecode(vec2 p) {
+  vec3 n = vec3(p.x, p.y, 1.0 - abs(p.x) - abs(p.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+void main() {
+  gl_Position = gubo.projection * gubo.view * inModel * vec4(inPosition, 1.0);
+
+  // Pass stuff to fragment
+  mat4 nMat = inverse(transpose(inModel));
+
+  outPosition = (inModel * vec4(inPosition, 1.0)).xyz;
+  outNormal = (nMat * vec4(octDecode(inNormal), 0.0)).xyz;
+  outColor = vec3(1.0);
+  outTexCoord = inTexCoord * inUVScale;
+  outTangent = (inModel * vec4(octDecode(inTangent), 0.0)).xyz;
+}
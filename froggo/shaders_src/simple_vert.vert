@@ -7,6 +7,10 @@ layout(location = 2) in vec3 inColor;
 layout(location = 3) in vec2 inTexCoord;
 layout(location = 4) in vec3 inTangent;
 
+// Per-instance data, advancing once per drawn object
+layout(location = 8) in mat4 inModel; // Takes locations 8-11
+layout(location = 12) in vec2 inUVScale;
+
 layout(location = 0) out vec3 outPosition;
 layout(location = 1) out vec3 outNormal;
 layout(location = 2) out vec3 outColor;
@@ -18,22 +22,15 @@ layout(set = 0, binding = 0) uniform GlobalUniformObject {
   mat4 view;
 } gubo;
 
-// Faster than using the uniform. Downside is we have only 128 bytes
-// in total (guaranteed by the vulkan spec)
-layout(push_constant) uniform push_constant {
-    mat4 model; // 64 bytes
-    vec2 uv_scale;
-} pushConstants;
-
 void main() {
-  gl_Position = gubo.projection * gubo.view * pushConstants.model * vec4(inPosition, 1.0);
+  gl_Position = gubo.projection * gubo.view * inModel * vec4(inPosition, 1.0);
 
   // Pass stuff to fragment
-  mat4 nMat = inverse(transpose(pushConstants.model));
+  mat4 nMat = inverse(transpose(inModel));
 
-  outPosition = (pushConstants.model * vec4(inPosition, 1.0)).xyz;
+  outPosition = (inModel * vec4(inPosition, 1.0)).xyz;
   outNormal = (nMat * vec4(inNormal, 0.0)).xyz;
   outColor = inColor;
-  outTexCoord = inTexCoord * pushConstants.uv_scale;
-  outTangent = (pushConstants.model * vec4(inTangent, 0.0)).xyz;
+  outTexCoord = inTexCoord * inUVScale;
+  outTangent = (inModel * vec4(inTangent, 0.0)).xyz;
 }
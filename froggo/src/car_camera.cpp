@@ -8,6 +8,7 @@
 #include <seng/components/transform.hpp>
 #include <seng/math.hpp>
 #include <seng/scene/entity.hpp>
+#include <seng/scene/scene.hpp>
 
 #include <yaml-cpp/yaml.h>
 #include <glm/trigonometric.hpp>
@@ -26,7 +27,7 @@ DEFINE_CREATE_FROM_CONFIG(CarCamera, entity, node)
   if (node["enabled"]) enabled = node["enabled"].as<bool>();
   lookat = node["lookat_entity"].as<std::string>();
   controller = node["controller_entity"].as<std::string>();
-  return std::make_unique<CarCamera>(entity, lookat, controller, enabled);
+  return seng::makeComponent<CarCamera>(entity, lookat, controller, enabled);
 }
 
 CarCamera::CarCamera(seng::Entity &entity,
@@ -57,6 +58,15 @@ CarCamera::CarCamera(seng::Entity &entity,
   m_cacheFov = m_cam->fov();
 }
 
+bool CarCamera::declareAccess(seng::ScriptAccess &access) const
+{
+  access.writes(entity->transform())
+      .writes(m_cam)
+      .reads(m_lookat)
+      .reads(m_controller);
+  return true;
+}
+
 void CarCamera::onUpdate(float delta)
 {
   entity->transform()->lookAt(*m_lookat);
@@ -24,6 +24,7 @@ class CarCamera : public seng::ScriptComponent,
   DECLARE_CREATE_FROM_CONFIG();
 
   void onUpdate(float deltaTime) override;
+  bool declareAccess(seng::ScriptAccess &access) const override;
 
  private:
   seng::Transform *m_lookat;
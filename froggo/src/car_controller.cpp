@@ -7,6 +7,7 @@
 #include <seng/input_manager.hpp>
 #include <seng/math.hpp>
 #include <seng/scene/entity.hpp>
+#include <seng/scene/scene.hpp>
 
 #include <yaml-cpp/yaml.h>
 #include <glm/exponential.hpp>
@@ -50,9 +51,9 @@ DEFINE_CREATE_FROM_CONFIG(CarController, entity, node)
   if (node["max_wheel_yaw_deg"])
     maxYaw = glm::radians(node["max_wheel_yaw_deg"].as<float>());
 
-  return std::make_unique<CarController>(entity, model, body, wheelL, wheelR, accel,
-                                         breaking, decel, turn, maxSpeed, maxPitch,
-                                         maxRoll, maxYaw, enabled);
+  return seng::makeComponent<CarController>(entity, model, body, wheelL, wheelR, accel,
+                                            breaking, decel, turn, maxSpeed, maxPitch,
+                                            maxRoll, maxYaw, enabled);
 }
 
 CarController::CarController(seng::Entity &entity,
@@ -110,6 +111,16 @@ void CarController::lateInit()
   m_wheelRight = it->transform();
 }
 
+bool CarController::declareAccess(seng::ScriptAccess &access) const
+{
+  access.writes(entity->transform())
+      .writes(m_model)
+      .writes(m_body)
+      .writes(m_wheelLeft)
+      .writes(m_wheelRight);
+  return true;
+}
+
 float CarController::speed() const
 {
   return glm::length(m_velocity);
@@ -279,6 +290,14 @@ class Gizmo : public seng::ScriptComponent, public seng::ConfigParsableComponent
   Gizmo &operator=(const Gizmo &) = delete;
   Gizmo &operator=(Gizmo &&) = delete;
 
+  bool declareAccess(seng::ScriptAccess &access) const override
+  {
+    access.writes(entity->transform())
+        .reads(carTransform)
+        .reads(car);
+    return true;
+  }
+
   void onUpdate([[maybe_unused]] float delta) override
   {
     entity->transform()->position(carTransform->position() +
@@ -308,5 +327,5 @@ REGISTER_TO_CONFIG_FACTORY(Gizmo);
 DEFINE_CREATE_FROM_CONFIG(Gizmo, e, node)
 {
   std::string c = node["car_entity"].as<std::string>();
-  return std::make_unique<Gizmo>(e, c);
+  return seng::makeComponent<Gizmo>(e, c);
 }
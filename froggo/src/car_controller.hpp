@@ -41,6 +41,7 @@ class CarController : public seng::ScriptComponent,
 
   void lateInit() override;
   void onUpdate(float deltaTime) override;
+  bool declareAccess(seng::ScriptAccess &access) const override;
 
   float speed() const;
   float maxSpeed() const { return m_maxSpeed; }
@@ -9,6 +9,7 @@
 #include <seng/components/script.hpp>
 #include <seng/components/transform.hpp>
 #include <seng/input_manager.hpp>
+#include <seng/scene/scene.hpp>
 
 #include <yaml-cpp/yaml.h>
 
@@ -54,7 +55,7 @@ DEFINE_CREATE_FROM_CONFIG(ControlSwitcher, entity, node)
   controller = node["controller_entity"].as<std::string>();
   if (node["enabled"]) enabled = node["enabled"].as<bool>();
 
-  return std::make_unique<ControlSwitcher>(entity, controller, camera, enabled);
+  return seng::makeComponent<ControlSwitcher>(entity, controller, camera, enabled);
 }
 
 ControlSwitcher::ControlSwitcher(seng::Entity &entity,
@@ -21,6 +21,9 @@ int main(int, char* argv[])
   config.shaderPath = (dir / "shaders").string();
   config.assetPath = (dir / "assets").string();
   config.scenePath = (dir / "scenes").string();
+  config.meshCachePath = (dir / "cache" / "meshes").string();
+  config.packVertices = true;
+  config.meshLodLevels = 3;
 
   // Color: #abf6fc
   config.clearColorRed = 0.617;
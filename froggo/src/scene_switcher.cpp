@@ -4,6 +4,7 @@
 #include <seng/components/script.hpp>
 #include <seng/components/transform.hpp>
 #include <seng/input_manager.hpp>
+#include <seng/scene/scene.hpp>
 
 #include <yaml-cpp/yaml.h>
 
@@ -37,7 +38,7 @@ DEFINE_CREATE_FROM_CONFIG(SceneSwitcher, entity, node)
   bool enabled = true;
 
   if (node["enabled"]) enabled = node["enabled"].as<bool>();
-  return std::make_unique<SceneSwitcher>(entity, enabled);
+  return seng::makeComponent<SceneSwitcher>(entity, enabled);
 }
 
 SceneSwitcher::SceneSwitcher(seng::Entity &e, bool enabled) : ScriptComponent(e, enabled)
@@ -0,0 +1,138 @@
+#include <seng/math.hpp>
+#include <seng/scene/aabb_tree.hpp>
+#include <seng/scene/frustum.hpp>
+
+#include "bench.hpp"
+
+#include <fmt/core.h>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/geometric.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/trigonometric.hpp>
+#include <glm/vec3.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace seng;
+using namespace seng::bench;
+
+// Queries of each kind run on every tree
+static constexpr size_t QUERIES = 10'000;
+static constexpr size_t FRUSTUMS = 100;
+
+// Run the box, sphere, frustum and ray queries on the given tree
+static void timeQueries(const string &label,
+                        const AabbTree &tree,
+                        float side,
+                        mt19937 &rng)
+{
+  uniform_real_distribution<float> pos(0.0f, side), dir(-1.0f, 1.0f);
+  vector<glm::vec3> points(QUERIES), directions(QUERIES);
+  for (size_t i = 0; i < QUERIES; i++) {
+    points[i] = glm::vec3(pos(rng), pos(rng), pos(rng));
+    directions[i] = glm::normalize(glm::vec3(dir(rng), dir(rng), dir(rng)) + 1e-3f);
+  }
+  glm::mat4 projection =
+      glm::perspectiveLH_ZO(glm::radians(60.0f), 16.0f / 9, 0.1f, 50.0f);
+  vector<Frustum> frustums(FRUSTUMS);
+  for (size_t i = 0; i < FRUSTUMS; i++)
+    frustums[i] = Frustum::fromMatrix(
+        projection * glm::lookAtLH(points[i], points[i] + directions[i],
+                                   glm::vec3(0.0f, 1.0f, 0.0f)));
+
+  vector<Entity *> out;
+  size_t found = 0;
+  auto collect = [&]() {
+    found += out.size();
+    out.clear();
+  };
+  report(fmt::format("{}: box queries", label), best(3, [&]() {
+           for (auto p : points) {
+             tree.query(Aabb{p - 2.0f, p + 2.0f}, out);
+             collect();
+           }
+         }),
+         QUERIES);
+  report(fmt::format("{}: sphere queries", label), best(3, [&]() {
+           for (auto p : points) {
+             tree.query(p, 2.0f, out);
+             collect();
+           }
+         }),
+         QUERIES);
+  report(fmt::format("{}: frustum queries", label), best(3, [&]() {
+           for (const auto &f : frustums) {
+             tree.query(f, out);
+             collect();
+           }
+         }),
+         FRUSTUMS);
+  report(fmt::format("{}: raycasts", label), best(3, [&]() {
+           AabbTree::RayHit hit;
+           for (size_t i = 0; i < QUERIES; i++)
+             found += tree.raycast(points[i], directions[i], 50.0f, hit);
+         }),
+         QUERIES);
+  fmt::print("checksum {}\n", found);
+}
+
+void bench::aabbSuite(const Args &args)
+{
+  size_t largest = numberArg(args, 0, 1'000'000);
+
+  for (size_t n : {size_t{10'000}, size_t{100'000}, largest}) {
+    if (n > largest) continue;
+
+    // Boxes from half a unit to two per side, about one every 64 cubic units
+    // whatever their number
+    mt19937 rng(42);
+    float side = 4.0f * cbrt(static_cast<float>(n));
+    uniform_real_distribution<float> pos(0.0f, side), size(0.25f, 1.0f);
+    vector<Aabb> boxes(n);
+    for (auto &b : boxes) {
+      glm::vec3 center(pos(rng), pos(rng), pos(rng));
+      glm::vec3 extent(size(rng), size(rng), size(rng));
+      b = Aabb{center - extent, center + extent};
+    }
+    fmt::print("{} boxes in a cube of side {:.0f}\n", n, side);
+
+    AabbTree tree;
+    vector<int32_t> proxies(n);
+    double inserted = best(1, [&]() {
+      tree.clear();
+      for (size_t i = 0; i < n; i++) proxies[i] = tree.insert(boxes[i], nullptr);
+    });
+    report(fmt::format("{}: incremental build", n), inserted, n);
+    fmt::print("height {}\n", tree.height());
+    timeQueries(fmt::format("{}: incremental", n), tree, side, rng);
+
+    double rebuilt = best(3, [&]() { tree.rebuild(); });
+    report(fmt::format("{}: rebuild", n), rebuilt, n);
+    fmt::print("height {}\n", tree.height());
+    timeQueries(fmt::format("{}: rebuilt", n), tree, side, rng);
+
+    // Small moves stay in the fat boxes, large ones reinsert every box. Every
+    // round moves the boxes back and forth, so that they stay in place.
+    for (float offset : {AabbTree::DEFAULT_MARGIN / 2, 4.0f}) {
+      float sign = 1.0f;
+      size_t reinserted = 0;
+      double moved = best(2, [&]() {
+        glm::vec3 delta(offset * sign);
+        reinserted = 0;
+        for (size_t i = 0; i < n; i++) {
+          boxes[i] = Aabb{boxes[i].min + delta, boxes[i].max + delta};
+          reinserted += tree.move(proxies[i], boxes[i]);
+        }
+        sign = -sign;
+      });
+      report(fmt::format("{}: move by {}", n, offset), moved, n);
+      fmt::print("{} boxes reinserted\n", reinserted);
+    }
+  }
+}
@@ -0,0 +1,112 @@
+#include <seng/application.hpp>
+#include <seng/log.hpp>
+
+#include "bench.hpp"
+
+#include <fmt/core.h>
+
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace seng;
+namespace fs = std::filesystem;
+
+struct Suite {
+  const char *name;
+  void (*run)(const bench::Args &);
+};
+
+static const Suite SUITES[] = {
+    {"aabb", bench::aabbSuite},
+    {"hook", bench::hookSuite},
+    {"jobs", bench::jobsSuite},
+    {"mesh", bench::meshSuite},
+    {"scene", bench::sceneSuite},
+    {"trs", bench::trsSuite},
+};
+
+void bench::report(const std::string &label, double seconds, size_t items)
+{
+  if (items == 0)
+    fmt::print("{:<48} {:>12.3f} ms\n", label, seconds * 1e3);
+  else
+    fmt::print("{:<48} {:>12.3f} ms {:>12.2f} ns/item\n", label, seconds * 1e3,
+               seconds * 1e9 / items);
+}
+
+size_t bench::numberArg(const Args &args, size_t index, size_t fallback)
+{
+  if (index >= args.size()) return fallback;
+  return stoul(args[index]);
+}
+
+fs::path bench::scratchDir(const std::string &suite)
+{
+  fs::path dir = fs::temp_directory_path() / ("seng-bench-" + suite);
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  return dir;
+}
+
+void bench::withApplication(ApplicationConfig config,
+                            const std::function<void(Application &)> &f)
+{
+  fs::path defaultScene = fs::path{config.scenePath} / "default.yml";
+  if (!fs::exists(defaultScene)) {
+    fs::create_directories(config.scenePath);
+    ofstream(defaultScene) << "Entities: []\n";
+  }
+
+  Application app(std::move(config));
+  bool called = false;
+  exception_ptr error;
+
+  // Progress of the first scene is reported on the main thread, once the
+  // renderer is up
+  app.onSceneLoadProgress().insert([&](const std::string &, float) {
+    if (called) return;
+    called = true;
+    try {
+      f(app);
+    } catch (...) {
+      error = current_exception();
+    }
+    app.stop();
+  });
+  app.run(640, 480);
+  if (error) rethrow_exception(error);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *env = std::getenv("SENG_VERBOSE");
+  if (env == nullptr) seng::log::minimumLoggingLevel(seng::log::LogLevels::WARN);
+
+  bench::Args args(argv + min(argc, 2), argv + argc);
+  bool found = false;
+  for (const auto &suite : SUITES) {
+    if (argc >= 2 && argv[1] != string(suite.name)) continue;
+    found = true;
+    fmt::print("== {}\n", suite.name);
+    try {
+      suite.run(args);
+    } catch (const exception &e) {
+      seng::log::error("Suite {} failed: {}", suite.name, e.what());
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!found) {
+    seng::log::error("Usage: {} [<suite> [<args>...]]", argv[0]);
+    for (const auto &suite : SUITES) seng::log::error("  suite: {}", suite.name);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <seng/application_config.hpp>
+#include <seng/time.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace seng {
+class Application;
+}
+
+/**
+ * Benchmarks of the engine's subsystems, grouped in suites that can be run by
+ * name with `seng-bench <suite> [<args>...]` (or all of them, without
+ * arguments). Results are printed to stdout, one line per measurement.
+ *
+ * Suites that need the engine's objects (e.g. scenes) start an Application, so
+ * they need a display and a Vulkan device just like any other application.
+ */
+namespace seng::bench {
+
+/// Arguments given to a suite, after its name
+using Args = std::vector<std::string>;
+
+/**
+ * Call `f` `repetitions` times and return the duration of the fastest call, in
+ * seconds.
+ */
+template <typename F>
+double best(size_t repetitions, F &&f)
+{
+  double ret = std::numeric_limits<double>::max();
+  for (size_t i = 0; i < repetitions; i++) {
+    Timestamp start = Clock::now();
+    f();
+    ret = std::min(ret, static_cast<double>(inSeconds(Clock::now() - start)));
+  }
+  return ret;
+}
+
+/**
+ * Print a measurement. If `items` is not zero, the time per item is printed as
+ * well.
+ */
+void report(const std::string &label, double seconds, size_t items = 0);
+
+/// Return the value of the argument at `index` as a number, or `fallback`
+size_t numberArg(const Args &args, size_t index, size_t fallback);
+
+/// Return an empty directory for the given suite, inside the temporary directory
+std::filesystem::path scratchDir(const std::string &suite);
+
+/**
+ * Start an Application with the given configuration and call `f` on its main
+ * thread once the renderer is up, then stop it. An empty `default` scene is
+ * created in the configured scene path if there isn't one.
+ *
+ * Exceptions thrown by `f` are rethrown once the application has stopped.
+ */
+void withApplication(ApplicationConfig config,
+                     const std::function<void(Application &)> &f);
+
+// Suites
+void aabbSuite(const Args &args);
+void hookSuite(const Args &args);
+void jobsSuite(const Args &args);
+void meshSuite(const Args &args);
+void sceneSuite(const Args &args);
+void trsSuite(const Args &args);
+
+}  // namespace seng::bench
@@ -0,0 +1,104 @@
+#include <seng/hook.hpp>
+
+#include "bench.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace seng;
+
+// Storage of the hooks before the slot map, where each dispatch iterated over a
+// copy of all the callbacks
+class MapHook {
+ public:
+  uint64_t insert(function<void(float)> f)
+  {
+    m_callbacks.emplace(m_next, std::move(f));
+    return m_next++;
+  }
+
+  void remove(uint64_t id) { m_callbacks.erase(id); }
+
+  void operator()(float arg) const
+  {
+    const unordered_map<uint64_t, function<void(float)>> copy = m_callbacks;
+    for (const auto &cb : copy) cb.second(arg);
+  }
+
+ private:
+  uint64_t m_next = 0;
+  unordered_map<uint64_t, function<void(float)>> m_callbacks;
+};
+
+void bench::hookSuite(const Args &args)
+{
+  size_t count = numberArg(args, 0, 10'000);
+  size_t dispatches = numberArg(args, 1, 1'000);
+  fmt::print("{} callbacks, {} dispatches\n", count, dispatches);
+
+  // Every callback touches memory, so that the calls can't be optimized away
+  vector<float> sums(count, 0.0f);
+
+  Hook<float> hook;
+  vector<HookToken<float>> tokens;
+  tokens.reserve(count);
+  report("Hook: insert", best(1, [&]() {
+           for (size_t i = 0; i < count; i++)
+             tokens.push_back(
+                 hook.registrar().insert([&sums, i](float dt) { sums[i] += dt; }));
+         }),
+         count);
+  double dispatch = best(5, [&]() {
+    for (size_t i = 0; i < dispatches; i++) hook(1.0f);
+  });
+  report("Hook: dispatch", dispatch / dispatches, count);
+
+  // One callback replacing a tenth of the others on every dispatch, as scripts
+  // enabling and disabling themselves do
+  size_t churn = max<size_t>(count / 10, 1), round = 0;
+  auto churner = hook.registrar().insert([&](float) {
+    size_t first = (round++ * churn) % count;
+    for (size_t j = first; j < first + churn && j < count; j++) {
+      hook.registrar().remove(tokens[j]);
+      tokens[j] = hook.registrar().insert([&sums, j](float dt) { sums[j] += dt; });
+    }
+  });
+  dispatch = best(5, [&]() {
+    for (size_t i = 0; i < dispatches; i++) hook(1.0f);
+  });
+  report("Hook: dispatch, 10% replaced", dispatch / dispatches, count);
+  hook.registrar().remove(churner);
+
+  report("Hook: remove", best(1, [&]() {
+           for (auto &t : tokens) hook.registrar().remove(t);
+         }),
+         count);
+
+  MapHook map;
+  vector<uint64_t> ids;
+  ids.reserve(count);
+  report("Map (old hook): insert", best(1, [&]() {
+           for (size_t i = 0; i < count; i++)
+             ids.push_back(map.insert([&sums, i](float dt) { sums[i] += dt; }));
+         }),
+         count);
+  dispatch = best(5, [&]() {
+    for (size_t i = 0; i < dispatches; i++) map(1.0f);
+  });
+  report("Map (old hook): dispatch", dispatch / dispatches, count);
+  report("Map (old hook): remove", best(1, [&]() {
+           for (auto id : ids) map.remove(id);
+         }),
+         count);
+
+  float total = 0.0f;
+  for (float s : sums) total += s;
+  fmt::print("checksum {}\n", total);
+}
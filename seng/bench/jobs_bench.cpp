@@ -0,0 +1,62 @@
+#include <seng/jobs/job_system.hpp>
+
+#include "bench.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace seng;
+using namespace seng::bench;
+
+// Some floating point work for the elements in [begin, end)
+static void crunch(vector<float> &data, size_t begin, size_t end)
+{
+  for (size_t i = begin; i < end; i++) {
+    float x = data[i];
+    for (int k = 0; k < 16; k++) x = sqrt(x * x + 1.0f) * 0.999f;
+    data[i] = x;
+  }
+}
+
+void bench::jobsSuite(const Args &args)
+{
+  size_t maxThreads = numberArg(args, 0, max(thread::hardware_concurrency(), 1u));
+  size_t elements = numberArg(args, 1, 4'000'000);
+  size_t tinyJobs = 100'000;
+  fmt::print("parallelFor over {} elements, {} empty jobs\n", elements, tinyJobs);
+
+  vector<float> data(elements, 1.0f);
+  double serial = best(3, [&]() { crunch(data, 0, elements); });
+  report("1 thread: serial loop", serial, elements);
+
+  // The main thread takes part in the work too, so there is one thread more
+  // than there are workers
+  for (size_t threads = 2; threads <= maxThreads; threads++) {
+    jobs::JobSystem jobs(static_cast<unsigned int>(threads - 1));
+    size_t grain = max<size_t>(1, elements / (4 * threads));
+
+    double loop = best(3, [&]() {
+      jobs.parallelFor(0, elements, grain,
+                       [&](size_t begin, size_t end) { crunch(data, begin, end); });
+    });
+    report(fmt::format("{} threads: parallelFor", threads), loop, elements);
+    fmt::print("speedup {:.2f}x, efficiency {:.0f}%\n", serial / loop,
+               100.0 * serial / loop / threads);
+
+    atomic<size_t> ran = 0;
+    double tiny = best(3, [&]() {
+      jobs::Counter counter;
+      for (size_t i = 0; i < tinyJobs; i++)
+        jobs.run([&ran]() { ran.fetch_add(1, memory_order_relaxed); }, &counter);
+      jobs.wait(counter);
+    });
+    report(fmt::format("{} threads: empty jobs", threads), tiny, tinyJobs);
+  }
+}
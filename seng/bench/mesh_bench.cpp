@@ -0,0 +1,83 @@
+#include <seng/application.hpp>
+#include <seng/resources/mesh.hpp>
+
+#include "bench.hpp"
+
+#include <fmt/core.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace seng;
+using namespace seng::bench;
+namespace fs = std::filesystem;
+
+// Write a wavy grid with `side` quads per side, with normals and UVs
+static void writeGrid(const fs::path &path, size_t side)
+{
+  ofstream out(path);
+  for (size_t z = 0; z <= side; z++) {
+    for (size_t x = 0; x <= side; x++) {
+      out << fmt::format("v {} {} {}\n", x * 0.1f, (x * z % 7) * 0.01f, z * 0.1f);
+      out << fmt::format("vt {} {}\n", float(x) / side, float(z) / side);
+      out << "vn 0 1 0\n";
+    }
+  }
+  for (size_t z = 0; z < side; z++) {
+    for (size_t x = 0; x < side; x++) {
+      size_t a = z * (side + 1) + x + 1, b = a + 1, c = a + side + 1, d = c + 1;
+      out << fmt::format("f {0}/{0}/{0} {1}/{1}/{1} {2}/{2}/{2}\n", a, c, b);
+      out << fmt::format("f {0}/{0}/{0} {1}/{1}/{1} {2}/{2}/{2}\n", b, c, d);
+    }
+  }
+}
+
+void bench::meshSuite(const Args &args)
+{
+  fs::path dir = scratchDir("mesh");
+  fs::path cache = dir / "cache";
+
+  // The given models, or a grid of about 180k triangles
+  vector<fs::path> models;
+  for (const auto &a : args) models.push_back(fs::absolute(a));
+  if (models.empty()) {
+    models.push_back(dir / "grid.obj");
+    writeGrid(models.back(), 300);
+  }
+
+  ApplicationConfig config;
+  config.appName = "seng-bench";
+  config.scenePath = (dir / "scenes").string();
+  withApplication(config, [&](Application &app) {
+    MeshLoadOptions opts = MeshLoadOptions::fromConfig(app);
+    for (const auto &model : models) {
+      string asset = model.parent_path().string(), name = model.filename().string();
+      size_t triangles = 0;
+      auto load = [&](const string &cachePath) {
+        opts.cachePath = cachePath;
+        Mesh mesh = Mesh::loadFromDisk(*app.renderer(), asset, name, opts);
+        if (mesh.vertices().empty()) throw runtime_error("unable to load " + name);
+        triangles = mesh.lods()[0].indexCount / 3;
+      };
+
+      // Cold loads parse the model and write the cache, warm ones only read it
+      double uncached = best(3, [&]() { load(""); });
+      double cold = best(3, [&]() {
+        fs::remove_all(cache);
+        load(cache.string());
+      });
+      double warm = best(3, [&]() { load(cache.string()); });
+
+      fmt::print("{}: {} triangles\n", name, triangles);
+      report(fmt::format("{}: no cache", name), uncached, triangles);
+      report(fmt::format("{}: cold cache", name), cold, triangles);
+      report(fmt::format("{}: warm cache", name), warm, triangles);
+      fmt::print("warm cache speedup {:.2f}x\n", uncached / warm);
+    }
+  });
+}
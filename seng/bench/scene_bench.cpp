@@ -0,0 +1,143 @@
+#include <seng/application.hpp>
+#include <seng/log.hpp>
+#include <seng/scene/compiled_scene.hpp>
+#include <seng/scene/entity.hpp>
+#include <seng/scene/scene.hpp>
+
+#include "bench.hpp"
+
+#include <fmt/core.h>
+#include <yaml-cpp/yaml.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace seng;
+using namespace seng::bench;
+namespace fs = std::filesystem;
+
+// Name of the i-th entity of the synthetic scene. One in ten shares its name
+// with the others like it, the rest have unique ones.
+static string entityName(size_t i)
+{
+  return i % 10 == 9 ? "lamp" : fmt::format("entity_{}", i);
+}
+
+// Write a scene with `count` entities with only a transform. Entities are laid
+// out in a grid, in groups of a root and three children parented by name.
+static void writeSyntheticScene(const fs::path &path, size_t count)
+{
+  ofstream out(path);
+  out << "Light:\n  ambient: [0.8, 0.8, 1.0, 0.2]\n\nEntities:\n";
+  for (size_t i = 0; i < count; i++) {
+    out << fmt::format("  - name: {}\n    transform:\n", entityName(i));
+    size_t group = i / 4;
+    if (i % 4 == 0) {
+      out << fmt::format("      position: [{}, 0, {}]\n", group % 256 * 4,
+                         group / 256 * 4);
+    } else {
+      // Roots never have a shared name, so that children find the right one
+      out << fmt::format("      position: [{}, 1, 0]\n      parent: entity_{}\n", i % 4,
+                         group * 4);
+    }
+    out << fmt::format("      rotation_deg: [0, {}, 0]\n", i % 360);
+  }
+}
+
+// Compile the scene YAML at `source` into `output`, as seng-scenec does
+static void compile(const fs::path &source, const fs::path &output)
+{
+  double seconds = best(1, [&]() {
+    YAML::Node scene = YAML::LoadFile(source.string());
+    ofstream out(output, ios::binary | ios::trunc);
+    compileScene(scene, out);
+    if (!out) throw runtime_error("unable to write " + output.string());
+  });
+  report(fmt::format("{}: compile", source.stem().string()), seconds);
+}
+
+// Load the given scene `repetitions` times and return the fastest load, in
+// seconds. Warnings (e.g. about components seng-bench does not know) are
+// silenced, so that they are not timed.
+static double timeLoad(Application &app,
+                       const string &name,
+                       size_t repetitions,
+                       unique_ptr<Scene> &scene)
+{
+  auto level = log::minimumLoggingLevel();
+  log::minimumLoggingLevel(log::LogLevels::ERRO);
+  double seconds = best(repetitions, [&]() {
+    scene = nullptr;
+    scene = Scene::loadFromDisk(app, name);
+  });
+  log::minimumLoggingLevel(level);
+  if (scene == nullptr) throw runtime_error("unable to load scene " + name);
+  return seconds;
+}
+
+void bench::sceneSuite(const Args &args)
+{
+  size_t count = numberArg(args, 0, 100'000);
+  fs::path dir = scratchDir("scene");
+  writeSyntheticScene(dir / "synthetic.yml", count);
+  fmt::print("Synthetic scene with {} entities\n", count);
+
+  // The synthetic scene and the given ones are loaded both from YAML and
+  // compiled. Compiled scenes have no YAML next to them, so they are always
+  // picked.
+  vector<string> scenes{"synthetic"};
+  for (size_t i = 1; i < args.size(); i++) {
+    fs::path source{args[i]};
+    scenes.push_back(source.stem().string());
+    fs::copy_file(source, dir / (scenes.back() + ".yml"),
+                  fs::copy_options::overwrite_existing);
+  }
+  for (const auto &name : scenes)
+    compile(dir / (name + ".yml"), dir / (name + "-compiled.sscene"));
+
+  ApplicationConfig config;
+  config.appName = "seng-bench";
+  config.scenePath = dir.string();
+  withApplication(config, [&](Application &app) {
+    unique_ptr<Scene> scene;
+    for (const auto &name : scenes) {
+      double compiled = timeLoad(app, name + "-compiled", 3, scene);
+      double yaml = timeLoad(app, name, 3, scene);
+      size_t entities = scene->entities().size();
+      report(fmt::format("{}: YAML load", name), yaml, entities);
+      report(fmt::format("{}: compiled load", name), compiled, entities);
+      fmt::print("speedup {:.2f}x\n", yaml / compiled);
+    }
+
+    // Lookups on the synthetic scene, loaded from YAML
+    timeLoad(app, "synthetic", 1, scene);
+    vector<string> names, distinct{"lamp"};
+    names.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      names.push_back(entityName(i));
+      if (i % 10 != 9) distinct.push_back(names.back());
+    }
+
+    size_t found = 0;
+    report("findByName", best(3, [&]() {
+             for (const auto &n : names)
+               found += scene->findByName(n) != scene->entities().end();
+           }),
+           count);
+    report("findAllByName", best(3, [&]() {
+             for (const auto &n : distinct) found += scene->findAllByName(n).size();
+           }),
+           distinct.size());
+    report("removeEntity by name", best(1, [&]() {
+             for (const auto &n : names) scene->removeEntity(n);
+           }),
+           count);
+    fmt::print("checksum {}\n", found);
+  });
+}
@@ -0,0 +1,69 @@
+#include <seng/scene/trs_kernel.hpp>
+
+#include "bench.hpp"
+
+#include <fmt/core.h>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace seng;
+using namespace seng::bench;
+
+void bench::trsSuite(const Args &args)
+{
+  size_t largest = numberArg(args, 0, 100'000);
+  fmt::print("Kernel: {}\n", trsKernelName());
+
+  // Same values for every size, the smaller batches are prefixes
+  mt19937 rng(42);
+  uniform_real_distribution<float> pos(-100.0f, 100.0f), rot(-1.0f, 1.0f),
+      scale(0.1f, 10.0f);
+  vector<float> soa(10 * largest);
+  float *p = soa.data();
+  for (size_t i = 0; i < largest; i++) {
+    for (size_t c = 0; c < 3; c++) p[c * largest + i] = pos(rng);
+    for (size_t c = 3; c < 7; c++) p[c * largest + i] = rot(rng);
+    for (size_t c = 7; c < 10; c++) p[c * largest + i] = scale(rng);
+  }
+
+  vector<glm::mat4> kernel(largest), reference(largest);
+  for (size_t n : {size_t{1'000}, size_t{10'000}, largest}) {
+    if (n > largest) continue;
+    size_t L = largest;
+    TRSBatch batch{n,         p,         p + L,     p + 2 * L, p + 3 * L, p + 4 * L,
+                   p + 5 * L, p + 6 * L, p + 7 * L, p + 8 * L, p + 9 * L};
+
+    // Enough repetitions for the smaller batches to take a measurable time
+    size_t reps = max<size_t>(5, 1'000'000 / n);
+    double glmTime = best(reps, [&]() {
+      for (size_t i = 0; i < n; i++) {
+        glm::vec3 t(batch.px[i], batch.py[i], batch.pz[i]);
+        glm::quat q(batch.qw[i], batch.qx[i], batch.qy[i], batch.qz[i]);
+        glm::vec3 s(batch.sx[i], batch.sy[i], batch.sz[i]);
+        reference[i] = glm::translate(glm::mat4(1.0f), t) *
+                       glm::toMat4(glm::normalize(q)) * glm::scale(glm::mat4(1.0f), s);
+      }
+    });
+    double kernelTime = best(reps, [&]() { composeTRS(batch, kernel.data()); });
+
+    float error = 0.0f;
+    for (size_t i = 0; i < n; i++)
+      for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++)
+          error = max(error, abs(kernel[i][c][r] - reference[i][c][r]));
+
+    report(fmt::format("glm, {} transforms", n), glmTime, n);
+    report(fmt::format("{}, {} transforms", trsKernelName(), n), kernelTime, n);
+    fmt::print("speedup {:.2f}x, max difference {:g}\n", glmTime / kernelTime, error);
+  }
+}
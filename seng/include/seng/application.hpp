@@ -2,18 +2,26 @@
 
 #include <optional>
 #include <seng/application_config.hpp>
+#include <seng/hook.hpp>
 #include <seng/time.hpp>
 
+#include <cstddef>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace seng {
 
 namespace rendering {
 class GlfwWindow;
 class Renderer;
-class FrameHandle;
 }  // namespace rendering
 
+namespace jobs {
+class JobSystem;
+}  // namespace jobs
+
 class Scene;
 
 class InputManager;
@@ -38,11 +46,15 @@ class Application {
 
   // Accessors
   const ApplicationConfig &config() const { return conf; }
+  const std::unique_ptr<jobs::JobSystem> &jobs() const { return m_jobs; }
   const std::unique_ptr<rendering::Renderer> &renderer() const { return m_vulkan; }
   const std::unique_ptr<rendering::GlfwWindow> &window() const { return m_glfwWindow; }
   const std::unique_ptr<Scene> &currentScene() const { return m_scene; }
   const std::unique_ptr<InputManager> &input() const { return m_inputManager; }
 
+  /// Return true while a scene is being loaded in the background
+  bool loadingScene() const { return m_loading != nullptr; }
+
   /**
    * Starts execution of the engine in a window of the specified starting size.
    * Blocks until application is closed.
@@ -57,14 +69,37 @@ class Application {
   void stop();
 
   /**
-   * Switch to the scene with the given name. The switch will be done before the start of
-   * the next frame.
+   * Switch to the scene with the given name.
+   *
+   * The scene is loaded on a background thread while the current one keeps
+   * running. Once it is ready, the meshes and textures it uses are decoded on the
+   * job system and uploaded to the device (see AssetPreloader). It then replaces
+   * the current scene at the start of a frame, while the old one is destroyed once
+   * no frame in flight uses it anymore. If loading fails, the current scene is
+   * kept.
+   *
+   * Switches requested while another one is in progress are started once it
+   * completes. Only the last requested one is kept.
    */
   void switchScene(const std::string &name);
 
+  /**
+   * Registrar for the "sceneLoadProgress" hook
+   *
+   * This hook is executed on the main thread, at the start of every frame in
+   * which the progress of the scene being loaded has changed. It receives the
+   * name of the scene and the fraction loaded so far, with 1 meaning that the
+   * scene is about to be swapped in.
+   */
+  HookRegistrar<const std::string &, float> &onSceneLoadProgress()
+  {
+    return m_sceneLoadProgress.registrar();
+  }
+
  private:
   ApplicationConfig conf;
 
+  std::unique_ptr<jobs::JobSystem> m_jobs;
   std::unique_ptr<rendering::GlfwWindow> m_glfwWindow;
   std::unique_ptr<rendering::Renderer> m_vulkan;
   std::unique_ptr<InputManager> m_inputManager;
@@ -72,7 +107,18 @@ class Application {
 
   std::optional<std::string> m_newSceneName;
 
-  void handleSceneSwitch(rendering::FrameHandle handle);
+  // Scene being loaded and old scenes with the number of frames they must
+  // still survive
+  struct SceneLoad;
+  std::unique_ptr<SceneLoad> m_loading;
+  std::vector<std::pair<std::unique_ptr<Scene>, size_t>> m_retiredScenes;
+
+  Hook<const std::string &, float> m_sceneLoadProgress;
+
+  void startSceneLoad();
+  void updateSceneLoad();
+  void reportSceneLoadProgress(float progress);
+  void retireScenes();
 
   Duration frameLimit(Timestamp lastTime, Duration delta) const;
 };
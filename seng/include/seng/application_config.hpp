@@ -25,9 +25,26 @@ struct ApplicationConfig {
   /// Directory where the engine will look for generic assets (i.e. meshes/textures)
   std::string assetPath = "./assets/";
 
+  /// Directory where processed meshes are cached (see `mesh_cache.hpp`). If
+  /// empty, meshes are not cached.
+  std::string meshCachePath = "./cache/meshes/";
+
+  /// Reorder the triangles and vertices of meshes after loading them, so that
+  /// they are faster to render (see `mesh_optimizer.hpp`)
+  bool optimizeMeshes = true;
+
+  /// Number of simplified levels of detail generated for each mesh after loading
+  /// it (see `mesh_simplifier.hpp`). They are drawn only by entities with a
+  /// LodGroup component.
+  unsigned int meshLodLevels = 0;
+
   /// Directory where the engine will look for scene YAML definition files
   std::string scenePath = "./scenes/";
 
+  /// Number of worker threads used by the job system. If 0, one for each
+  /// hardware thread besides the main one.
+  unsigned int workerThreads = 0;
+
   // ====
   // Graphics
   // ====
@@ -39,6 +56,11 @@ struct ApplicationConfig {
   /// requested.
   float anisotropyLevel = 8.0f;
 
+  /// Upload meshes with packed vertices (see `rendering::PackedVertex`), that
+  /// take less than half the memory. All shaders used to draw them need to
+  /// define a vertex stage for packed vertices.
+  bool packVertices = false;
+
   /// Enable/disable creation of mipmaps
   bool useMipMaps = true;
 
@@ -3,12 +3,11 @@
 #include <seng/components/base_component.hpp>
 #include <seng/components/definitions.hpp>
 #include <seng/components/scene_config_component_factory.hpp>
-#include <seng/hook.hpp>
-#include <seng/rendering/glfw_window.hpp>
 
 #include <glm/mat4x4.hpp>
 #include <glm/trigonometric.hpp>
 
+#include <mutex>
 #include <vector>
 
 namespace seng {
@@ -24,6 +23,10 @@ class Entity;
  * ones. If there are multiple cameras, only the one set as main will render.
  * If multiple main cameras are set as main, it is undefined which will be
  * registered as main in the end.
+ *
+ * The aspect ratio follows the window's framebuffer size and is refreshed each
+ * time the projection matrix is requested, so cameras can be created from any
+ * thread (e.g. while a scene is loaded in the background).
  */
 class Camera : public BaseComponent, public ConfigParsableComponent<Camera> {
  public:
@@ -54,12 +57,17 @@ class Camera : public BaseComponent, public ConfigParsableComponent<Camera> {
   // Getters
   bool orthographic() const { return m_ortho; }
   float halfWidth() const { return m_half; }
-  float aspectRatio() const { return m_aspectRatio; }
+  float aspectRatio() const
+  {
+    syncAspectRatio();
+    return m_aspectRatio;
+  }
   float nearPlane() const { return m_near; }
   float farPlane() const { return m_far; }
   float fov() const { return m_fov; }
 
-  static const std::vector<Camera*>& allCameras() { return cameras; }
+  /// Return a snapshot of all existing cameras
+  static std::vector<Camera*> allCameras();
 
   // Setters
   void orthographic(bool ortho);
@@ -84,21 +92,20 @@ class Camera : public BaseComponent, public ConfigParsableComponent<Camera> {
  private:
   bool m_ortho;
   float m_half;
-  float m_aspectRatio;
   float m_near;
   float m_far;
   float m_fov;
 
-  HookToken<rendering::GlfwWindow*, int, int> m_resizeToken;
-
+  static std::mutex camerasLock;
   static std::vector<Camera*> cameras;
 
   /**
-   * Run on window resize. Updates the aspect ratio
+   * Update the aspect ratio to match the window's framebuffer, if it has changed
    */
-  void resize(int width, int height);
+  void syncAspectRatio() const;
 
   // For caching
+  mutable float m_aspectRatio;
   mutable bool m_projectionDirty = true;
   mutable glm::mat4 m_projection;
   mutable glm::mat4 m_view;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <seng/components/base_component.hpp>
+#include <seng/scene/component_pool.hpp>
 
 #include <cstddef>
 #include <memory>
@@ -15,16 +16,41 @@ template <typename T>
 using IfComponent = std::enable_if<
     std::is_base_of<BaseComponent, typename std::remove_reference<T>::type>::value>;
 
+/**
+ * Deleter used by ComponentPtr: gives back Components allocated from a
+ * ComponentPool, deletes heap-allocated ones.
+ */
+struct ComponentDeleter {
+  ComponentPoolBase *pool = nullptr;
+
+  void operator()(BaseComponent *ptr) const
+  {
+    if (pool != nullptr)
+      pool->destroy(ptr);
+    else
+      delete ptr;
+  }
+};
+
 /**
  * Thin wrapper around std::unique_ptr<BaseComponent> that provides handy
  * casting methods.
  *
- * For convenience, unique_ptr<BaseCompoenent> is trivially convertible to it.
+ * Components can either live in a Scene's ComponentPool (see `makeComponent()`)
+ * or on the heap. For convenience, unique_ptr<BaseCompoenent> is trivially
+ * convertible to it.
  */
 class ComponentPtr {
  public:
+  /// The underlying owning pointer type
+  using Handle = std::unique_ptr<BaseComponent, ComponentDeleter>;
+
   ComponentPtr() : m_ptr(nullptr) {}
-  ComponentPtr(std::unique_ptr<BaseComponent> &&ptr) : m_ptr(std::move(ptr)) {}
+  ComponentPtr(std::unique_ptr<BaseComponent> &&ptr) : m_ptr(ptr.release()) {}
+  ComponentPtr(BaseComponent *ptr, ComponentPoolBase &pool) :
+      m_ptr(ptr, ComponentDeleter{std::addressof(pool)})
+  {
+  }
   ComponentPtr(std::nullptr_t) : ComponentPtr() {}
 
   ComponentPtr(const ComponentPtr &) = delete;
@@ -69,8 +95,8 @@ class ComponentPtr {
   BaseComponent &operator*() const noexcept { return *m_ptr; }
   BaseComponent *operator->() const noexcept { return m_ptr.get(); }
 
-  std::unique_ptr<BaseComponent> &&release() noexcept { return std::move(m_ptr); }
-  void rebind(std::unique_ptr<BaseComponent> &&p) noexcept { m_ptr = std::move(p); }
+  Handle &&release() noexcept { return std::move(m_ptr); }
+  void rebind(Handle &&p) noexcept { m_ptr = std::move(p); }
   void swap(ComponentPtr &other) noexcept { m_ptr.swap(other.m_ptr); }
 
   /**
@@ -101,11 +127,11 @@ class ComponentPtr {
   template <typename Concrete, typename = IfComponent<Concrete>>
   Concrete *maybeGet() const
   {
-    return dynamic_cast<Concrete>(m_ptr.get());
+    return dynamic_cast<Concrete *>(m_ptr.get());
   }
 
  private:
-  std::unique_ptr<BaseComponent> m_ptr;
+  Handle m_ptr;
 };
 
 };  // namespace seng
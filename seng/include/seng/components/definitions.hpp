@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 /// Convenience macro to declare a Component's ID
@@ -14,4 +15,27 @@ namespace seng {
 /// Convenience type alias for the type used by the Component's ID
 using ComponentIdType = std::string;
 
+/// Compact integer identifier associated to each Component ID
+using ComponentTypeId = std::uint32_t;
+
+/**
+ * Return the integer type id associated to the given Component ID. Ids are
+ * handed out sequentially starting from 0 the first time a Component ID is
+ * seen, so they can be used to index arrays.
+ *
+ * This function is thread-safe.
+ */
+ComponentTypeId componentTypeId(const ComponentIdType &id);
+
+/**
+ * Return the integer type id associated to the Component type T. Equivalent to
+ * `componentTypeId(T::componentId())`, but the lookup is done only once.
+ */
+template <typename T>
+ComponentTypeId componentTypeId()
+{
+  static const ComponentTypeId id = componentTypeId(T::componentId());
+  return id;
+}
+
 };  // namespace seng
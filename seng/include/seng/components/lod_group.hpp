@@ -0,0 +1,75 @@
+#pragma once
+
+#include <seng/components/definitions.hpp>
+#include <seng/components/scene_config_component_factory.hpp>
+#include <seng/components/script.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace seng {
+class Entity;
+
+/**
+ * Chooses each frame the level of detail (see `Mesh::lods`) drawn by the
+ * MeshRenderers of its entity, based either on their distance from the main
+ * camera or on the size they appear on screen.
+ *
+ * There is a threshold for each level after the first: when the distance grows
+ * past a threshold, or the screen size shrinks below it, the next level is drawn.
+ * Screen size is the fraction of the screen height covered by the bounding
+ * sphere of the meshes. To avoid switching back and forth around a threshold,
+ * going back to the previous level requires getting back past the threshold by
+ * a `hysteresis` fraction of it. Meshes that have fewer levels than the chosen
+ * one draw their last.
+ */
+class LodGroup : public ScriptComponent, public ConfigParsableComponent<LodGroup> {
+ public:
+  /// What thresholds are compared to
+  enum struct Metric { eDistance, eScreenSize };
+
+  static constexpr float DEFAULT_HYSTERESIS = 0.1f;
+
+  /**
+   * Create a new LodGroup switching levels at the given thresholds, which are
+   * sorted from the one of the second level to the one of the last.
+   */
+  LodGroup(Entity& entity,
+           Metric metric,
+           std::vector<float> thresholds,
+           float hysteresis = DEFAULT_HYSTERESIS,
+           bool enabled = true);
+  LodGroup(const LodGroup&) = delete;
+  LodGroup(LodGroup&&) = delete;
+
+  LodGroup& operator=(const LodGroup&) = delete;
+  LodGroup& operator=(LodGroup&&) = delete;
+
+  DECLARE_COMPONENT_ID("LodGroup");
+  DECLARE_CREATE_FROM_CONFIG();
+
+  // Accessors
+  Metric metric() const { return m_metric; }
+  const std::vector<float>& thresholds() const { return m_thresholds; }
+  float hysteresis() const { return m_hysteresis; }
+
+  /// Level chosen in the last update
+  size_t level() const { return m_level; }
+
+  void onUpdate(float deltaTime) override;
+
+ private:
+  Metric m_metric;
+  std::vector<float> m_thresholds;
+  float m_hysteresis;
+  size_t m_level;
+
+  /// Return how far past each threshold the meshes are, i.e. the distance or
+  /// the reciprocal of the screen size. Returns a negative value if there is
+  /// nothing to measure.
+  float coarseness() const;
+};
+
+REGISTER_TO_CONFIG_FACTORY(LodGroup);
+
+}  // namespace seng
@@ -3,24 +3,25 @@
 #include <seng/components/definitions.hpp>
 #include <seng/components/scene_config_component_factory.hpp>
 #include <seng/components/toggle.hpp>
-#include <seng/hook.hpp>
 
 #include <glm/vec2.hpp>
 
+#include <cstddef>
 #include <string>
 #include <utility>
 
 namespace seng {
 class Entity;
 
-namespace rendering {
-class CommandBuffer;
-}
-
 /**
  * The MeshRenderer component is the glue that binds meshes to materials (or
- * shader instances). On the shaderInstanceDraw scene hook, it fetches from the
- * cache (or loads if necessary) the mesh and renders it.
+ * shader instances). Each frame, the scene fetches from the cache (or loads if
+ * necessary) the mesh of each enabled MeshRenderer and draws it with its
+ * material, unless it is outside of the camera's view, in which case it is
+ * marked as not visible (see `Scene::draw`).
+ *
+ * By default the full mesh is drawn, other levels of detail can be chosen
+ * manually or by a LodGroup on the same entity.
  */
 class MeshRenderer : public ToggleComponent,
                      public ConfigParsableComponent<MeshRenderer> {
@@ -47,19 +48,22 @@ class MeshRenderer : public ToggleComponent,
   // Accessors
   const std::string& meshName() const { return m_meshName; }
   const std::string& shaderInstanceName() const { return m_matName; }
+  size_t lod() const { return m_lod; }
+  glm::vec2 uvScale() const { return m_scale; }
+  bool visible() const { return m_visible; }
 
   // Setters
-  void meshName(std::string name) { m_meshName = std::move(name); }
+  void meshName(std::string name);
   void shaderInstanceName(std::string name);
-
-  /// Render the mesh
-  void render(const rendering::CommandBuffer& cmd) const;
+  void lod(size_t level) { m_lod = level; }
+  void visible(bool visible) { m_visible = visible; }
 
  private:
   std::string m_meshName;
   std::string m_matName;
   glm::vec2 m_scale;
-  HookToken<const rendering::CommandBuffer&> m_tok;
+  size_t m_lod = 0;
+  bool m_visible = true;
 };
 
 REGISTER_TO_CONFIG_FACTORY(MeshRenderer);
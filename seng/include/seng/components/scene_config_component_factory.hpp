@@ -9,14 +9,12 @@
 #include <unordered_map>
 
 /// Use for in-line definition of the YAML parsing function
-#define DECLARE_CREATE_FROM_CONFIG()                                           \
-  static std::unique_ptr<seng::BaseComponent> createFromConfig(seng::Entity &, \
-                                                               const YAML::Node &)
+#define DECLARE_CREATE_FROM_CONFIG() \
+  static seng::ComponentPtr createFromConfig(seng::Entity &, const YAML::Node &)
 
 /// Use for out-of-line definition of the YAML parsing function
-#define DEFINE_CREATE_FROM_CONFIG(type, entity, node)                               \
-  std::unique_ptr<seng::BaseComponent> type::createFromConfig(seng::Entity &entity, \
-                                                              const YAML::Node &node)
+#define DEFINE_CREATE_FROM_CONFIG(type, entity, node) \
+  seng::ComponentPtr type::createFromConfig(seng::Entity &entity, const YAML::Node &node)
 
 /// Register the given type to SceneConfigComponentFactory
 #define REGISTER_TO_CONFIG_FACTORY(type) \
@@ -40,8 +38,7 @@ class Entity;
 class SceneConfigComponentFactory {
  public:
   /// Function type to be implemented by parseable components.
-  using TConfigCreateFunc = std::unique_ptr<BaseComponent> (*)(Entity &,
-                                                               const YAML::Node &);
+  using TConfigCreateFunc = ComponentPtr (*)(Entity &, const YAML::Node &);
 
  public:
   /// Deleted constructor. Class is fully static.
@@ -72,8 +69,9 @@ class SceneConfigComponentFactory {
  * and provide two static methods:
  *
  * 1. `ComponentIdType componentId()`: return the id of the Component
- * 2. `unique_ptr<BaseComponent> createFromConfig(Entity &, const YAML::Node &)`:
- *    create a component instance from the YAML config
+ * 2. `ComponentPtr createFromConfig(Entity &, const YAML::Node &)`:
+ *    create a component instance from the YAML config, usually via
+ *    `makeComponent<T>()`
  *
  * Then it should instantiate this template.
  *
@@ -2,8 +2,10 @@
 
 #include <seng/components/definitions.hpp>
 #include <seng/components/toggle.hpp>
-#include <seng/hook.hpp>
 #include <seng/scene/scene.hpp>
+#include <seng/scene/script_scheduler.hpp>
+
+#include <cstddef>
 
 namespace seng {
 class Entity;
@@ -14,6 +16,9 @@ class Entity;
  * This Component provides convenience hooks into the Scene events via virtual
  * functions that the user can override. More details can be found in the
  * documentation of each of those.
+ *
+ * By default, scripts are run serially. Scripts can opt in to running in parallel
+ * with other scripts by declaring what they access through `declareAccess`.
  */
 class ScriptComponent : public ToggleComponent {
  public:
@@ -53,12 +58,27 @@ class ScriptComponent : public ToggleComponent {
    */
   virtual void onLateUpdate([[maybe_unused]] float deltaTime) {}
 
+  /**
+   * Declare the transforms and components this script reads and writes in its
+   * update hooks, allowing the Scene to run it concurrently with other scripts it
+   * does not conflict with. The script's own state is always considered written.
+   *
+   * Return false (the default) if the accesses cannot be declared: the script will
+   * then be run serially, after the parallel ones. Scripts that do declare their
+   * accesses must not touch anything outside of them, nor create or destroy
+   * entities and components, nor register to hooks during their updates.
+   *
+   * Called before every phase, so accesses may change from frame to frame.
+   */
+  virtual bool declareAccess([[maybe_unused]] ScriptAccess &access) const
+  {
+    return false;
+  }
+
  private:
-  HookToken<float> m_earlyUpdateToken, m_updateToken, m_lateUpdateToken;
+  size_t m_scriptIndex;
 
-  void onEarlyUpdateImpl(float deltaTime);
-  void onUpdateImpl(float deltaTime);
-  void onLateUpdateImpl(float deltaTime);
+  friend class ScriptScheduler;
 };
 
 };  // namespace seng
@@ -10,6 +10,7 @@
 
 #include <cstdint>
 #include <optional>
+#include <string>
 #include <unordered_set>
 
 namespace YAML {
@@ -18,6 +19,7 @@ class Node;
 
 namespace seng {
 class Entity;
+class TransformSystem;
 
 /**
  * Enumeration representing the coordinate system to use in caluclations.
@@ -32,7 +34,8 @@ enum struct CoordinateSystem { eLocal, eWorld };
  * hierarchically.
  *
  * The position/rotation/scale retrieved by use of the accessor methods are all
- * relative to the local space.
+ * relative to the local space. World-space matrices are cached by the scene's
+ * TransformSystem, so reading them is cheap.
  *
  * The coordinate system used is a left-handed Y-up system. Small visualization:
  *
@@ -58,6 +61,16 @@ class Transform : public BaseComponent, public ConfigParsableComponent<Transform
             glm::vec3 pos = DEFAULT_POS,
             glm::vec3 scale = DEFAULT_SCALE,
             glm::vec3 rotation = DEFAULT_ROT);
+
+  /**
+   * Create a new transform with the given position, scale and rotation parented
+   * to the given transform, if not null.
+   */
+  Transform(Entity& entity,
+            Transform* parent,
+            glm::vec3 pos = DEFAULT_POS,
+            glm::vec3 scale = DEFAULT_SCALE,
+            glm::vec3 rotation = DEFAULT_ROT);
   Transform(const Transform&) = delete;
   Transform(Transform&&) = delete;
   ~Transform();
@@ -68,13 +81,26 @@ class Transform : public BaseComponent, public ConfigParsableComponent<Transform
   DECLARE_COMPONENT_ID("Transform");
   DECLARE_CREATE_FROM_CONFIG();
 
+  /**
+   * Read the parent name, position, scale and rotation from the given scene
+   * config node. Parameters missing from the node are left untouched.
+   */
+  static void parseConfig(const YAML::Node& node,
+                          std::optional<std::string>& parent,
+                          glm::vec3& pos,
+                          glm::vec3& scale,
+                          glm::vec3& rotation);
+
   /**
    * Returns the local-space matrix of this transform
    */
   const glm::mat4& localMatrix() const;
 
   /**
-   * Returns the world-space matrix of this transform
+   * Returns the world-space matrix of this transform.
+   *
+   * The matrix is cached and recomputed only if this transform or any of its
+   * parents have changed since the last time it was computed.
    */
   glm::mat4 worldMartix() const;
 
@@ -169,15 +195,15 @@ class Transform : public BaseComponent, public ConfigParsableComponent<Transform
   /**
    * Queries if the `changed` flag is set.
    *
-   * This flag becomes true if the transform has been changed
-   * at any time before this call and noone has explicitly cleared it.
+   * This flag becomes true if the transform or any of its parents has been
+   * changed at any time before this call and noone has explicitly cleared it.
    */
-  bool changed() const { return m_changes & CHANGE_TRACKER; }
+  bool changed() const;
 
   /**
    * Clears the `changed` flag.
    */
-  void clearChanged() { m_changes = m_changes | CHANGE_TRACKER; }
+  void clearChanged() { m_changes &= ~CHANGE_TRACKER; }
 
   /**
    * Return the unitary vector representing the forward direction of this transform
@@ -219,8 +245,13 @@ class Transform : public BaseComponent, public ConfigParsableComponent<Transform
   static constexpr uint32_t POSITION = 0x00000001;
   static constexpr uint32_t ROTATION = 0x00000002;
   static constexpr uint32_t SCALE = 0x00000004;
+  static constexpr uint32_t ROTATION_MATRIX = 0x00000008;
+  static constexpr uint32_t LOCAL_CHANGES = POSITION | ROTATION | SCALE;
   static constexpr uint32_t CHANGE_TRACKER = 0x80000000;
 
+  TransformSystem* m_system;
+  uint32_t m_index;
+
   Transform* m_parent;
   std::unordered_set<Transform*> m_children;
 
@@ -233,6 +264,10 @@ class Transform : public BaseComponent, public ConfigParsableComponent<Transform
   mutable glm::mat4 m_local;
 
   const glm::mat4& rotationMatrix() const;
+  void markChanged(uint32_t what);
+
+  friend class TransformSystem;
+  friend class ScriptAccess;
 };
 
 REGISTER_TO_CONFIG_FACTORY(Transform);
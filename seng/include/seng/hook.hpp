@@ -2,9 +2,12 @@
 
 #include <seng/log.hpp>
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
-#include <unordered_map>
+#include <memory>
+#include <utility>
+#include <vector>
 
 namespace seng {
 
@@ -24,7 +27,9 @@ class HookToken;
  * registered callbacks.
  *
  * Hook callbacks can be any callable that takes as input `CallbackArgs` and
- * returns void.
+ * returns void. Callbacks are free to insert, replace or remove callbacks
+ * (including themselves) from the hook they are being dispatched by: changes are
+ * deferred until the outermost dispatch ends.
  *
  * A hook is not copyable nor movable.
  */
@@ -42,13 +47,10 @@ class Hook {
   HookRegistrar<CallbackArgs...>& registrar() { return m_registrar; }
 
   /// Invoke all callbacks associated to this hook
-  void operator()(CallbackArgs... args) const
-  {
-    for (const auto& cb : m_registrar.callbacks()) std::get<1>(cb)(args...);
-  }
+  void operator()(CallbackArgs... args) { m_registrar.dispatch(args...); }
 
   /// Return true if there are no callbacks queued
-  bool empty() const { return m_registrar.callbacks().empty(); }
+  bool empty() const { return m_registrar.empty(); }
 
  private:
   HookRegistrar<CallbackArgs...> m_registrar;
@@ -57,6 +59,13 @@ class Hook {
 /**
  * Allows registration to a Hook of the same type parameters.
  *
+ * Callbacks are stored in a dense slot map: the callbacks themselves live in a
+ * contiguous array that is walked linearly on dispatch, while tokens reference
+ * an indirection slot tagged with a generation counter. Removing a callback
+ * bumps the generation of its slot, so stale tokens are detected instead of
+ * silently aliasing a newer callback. Once the arrays have grown to their steady
+ * state size, neither dispatching nor inserting/removing allocates.
+ *
  * It not copyable nor movable;
  */
 template <typename... CallbackArgs>
@@ -65,12 +74,6 @@ class HookRegistrar {
   /// Typedef for the function type of the hook
   using HookFunc = std::function<void(CallbackArgs...)>;
 
-  /// Covenience typedef
-  using CallbackRegisterType = std::unordered_map<uint64_t, HookFunc>;
-
-  /// Covenience typedef
-  using CallbackType = typename CallbackRegisterType::value_type;
-
   HookRegistrar() = default;
   HookRegistrar(const HookRegistrar&) = delete;
   HookRegistrar(HookRegistrar&&) = delete;
@@ -78,23 +81,35 @@ class HookRegistrar {
   HookRegistrar& operator=(const HookRegistrar&) = delete;
   HookRegistrar& operator=(HookRegistrar&&) = delete;
 
-  /// All callbacks registered with this registrar
-  const CallbackRegisterType callbacks() const { return m_callbacks; }
+  /// Number of callbacks registered with this registrar
+  size_t size() const { return m_live; }
+
+  /// Return true if no callback is registered with this registrar
+  bool empty() const { return m_live == 0; }
 
   /**
    * Register a new callback. The returned token can be used to access this
    * specific callback.
+   *
+   * If called during dispatch, the callback will be called starting from the
+   * next dispatch.
    */
   HookToken<CallbackArgs...> insert(HookFunc callback)
   {
-    m_callbacks.emplace(m_index, callback);
-    HookToken<CallbackArgs...> tok{this, m_index};
-    m_index++;
-    return tok;
+    uint32_t slot = allocateSlot();
+    if (m_dispatchDepth > 0)
+      pushPending(slot, std::move(callback));
+    else
+      pushDense(slot, std::move(callback));
+    m_live++;
+    return HookToken<CallbackArgs...>{this, slot, m_slots[slot].generation};
   }
 
   /**
    * Replace the callback identified by the given token with a new callback
+   *
+   * If called during dispatch, the old callback is not called anymore and the
+   * new one will be called starting from the next dispatch.
    */
   void replace(const HookToken<CallbackArgs...>& token, HookFunc callback)
   {
@@ -102,15 +117,28 @@ class HookRegistrar {
       seng::log::error("Token from another registrar, ignoring... Something is wrong");
       return;
     }
-    auto it = m_callbacks.find(token.m_id);
-    if (it != m_callbacks.end()) {
-      it->second = callback;
+    if (!valid(token)) return;
+
+    Slot& s = m_slots[token.m_slot];
+    if (s.index & PENDING_BIT) {
+      m_pendingCallbacks[s.index & ~PENDING_BIT] = std::move(callback);
+    } else if (m_dispatchDepth > 0) {
+      // The old callback may be executing right now, so it cannot be
+      // overwritten: kill it and queue the replacement
+      m_owners[s.index] = INVALID_INDEX;
+      m_graveyard.push_back(s.index);
+      pushPending(token.m_slot, std::move(callback));
+    } else {
+      m_callbacks[s.index] = std::move(callback);
     }
   }
 
   /**
    * Delete the callback identified by the given content. After removal the
    * token is cleared.
+   *
+   * If called during dispatch, the callback will not be called anymore by the
+   * current dispatch, if it has not been called already.
    */
   void remove(HookToken<CallbackArgs...>& token)
   {
@@ -118,18 +146,147 @@ class HookRegistrar {
       seng::log::error("Token from another registrar, ignoring... Something is wrong");
       return;
     }
-    m_callbacks.erase(token.m_id);
+    if (valid(token)) {
+      Slot& s = m_slots[token.m_slot];
+      if (s.index & PENDING_BIT) {
+        m_pendingOwners[s.index & ~PENDING_BIT] = INVALID_INDEX;
+      } else if (m_dispatchDepth > 0) {
+        m_owners[s.index] = INVALID_INDEX;
+        m_graveyard.push_back(s.index);
+      } else {
+        eraseDense(s.index);
+      }
+      freeSlot(token.m_slot);
+      m_live--;
+    }
     token.clear();
   }
 
  private:
-  std::uint64_t m_index;
-  CallbackRegisterType m_callbacks;
+  /// Indirection entry pointing either to the dense or to the pending arrays
+  struct Slot {
+    uint32_t index;
+    uint32_t generation;
+  };
+
+  static constexpr uint32_t INVALID_INDEX = ~uint32_t{0};
+  static constexpr uint32_t PENDING_BIT = uint32_t{1} << 31;
+
+  // Dense storage, m_owners[i] is the slot of m_callbacks[i]. Killed callbacks
+  // have INVALID_INDEX as owner until they are compacted away
+  std::vector<HookFunc> m_callbacks;
+  std::vector<uint32_t> m_owners;
+
+  // Slot map
+  std::vector<Slot> m_slots;
+  std::vector<uint32_t> m_freeSlots;
+
+  // Modifications deferred until the end of the current dispatch
+  std::vector<HookFunc> m_pendingCallbacks;
+  std::vector<uint32_t> m_pendingOwners;
+  std::vector<uint32_t> m_graveyard;
+
+  uint32_t m_dispatchDepth = 0;
+  size_t m_live = 0;
+
+  bool valid(const HookToken<CallbackArgs...>& token) const
+  {
+    return token.m_slot < m_slots.size() &&
+           m_slots[token.m_slot].generation == token.m_generation;
+  }
+
+  uint32_t allocateSlot()
+  {
+    if (!m_freeSlots.empty()) {
+      uint32_t slot = m_freeSlots.back();
+      m_freeSlots.pop_back();
+      return slot;
+    }
+    m_slots.push_back({INVALID_INDEX, 0});
+    return static_cast<uint32_t>(m_slots.size() - 1);
+  }
+
+  void freeSlot(uint32_t slot)
+  {
+    m_slots[slot].index = INVALID_INDEX;
+    m_slots[slot].generation++;
+    m_freeSlots.push_back(slot);
+  }
+
+  void pushDense(uint32_t slot, HookFunc&& callback)
+  {
+    m_slots[slot].index = static_cast<uint32_t>(m_callbacks.size());
+    m_callbacks.push_back(std::move(callback));
+    m_owners.push_back(slot);
+  }
+
+  void pushPending(uint32_t slot, HookFunc&& callback)
+  {
+    m_slots[slot].index = static_cast<uint32_t>(m_pendingCallbacks.size()) | PENDING_BIT;
+    m_pendingCallbacks.push_back(std::move(callback));
+    m_pendingOwners.push_back(slot);
+  }
+
+  // Swap-and-pop removal. The last element must not be a killed one.
+  void eraseDense(uint32_t index)
+  {
+    uint32_t last = static_cast<uint32_t>(m_callbacks.size() - 1);
+    if (index != last) {
+      m_callbacks[index] = std::move(m_callbacks[last]);
+      m_owners[index] = m_owners[last];
+      m_slots[m_owners[index]].index = index;
+    }
+    m_callbacks.pop_back();
+    m_owners.pop_back();
+  }
+
+  // Apply all the modifications deferred during dispatch
+  void flush()
+  {
+    if (!m_graveyard.empty()) {
+      // Erasing from the back guarantees that the element swapped in is alive
+      std::sort(m_graveyard.begin(), m_graveyard.end(), std::greater<uint32_t>());
+      for (uint32_t index : m_graveyard) eraseDense(index);
+      m_graveyard.clear();
+    }
+    for (size_t i = 0; i < m_pendingCallbacks.size(); i++) {
+      if (m_pendingOwners[i] == INVALID_INDEX) continue;
+      pushDense(m_pendingOwners[i], std::move(m_pendingCallbacks[i]));
+    }
+    m_pendingCallbacks.clear();
+    m_pendingOwners.clear();
+  }
+
+  void dispatch(CallbackArgs&... args)
+  {
+    // Size is captured beforehand, callbacks inserted by callbacks go to the
+    // pending array, so the dense one is never reallocated while in use
+    const size_t n = m_callbacks.size();
+    DispatchGuard guard{*this};
+    for (size_t i = 0; i < n; i++)
+      if (m_owners[i] != INVALID_INDEX) m_callbacks[i](args...);
+  }
+
+  // Keeps the dispatch depth consistent even if a callback throws
+  struct DispatchGuard {
+    HookRegistrar& reg;
+
+    explicit DispatchGuard(HookRegistrar& r) : reg(r) { reg.m_dispatchDepth++; }
+    ~DispatchGuard()
+    {
+      if (--reg.m_dispatchDepth == 0) reg.flush();
+    }
+  };
+
+  friend class Hook<CallbackArgs...>;
 };
 
 /**
  * Token returned by a `HookRegistrar`. Identifies uniquely a callback registered
  * in that registrar.
+ *
+ * Tokens are cheap to copy. A token whose callback has been removed (e.g. through
+ * one of its copies) is recognized as stale and ignored by the registrar.
  */
 template <typename... CallbackArgs>
 class HookToken {
@@ -142,8 +299,10 @@ class HookToken {
   HookToken& operator=(HookToken&&) = default;
 
  private:
-  HookToken(const HookRegistrar<CallbackArgs...>* registrar, uint64_t id) :
-      m_registrar(registrar), m_id(id)
+  HookToken(const HookRegistrar<CallbackArgs...>* registrar,
+            uint32_t slot,
+            uint32_t generation) :
+      m_registrar(registrar), m_slot(slot), m_generation(generation)
   {
   }
 
@@ -154,8 +313,9 @@ class HookToken {
 
   void clear() { m_registrar = nullptr; }
 
-  const HookRegistrar<CallbackArgs...>* m_registrar;
-  uint64_t m_id;
+  const HookRegistrar<CallbackArgs...>* m_registrar = nullptr;
+  uint32_t m_slot = 0;
+  uint32_t m_generation = 0;
 
   friend class HookRegistrar<CallbackArgs...>;
 };
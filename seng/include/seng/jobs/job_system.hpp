@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace seng::jobs {
+
+/// Typedef for the function type of a job
+using Job = std::function<void()>;
+
+class JobSystem;
+
+/**
+ * Counts the jobs still running in a group. Jobs are added to the group when
+ * they are scheduled and removed once they complete, so a counter reaching zero
+ * means all the jobs in the group have finished.
+ *
+ * Counters are also used to express dependencies: jobs scheduled with
+ * `JobSystem::runAfter` are held back until the counter reaches zero.
+ *
+ * A counter must outlive all the jobs in its group. It is not copyable nor
+ * movable.
+ */
+class Counter {
+ public:
+  Counter() = default;
+  Counter(const Counter &) = delete;
+  Counter(Counter &&) = delete;
+
+  Counter &operator=(const Counter &) = delete;
+  Counter &operator=(Counter &&) = delete;
+
+  /// Return true if all jobs in the group have completed
+  bool done() const
+  {
+    // Locking guarantees that the job that completed the group is not touching
+    // the counter anymore, so it is safe to destroy it
+    std::lock_guard lock(m_mutex);
+    return m_pending == 0;
+  }
+
+ private:
+  uint32_t m_pending = 0;
+
+  mutable std::mutex m_mutex;
+  std::vector<std::pair<Job, Counter *>> m_continuations;
+
+  friend class JobSystem;
+};
+
+/**
+ * Work-stealing job scheduler.
+ *
+ * Each worker thread owns a deque of jobs: it pushes and pops from the back of
+ * its own, while idle workers steal from the front of the others'. Threads
+ * that are not workers (e.g. the main thread) share an additional deque, to
+ * which their jobs are pushed.
+ *
+ * Waiting on a counter never blocks: the waiting thread executes pending jobs
+ * until the counter reaches zero, so it is safe to wait from inside a job.
+ *
+ * Jobs that must run on the main thread (e.g. because they call into GLFW) can
+ * be queued with `runOnMainThread`, and are executed by `runMainThreadJobs`,
+ * which the Application calls once every frame.
+ *
+ * Exceptions escaping a job are logged and swallowed.
+ *
+ * It is not copyable nor movable.
+ */
+class JobSystem {
+ public:
+  /**
+   * Start the given number of worker threads. If 0, one worker for each
+   * hardware thread besides the main one is started.
+   */
+  explicit JobSystem(unsigned int workers = 0);
+  JobSystem(const JobSystem &) = delete;
+  JobSystem(JobSystem &&) = delete;
+  ~JobSystem();
+
+  JobSystem &operator=(const JobSystem &) = delete;
+  JobSystem &operator=(JobSystem &&) = delete;
+
+  /// Number of worker threads
+  size_t workerCount() const { return m_workers.size(); }
+
+  /// Return true if called from the thread that created the JobSystem
+  bool isMainThread() const { return std::this_thread::get_id() == m_mainThread; }
+
+  /**
+   * Schedule a job. If a counter is given, the job is added to its group.
+   */
+  void run(Job job, Counter *counter = nullptr);
+
+  /**
+   * Schedule a job to be run once all jobs in the `dependency` group have
+   * completed. If a `counter` is given, the job is added to its group
+   * immediately.
+   */
+  void runAfter(Counter &dependency, Job job, Counter *counter = nullptr);
+
+  /**
+   * Execute pending jobs until all jobs in the counter's group have completed.
+   */
+  void wait(Counter &counter);
+
+  /**
+   * Split the range `[begin, end)` in chunks of at most `grain` elements and
+   * call `f(chunkBegin, chunkEnd)` for each of them in parallel. Returns once
+   * all chunks have been processed.
+   */
+  template <typename F>
+  void parallelFor(size_t begin, size_t end, size_t grain, F &&f)
+  {
+    if (end <= begin) return;
+    grain = std::max<size_t>(grain, 1);
+
+    // Run small ranges inline, no point in paying for scheduling
+    if (end - begin <= grain || m_workers.empty()) {
+      f(begin, end);
+      return;
+    }
+
+    Counter counter;
+    for (size_t b = begin + grain; b < end; b += grain) {
+      size_t e = std::min(end, b + grain);
+      run([&f, b, e]() { f(b, e); }, &counter);
+    }
+    try {
+      f(begin, begin + grain);
+    } catch (...) {
+      // The other chunks still reference f and the counter
+      wait(counter);
+      throw;
+    }
+    wait(counter);
+  }
+
+  /**
+   * Queue a job to be executed on the main thread, during the next call to
+   * `runMainThreadJobs`. If a counter is given, the job is added to its group.
+   */
+  void runOnMainThread(Job job, Counter *counter = nullptr);
+
+  /**
+   * Execute all jobs queued for the main thread. Must be called from the main
+   * thread.
+   */
+  void runMainThreadJobs();
+
+ private:
+  struct Task {
+    Job job;
+    Counter *counter;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::thread::id m_mainThread;
+  std::vector<std::thread> m_workers;
+
+  // One queue per worker, plus a shared one for the other threads at index 0
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  Queue m_mainThreadQueue;
+
+  std::atomic<bool> m_stop = false;
+  std::atomic<size_t> m_queued = 0;
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wakeUp;
+
+  void workerLoop(size_t index);
+  void push(Task task);
+  bool tryRunOne();
+  bool pop(size_t index, Task &task);
+  bool steal(size_t index, Task &task);
+  void execute(Task &task);
+  void complete(Counter *counter);
+};
+
+}  // namespace seng::jobs
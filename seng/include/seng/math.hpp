@@ -1,14 +1,56 @@
 #pragma once
 
+#include <glm/common.hpp>
 #include <glm/detail/qualifier.hpp>
 #include <glm/geometric.hpp>
 #include <glm/gtx/norm.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
 
 #include <algorithm>
 #include <limits>
 
 namespace seng {
 
+/// Axis-aligned bounding box
+struct Aabb {
+  glm::vec3 min = glm::vec3(0.0f);
+  glm::vec3 max = glm::vec3(0.0f);
+
+  glm::vec3 center() const { return (min + max) * 0.5f; }
+
+  /// Half of the size of the box along each axis
+  glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+  /// Total area of the box's faces
+  float area() const
+  {
+    glm::vec3 d = max - min;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+  }
+
+  /// Return true if the other box is completely inside this one
+  bool contains(const Aabb &o) const
+  {
+    return min.x <= o.min.x && min.y <= o.min.y && min.z <= o.min.z &&
+           max.x >= o.max.x && max.y >= o.max.y && max.z >= o.max.z;
+  }
+
+  /// Return true if the two boxes intersect
+  bool overlaps(const Aabb &o) const
+  {
+    return min.x <= o.max.x && min.y <= o.max.y && min.z <= o.max.z &&
+           max.x >= o.min.x && max.y >= o.min.y && max.z >= o.min.z;
+  }
+
+  /// Return the smallest box containing both this one and the other
+  Aabb merged(const Aabb &o) const
+  {
+    return {glm::min(min, o.min), glm::max(max, o.max)};
+  }
+};
+
 /// Gradually changes a value towards a desired goal over time. Never overshoots
 /// target
 template <int L, typename T, glm::qualifier Q>
@@ -112,6 +154,17 @@ float smoothDamp(float current,
                  float deltaTime,
                  float maxSpeed = std::numeric_limits<float>::infinity());
 
+/// Map the given direction onto the [-1; 1] square by projecting it on an
+/// octahedron and unfolding its lower half. A zero vector maps to the origin.
+glm::vec2 octEncode(glm::vec3 dir);
+
+/// Inverse of octEncode, returns a unit vector
+glm::vec3 octDecode(glm::vec2 p);
+
+/// Return the smallest AABB containing the given one once transformed by the
+/// given affine matrix
+Aabb transformAabb(const Aabb &box, const glm::mat4 &m);
+
 /// Loops value <t> so that it is never larger than <length> or smaller than 0
 float repeat(float t, float length);
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <seng/rendering/memory_allocator.hpp>
+
 #include <vulkan/vulkan_raii.hpp>
 
 #include <cstdint>
@@ -52,14 +54,15 @@ class Buffer {
               const vk::raii::CommandPool &pool);
 
   /**
-   * Lock the memory of the buffer.
+   * Lock the memory of the buffer. Host-visible memory stays mapped, so this
+   * just returns its address, throwing a runtime_error if it is not.
    */
   void *lockMemory(vk::DeviceSize size,
                    vk::DeviceSize offset,
                    vk::MemoryMapFlags flags) const;
 
   /**
-   * Unlock the buffer.
+   * Unlock the buffer, flushing the writes if the memory is not coherent.
    */
   void unlockMemory() const;
 
@@ -86,9 +89,8 @@ class Buffer {
   vk::BufferUsageFlags m_usage;
   vk::DeviceSize m_size;
   vk::raii::Buffer m_handle;
-  vk::MemoryRequirements m_memRequirements;
-  uint32_t m_memIndex;
-  vk::raii::DeviceMemory m_memory;
+  vk::MemoryPropertyFlags m_memFlags;
+  MemoryAllocator::Allocation m_memory;
 
   /**
    * Copy a region of this buffer into one of the destination buffer.
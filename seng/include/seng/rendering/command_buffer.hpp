@@ -65,7 +65,8 @@ class CommandBuffer {
 
   /**
    * Allocate a throwaway single-use buffer and start recording it. Then execute
-   * the given function. Once done, end the recording and deallocate the buffer.
+   * the given function. Once done, end the recording, submit the buffer, wait
+   * for it to complete and deallocate it.
    *
    * The lambda will receive a reference to the temporary VulkanBuffer.
    */
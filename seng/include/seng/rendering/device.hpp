@@ -1,10 +1,12 @@
 #pragma once
 
 #include <seng/application_config.hpp>
+#include <seng/rendering/memory_allocator.hpp>
 
 #include <vulkan/vulkan_raii.hpp>
 
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -14,11 +16,13 @@ class GlfwWindow;
 
 /**
  * The graphics/presentation queue family indexes for a given
- * PhysicalDevice/Surface pair.
+ * PhysicalDevice/Surface pair, plus the one of a family dedicated to transfers
+ * (i.e. without graphics support), if there is one.
  */
 struct QueueFamilyIndices {
   std::optional<uint32_t> graphicsFamily;
   std::optional<uint32_t> presentFamily;
+  std::optional<uint32_t> transferFamily;
 
   /**
    * Query given device and surface for support.
@@ -91,8 +95,24 @@ class Device {
   const vk::raii::Device &logical() const { return m_logical; }
   const vk::raii::Queue &presentQueue() const { return m_presentQueue; }
   const vk::raii::Queue &graphicsQueue() const { return m_graphicsQueue; }
+
+  /**
+   * Queue for transfers that need no graphics capabilities: the dedicated
+   * transfer queue, if any, or else the graphics queue.
+   */
+  const vk::raii::Queue &transferQueue() const
+  {
+    return hasTransferQueue() ? m_transferQueue : m_graphicsQueue;
+  }
+  bool hasTransferQueue() const { return m_queueIndices.transferFamily.has_value(); }
   vk::SurfaceFormatKHR depthFormat() const { return m_depthFormat; }
 
+  /**
+   * Allocator buffers and images get their memory from. Allocations must be
+   * destroyed before the device.
+   */
+  MemoryAllocator &allocator() const { return *m_allocator; }
+
   // Accessors to the support details
   const QueueFamilyIndices &queueFamilyIndices() const { return m_queueIndices; }
   const SwapchainSupportDetails &swapchainSupportDetails() const { return m_swapDetails; }
@@ -101,6 +121,13 @@ class Device {
   float maxSamplerAnisotropy() const { return m_maxAnisotropy; }
   vk::SampleCountFlags supportedSampleCounts() const { return m_supportedSampleCounts; }
 
+  /**
+   * Maximum number of draws a single indirect draw call can issue, 0 if they
+   * cannot be used. Indirect draws are used only if the device supports both
+   * multi-draw and indirect draws with a non-zero first instance.
+   */
+  uint32_t maxDrawIndirectCount() const { return m_maxDrawIndirectCount; }
+
   /**
    * Requery the swapchain support details.
    */
@@ -125,10 +152,13 @@ class Device {
   vk::raii::Device m_logical;
   vk::raii::Queue m_presentQueue;
   vk::raii::Queue m_graphicsQueue;
+  vk::raii::Queue m_transferQueue;
   vk::SurfaceFormatKHR m_depthFormat;
 
   float m_maxAnisotropy;
   vk::SampleCountFlags m_supportedSampleCounts;
+  uint32_t m_maxDrawIndirectCount;
+  std::unique_ptr<MemoryAllocator> m_allocator;
 
   /**
    * Choose the optimal swapchain format.
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <seng/rendering/buffer.hpp>
+#include <seng/rendering/primitive_types.hpp>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace seng::rendering {
+
+class Device;
+
+/**
+ * Device-local vertex and index buffers shared by all meshes, which are given
+ * slices of them instead of buffers of their own. This way meshes take a single
+ * allocation, and drawing different meshes only needs the buffers bound once
+ * (or once per vertex layout and index type).
+ *
+ * There is a vertex buffer for each vertex layout, so that slices are always a
+ * whole number of vertices from the start, and a single index buffer. Free
+ * space is kept in a list of blocks sorted by offset: allocations take the first
+ * one large enough, and freed slices are merged with the free blocks next to
+ * them, so that the list does not fragment over time. When no block is large
+ * enough the buffer grows, at least doubling, with its contents copied over.
+ *
+ * Frames still in flight may be drawing from a slice when it is released, so it
+ * is only given back once as many frames as there are in flight have begun
+ * since, through `collect()`.
+ *
+ * It is not copyable nor movable, since allocations point back to it.
+ */
+class GeometryArena {
+ private:
+  struct Pool;
+
+ public:
+  /**
+   * A slice of one of the arena's buffers, in bytes, which is released when
+   * destroyed (see `collect()`). It must not outlive the arena.
+   *
+   * It is movable, not copyable.
+   */
+  class Allocation {
+   public:
+    /// Create an empty allocation
+    Allocation(std::nullptr_t);
+    Allocation(const Allocation &) = delete;
+    Allocation(Allocation &&other) noexcept;
+    ~Allocation();
+
+    Allocation &operator=(const Allocation &) = delete;
+    Allocation &operator=(Allocation &&other) noexcept;
+
+    /// Return false for empty allocations
+    bool valid() const { return m_pool != nullptr; }
+
+    vk::DeviceSize offset() const { return m_offset; }
+    vk::DeviceSize size() const { return m_size; }
+
+   private:
+    Pool *m_pool;
+    vk::DeviceSize m_offset;
+    vk::DeviceSize m_size;
+
+    Allocation(Pool *pool, vk::DeviceSize offset, vk::DeviceSize size);
+    void release();
+
+    friend class GeometryArena;
+  };
+
+  /// Initial size of the vertex buffers
+  static constexpr vk::DeviceSize INITIAL_VERTEX_BYTES = 4 * 1024 * 1024;
+
+  /// Initial size of the index buffer
+  static constexpr vk::DeviceSize INITIAL_INDEX_BYTES = 2 * 1024 * 1024;
+
+  /**
+   * Create an empty arena for a renderer with the given number of frames in
+   * flight. Buffers are only allocated when first needed, and copied when
+   * growing with commands from the given pool.
+   */
+  GeometryArena(const Device &device,
+                const vk::raii::CommandPool &pool,
+                size_t framesInFlight);
+  GeometryArena(const GeometryArena &) = delete;
+  GeometryArena(GeometryArena &&) = delete;
+
+  GeometryArena &operator=(const GeometryArena &) = delete;
+  GeometryArena &operator=(GeometryArena &&) = delete;
+
+  /// Allocate room for the given number of vertices in the given layout
+  Allocation allocateVertices(VertexLayout layout, size_t count);
+
+  /// Allocate room for the given number of indices of the given type
+  Allocation allocateIndices(vk::IndexType type, size_t count);
+
+  /**
+   * Buffer holding the vertices in the given layout. It is replaced when
+   * growing, so it should only be bound after all meshes to draw are synced.
+   */
+  const Buffer &vertexBuffer(VertexLayout layout) const
+  {
+    return m_vertexPools[static_cast<size_t>(layout)].buffer;
+  }
+
+  /// Buffer holding the indices, same as `vertexBuffer`
+  const Buffer &indexBuffer() const { return m_indexPool.buffer; }
+
+  /**
+   * Give back the slices released before the oldest frame in flight began. To
+   * be called each time a frame begins, once the frame that previously used
+   * its resources has completed.
+   */
+  void collect();
+
+  /// Bytes allocated from all buffers, counting released slices not yet given
+  /// back
+  vk::DeviceSize usedBytes() const;
+
+  /// Total size of all buffers, in bytes
+  vk::DeviceSize capacityBytes() const;
+
+  /// Number of free blocks in all buffers, a measure of their fragmentation
+  size_t freeBlocks() const;
+
+ private:
+  struct Block {
+    vk::DeviceSize offset;
+    vk::DeviceSize size;
+  };
+
+  struct Released {
+    Block block;
+    size_t frames;  // Begun since the release
+  };
+
+  struct Pool {
+    vk::BufferUsageFlags usage;
+    vk::DeviceSize initialSize;
+    Buffer buffer = nullptr;
+    vk::DeviceSize capacity = 0;
+    vk::DeviceSize used = 0;
+    std::vector<Block> free;  // Sorted by offset, never adjacent
+    std::vector<Released> released;
+
+    // Allocate from the free blocks, false if none is large enough
+    bool take(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize &offset);
+
+    // Add a range to the free blocks, merging it with adjacent ones
+    void give(vk::DeviceSize offset, vk::DeviceSize size);
+  };
+
+  const Device *m_device;
+  const vk::raii::CommandPool *m_commandPool;
+  size_t m_framesInFlight;
+  std::array<Pool, 2> m_vertexPools;  // Indexed by VertexLayout
+  Pool m_indexPool;
+
+  Allocation allocate(Pool &pool, vk::DeviceSize size, vk::DeviceSize alignment);
+  void grow(Pool &pool, vk::DeviceSize size);
+};
+
+}  // namespace seng::rendering
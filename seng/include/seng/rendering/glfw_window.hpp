@@ -2,6 +2,7 @@
 
 #include <seng/hook.hpp>
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -75,6 +76,8 @@ class GlfwWindow {
 
   // getters for various properties
   const std::string &appName() const { return m_appName; }
+
+  // Last known framebuffer size, safe to read from any thread
   unsigned int width() const { return m_width; }
   unsigned int height() const { return m_height; }
 
@@ -99,7 +102,7 @@ class GlfwWindow {
  private:
   GLFWwindow *m_ptr;
   std::string m_appName;
-  unsigned int m_width, m_height;
+  std::atomic<unsigned int> m_width, m_height;
 
   Hook<GlfwWindow *, int, int> m_resize;
   Hook<GlfwWindow *, int, int, int, int> m_keyEvent;
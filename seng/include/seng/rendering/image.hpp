@@ -1,5 +1,7 @@
 #pragma once
 
+#include <seng/rendering/memory_allocator.hpp>
+
 #include <vulkan/vulkan_raii.hpp>
 
 #include <cstdint>
@@ -78,9 +80,12 @@ class Image {
   void stealView(vk::raii::ImageView &&view) { m_view = std::move(view); }
 
   /**
-   * Copy contents of the given buffer into this image.
+   * Copy contents of the given buffer, starting at the given offset, into this
+   * image.
    */
-  void copyFromBuffer(const CommandBuffer &commandBuf, const Buffer &buf) const;
+  void copyFromBuffer(const CommandBuffer &commandBuf,
+                      const Buffer &buf,
+                      vk::DeviceSize offset = 0) const;
 
   /**
    * Transition the layout of this image from the old layout to the new one.
@@ -103,7 +108,7 @@ class Image {
   vk::Extent3D m_extent;
   uint32_t m_mipLevels;
   vk::raii::Image m_handle;
-  vk::raii::DeviceMemory m_memory;
+  MemoryAllocator::Allocation m_memory;
 
   vk::Image m_unmanaged;
 
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace seng::rendering {
+
+class Device;
+
+/**
+ * Allocator of device memory for buffers and images, so that they don't need an
+ * allocation each, which drivers limit in number and are slow to make.
+ *
+ * Memory is allocated in big blocks, which are then split between resources
+ * with a buddy allocator: each block is split in halves, which are split in
+ * halves again and so on down to the size of the request (rounded up to a power
+ * of two, at least MIN_ALLOCATION bytes). Since the resulting ranges are aligned
+ * to their size, alignment requirements are satisfied by rounding the size up
+ * to them. When a range is freed it is merged back with its buddy, if free too.
+ *
+ * Blocks are kept separately for each memory type, and for linear (buffers)
+ * and optimal (most images) resources, so that they never need to be spaced by
+ * `bufferImageGranularity`. Blocks are MAX_BLOCK_SIZE bytes, halved until they
+ * are at most an eighth of their heap. Requests bigger than half a block, or
+ * asking for it explicitly (e.g. framebuffer attachments), get a dedicated
+ * allocation instead.
+ *
+ * Host-visible memory is mapped once, when allocated, and stays mapped.
+ *
+ * It is not copyable nor movable, since allocations point back to it.
+ */
+class MemoryAllocator {
+ private:
+  struct Block;
+
+ public:
+  /**
+   * A range of device memory, given back to the allocator when destroyed. It
+   * must not outlive it.
+   *
+   * It is movable, not copyable.
+   */
+  class Allocation {
+   public:
+    /// Create an empty allocation
+    Allocation(std::nullptr_t);
+    Allocation(const Allocation &) = delete;
+    Allocation(Allocation &&other) noexcept;
+    ~Allocation();
+
+    Allocation &operator=(const Allocation &) = delete;
+    Allocation &operator=(Allocation &&other) noexcept;
+
+    /// Return false for empty allocations
+    bool valid() const { return m_allocator != nullptr; }
+
+    /// Memory the range is in, to be bound at `offset()`
+    vk::DeviceMemory memory() const;
+    vk::DeviceSize offset() const { return m_offset; }
+    vk::DeviceSize size() const { return m_size; }
+
+    /// Host address of the range, nullptr if not host-visible
+    void *mapped() const;
+
+    /// Make host writes visible to the device, if the memory is not coherent
+    void flush() const;
+
+   private:
+    MemoryAllocator *m_allocator;
+    Block *m_block;
+    vk::DeviceSize m_offset;
+    vk::DeviceSize m_size;
+    uint32_t m_order;  // Of the range in the block, unused if dedicated
+
+    void release();
+
+    friend class MemoryAllocator;
+  };
+
+  /// Snapshot of the state of the allocator
+  struct Stats {
+    size_t blocks = 0;                  ///< Blocks split between resources
+    size_t allocations = 0;             ///< Ranges allocated from blocks
+    size_t dedicated = 0;               ///< Dedicated allocations
+    vk::DeviceSize blockBytes = 0;      ///< Total size of blocks
+    vk::DeviceSize usedBytes = 0;       ///< Allocated from blocks, rounded up
+    vk::DeviceSize requestedBytes = 0;  ///< Allocated from blocks, as requested
+    vk::DeviceSize dedicatedBytes = 0;  ///< Total size of dedicated allocations
+    vk::DeviceSize largestFreeRange = 0;
+
+    vk::DeviceSize freeBytes() const { return blockBytes - usedBytes; }
+
+    /// 0 if the free space of all blocks is a single range, close to 1 if it is
+    /// split in many small ones
+    float fragmentation() const
+    {
+      vk::DeviceSize free = freeBytes();
+      return free == 0 ? 0.0f : 1.0f - float(largestFreeRange) / float(free);
+    }
+  };
+
+  static constexpr vk::DeviceSize MAX_BLOCK_SIZE = 64 * 1024 * 1024;
+  static constexpr vk::DeviceSize MIN_ALLOCATION = 256;
+
+  /// Create an allocator for the given device, without allocating anything
+  MemoryAllocator(const Device &device);
+  MemoryAllocator(const MemoryAllocator &) = delete;
+  MemoryAllocator(MemoryAllocator &&) = delete;
+  ~MemoryAllocator();
+
+  MemoryAllocator &operator=(const MemoryAllocator &) = delete;
+  MemoryAllocator &operator=(MemoryAllocator &&) = delete;
+
+  /**
+   * Allocate memory meeting the given requirements from a memory type with the
+   * given properties. `linear` tells whether it is for a buffer or linearly
+   * tiled image. Throws a runtime_error if no suitable memory type exists or
+   * the device is out of memory.
+   */
+  Allocation allocate(const vk::MemoryRequirements &requirements,
+                      vk::MemoryPropertyFlags flags,
+                      bool linear,
+                      bool dedicated = false);
+
+  /// Return the current statistics
+  Stats stats() const;
+
+ private:
+  struct Block {
+    vk::raii::DeviceMemory memory;
+    vk::DeviceSize size;
+    void *mapped;
+    uint32_t memoryType;
+    bool linear;
+    bool coherent;
+    bool dedicated;
+
+    // Offsets of the free ranges of each order, ranges of order `o` being
+    // MIN_ALLOCATION << o bytes. Empty for dedicated allocations.
+    std::vector<std::set<vk::DeviceSize>> free;
+    size_t allocations = 0;
+    vk::DeviceSize used = 0;
+    vk::DeviceSize requested = 0;
+  };
+
+  const Device *m_device;
+  vk::PhysicalDeviceMemoryProperties m_properties;
+  vk::DeviceSize m_atomSize;
+  std::vector<vk::DeviceSize> m_blockSizes;  // Indexed by memory type
+
+  mutable std::mutex m_mutex;
+  std::vector<std::unique_ptr<Block>> m_blocks;
+
+  Block &createBlock(uint32_t memoryType,
+                     vk::DeviceSize size,
+                     bool linear,
+                     bool dedicated);
+  void free(Allocation &allocation);
+};
+
+}  // namespace seng::rendering
@@ -5,6 +5,7 @@
 
 #include <vulkan/vulkan_raii.hpp>
 
+#include <cstdint>
 #include <vector>
 
 namespace seng::rendering {
@@ -13,17 +14,6 @@ class CommandBuffer;
 class Renderer;
 class RenderPass;
 
-/// Struct that is sized exactly 128 bytes holding representing the push constant
-/// range
-struct PushConstants {
-  glm::mat4 modelMatrix;
-  alignas(16) glm::vec2 uvScale;
-
-  glm::vec4 _reserved1;
-  glm::vec4 _reserved2;
-  glm::vec4 _reserved3;
-};
-
 /**
  * Wrapper around a vulkan pipline. It implements the RAII pattern, meaning that
  * instantiation allocates a new pipline, while destruction deallocates it.
@@ -32,12 +22,18 @@ class Pipeline {
  public:
   /**
    * A small helper that contains information useful for pipeline createion.
+   *
+   * If `instanceStride` is not 0, a second binding, InstanceData::BINDING, is
+   * added which advances once per instance. Attributes for both bindings go in
+   * `attributes`.
    */
   struct CreateInfo {
-    AttributeDescriptions& attributes;
+    std::vector<vk::VertexInputAttributeDescription>& attributes;
+    uint32_t vertexStride;
     std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts;
     std::vector<vk::PipelineShaderStageCreateInfo>& stages;
     bool wireframe = false;
+    uint32_t instanceStride = 0;
   };
 
   /**
@@ -2,12 +2,16 @@
 
 #include <cstddef>
 #include <seng/hashes.hpp>
+#include <seng/math.hpp>
 #include <seng/utils.hpp>
 
+#include <glm/gtc/packing.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 #include <vulkan/vulkan.hpp>
 
+#include <cstdint>
+
 namespace seng::rendering {
 
 /**
@@ -71,6 +75,120 @@ struct Vertex {
   }
 };
 
+/**
+ * Compact vertex format, 24 bytes instead of the 56 of Vertex. The color is
+ * dropped, since it is always white, normal and tangent are octahedral-encoded
+ * in two 16 bit normalized integers each and UV coordinates are stored as half
+ * floats.
+ */
+struct PackedVertex {
+  glm::vec3 pos;
+  uint32_t normal;    ///< Octahedral encoding, as two snorm16
+  uint32_t tangent;   ///< Octahedral encoding, as two snorm16
+  uint32_t texCoord;  ///< Two half floats
+
+  static constexpr size_t ATTRIBUTE_COUNT = 4;
+
+  /**
+   * Attribute description (in order):
+   *
+   * 0. vec3<float> position
+   * 1. vec2<snorm16> octahedral-encoded normal
+   * 2. vec2<snorm16> octahedral-encoded tangent vector
+   * 3. vec2<half> UV coordinates
+   */
+  static std::array<vk::VertexInputAttributeDescription, ATTRIBUTE_COUNT>
+  attributeDescriptions()
+  {
+    std::array<vk::VertexInputAttributeDescription, ATTRIBUTE_COUNT> descs;
+
+    descs[0].binding = 0;
+    descs[0].location = 0;
+    descs[0].format = vk::Format::eR32G32B32Sfloat;
+    descs[0].offset = offsetof(PackedVertex, pos);
+
+    descs[1].binding = 0;
+    descs[1].location = 1;
+    descs[1].format = vk::Format::eR16G16Snorm;
+    descs[1].offset = offsetof(PackedVertex, normal);
+
+    descs[2].binding = 0;
+    descs[2].location = 2;
+    descs[2].format = vk::Format::eR16G16Snorm;
+    descs[2].offset = offsetof(PackedVertex, tangent);
+
+    descs[3].binding = 0;
+    descs[3].location = 3;
+    descs[3].format = vk::Format::eR16G16Sfloat;
+    descs[3].offset = offsetof(PackedVertex, texCoord);
+
+    return descs;
+  }
+
+  /// Pack the given vertex, its color is ignored
+  static PackedVertex pack(const Vertex& v)
+  {
+    PackedVertex ret;
+    ret.pos = v.pos;
+    ret.normal = glm::packSnorm2x16(octEncode(v.normal));
+    ret.tangent = glm::packSnorm2x16(octEncode(v.tangent));
+    ret.texCoord = glm::packHalf2x16(v.texCoord);
+    return ret;
+  }
+};
+
+/**
+ * Per-instance data of a draw, read from a second vertex buffer that advances
+ * once per instance instead of once per vertex.
+ */
+struct InstanceData {
+  glm::mat4 model;
+  alignas(16) glm::vec2 uvScale;
+
+  /// Binding the instance buffer goes in, the vertex buffer is in binding 0
+  static constexpr uint32_t BINDING = 1;
+
+  /// Location of the first instance attribute, after the ones of all vertex formats
+  static constexpr uint32_t FIRST_LOCATION = 8;
+
+  static constexpr size_t ATTRIBUTE_COUNT = 5;
+
+  /**
+   * Attribute description (in order, starting from FIRST_LOCATION):
+   *
+   * 0-3. vec4<float> columns of the model matrix
+   * 4.   vec2<float> UV scale
+   */
+  static std::array<vk::VertexInputAttributeDescription, ATTRIBUTE_COUNT>
+  attributeDescriptions()
+  {
+    std::array<vk::VertexInputAttributeDescription, ATTRIBUTE_COUNT> descs;
+
+    for (uint32_t i = 0; i < 4; i++) {
+      descs[i].binding = BINDING;
+      descs[i].location = FIRST_LOCATION + i;
+      descs[i].format = vk::Format::eR32G32B32A32Sfloat;
+      descs[i].offset = offsetof(InstanceData, model) + i * sizeof(glm::vec4);
+    }
+
+    descs[4].binding = BINDING;
+    descs[4].location = FIRST_LOCATION + 4;
+    descs[4].format = vk::Format::eR32G32Sfloat;
+    descs[4].offset = offsetof(InstanceData, uvScale);
+
+    return descs;
+  }
+};
+
+/// Vertex format used for the device copy of a mesh
+enum struct VertexLayout { eFull, ePacked };
+
+/// Return the size of a vertex in the given layout
+inline size_t vertexSize(VertexLayout layout)
+{
+  return layout == VertexLayout::ePacked ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
 // Less verbose and useful in some occasions
 using AttributeDescriptions =
     std::array<vk::VertexInputAttributeDescription, Vertex::ATTRIBUTE_COUNT>;
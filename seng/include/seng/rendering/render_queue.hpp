@@ -0,0 +1,169 @@
+#pragma once
+
+#include <seng/rendering/buffer.hpp>
+#include <seng/rendering/primitive_types.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace seng {
+class Mesh;
+class ObjectShaderInstance;
+}  // namespace seng
+
+namespace seng::rendering {
+
+class CommandBuffer;
+class FrameHandle;
+class Renderer;
+
+/// Everything needed to record the draw of a mesh
+struct DrawItem {
+  const ObjectShaderInstance *instance;
+  const Mesh *mesh;
+  size_t lod;
+  glm::mat4 model;
+  glm::vec2 uvScale;
+};
+
+/**
+ * Per-frame list of draws, recorded in an order that minimizes state changes.
+ *
+ * Each draw gets a 64 bit sort key packing, from the most to the least
+ * significant bits, the pipeline (8 bits), the descriptor sets (16 bits), the
+ * mesh (12 bits), its LOD (4 bits) and the view depth (24 bits) it is drawn
+ * with. Sorting the keys groups draws by pipeline first, then by shader
+ * instance, mesh and LOD, and front to back within the same mesh, so that later
+ * fragments are more likely to fail the depth test. Pipelines, instances and
+ * meshes are numbered in order of first appearance each frame.
+ *
+ * Keys are sorted with an LSD radix sort, skipping the passes over bytes that
+ * are the same for all keys. While recording, pipelines and descriptor sets are
+ * only bound when they differ from the previous draw. All meshes live in the
+ * renderer's GeometryArena, so vertex and index buffers are only bound again
+ * when the vertex layout or the index type changes.
+ *
+ * Consecutive draws of the same mesh and LOD with the same shader instance are
+ * recorded as a single instanced draw. The model matrix and UV scale of each
+ * draw are written, in sorted order, to a host-visible buffer bound at
+ * InstanceData::BINDING, one per frame in flight, which grows as needed.
+ *
+ * When the device supports it, the draws are not recorded one by one: their
+ * parameters are written to an indirect buffer instead, and all consecutive
+ * ones using the same pipeline, descriptor sets and index type are issued with
+ * a single indirect draw. Each draw's first instance points to its slice of the
+ * instance buffer, so shaders find their data as before.
+ *
+ * It is not copyable nor movable.
+ */
+class RenderQueue {
+ public:
+  /// What recording a queue took
+  struct Stats {
+    size_t draws = 0;      ///< Instanced draws
+    size_t instances = 0;  ///< Objects drawn by them
+    size_t calls = 0;      ///< Draw commands recorded, direct or indirect
+    size_t pipelineBinds = 0;
+    size_t descriptorBinds = 0;
+    size_t bufferBinds = 0;  ///< Vertex and index buffers
+
+    /// Binds skipped compared to binding everything for each draw
+    size_t bindsSaved() const
+    {
+      return 4 * draws - pipelineBinds - descriptorBinds - bufferBinds;
+    }
+  };
+
+  /// Create an empty queue drawing with the given renderer
+  explicit RenderQueue(Renderer &renderer);
+  RenderQueue(const RenderQueue &) = delete;
+  RenderQueue(RenderQueue &&) = delete;
+
+  RenderQueue &operator=(const RenderQueue &) = delete;
+  RenderQueue &operator=(RenderQueue &&) = delete;
+
+  /**
+   * Pack the given fields in a sort key, ids too big for their field wrap
+   * around, LODs are clamped
+   */
+  static uint64_t makeKey(uint32_t pipeline,
+                          uint32_t descriptorSets,
+                          uint32_t mesh,
+                          size_t lod,
+                          float depth);
+
+  /// Number of draws in the queue
+  size_t size() const { return m_items.size(); }
+
+  /// Remove all draws
+  void clear();
+
+  /**
+   * Add a draw at the given view space depth. The mesh must already be synced
+   * and its vertex layout supported by the instance's shader.
+   */
+  void push(const DrawItem &item, float depth);
+
+  /// Sort the draws by their key
+  void sort();
+
+  /**
+   * Upload the instance data and the indirect draws of the given frame and
+   * record all draws, in sorted order, into the given command buffer, which
+   * must be inside of a render pass. The instance buffer is left bound.
+   */
+  Stats record(const FrameHandle &handle, const CommandBuffer &cmd);
+
+ private:
+  // Host-visible buffers, one per frame in flight, with their capacity in bytes
+  struct FrameBuffers {
+    FrameBuffers(vk::BufferUsageFlags flags, size_t frames);
+
+    vk::BufferUsageFlags usage;
+    std::vector<Buffer> buffers;
+    std::vector<vk::DeviceSize> capacities;
+  };
+
+  // Draws sharing pipeline, descriptor sets and buffers, from the item of the
+  // first
+  struct Run {
+    uint32_t item;
+    uint32_t firstCommand;
+    uint32_t commandCount;
+  };
+
+  Renderer *m_renderer;
+  uint32_t m_maxDrawIndirectCount;
+
+  FrameBuffers m_instanceBuffers;
+  FrameBuffers m_indirectBuffers;
+  std::vector<InstanceData> m_instances;
+  std::vector<vk::DrawIndexedIndirectCommand> m_commands;
+  std::vector<Run> m_runs;
+
+  std::vector<DrawItem> m_items;
+  std::vector<uint64_t> m_keys;
+  std::vector<uint32_t> m_order;
+
+  // Scratch space for sorting
+  std::vector<uint64_t> m_tmpKeys;
+  std::vector<uint32_t> m_tmpOrder;
+
+  // Ids given to pipelines, shader instances and meshes this frame
+  std::unordered_map<const void *, uint32_t> m_pipelineIds;
+  std::unordered_map<const void *, uint32_t> m_instanceIds;
+  std::unordered_map<const void *, uint32_t> m_meshIds;
+
+  void build(Stats &stats);
+  const Buffer &upload(FrameBuffers &buffers,
+                       const FrameHandle &handle,
+                       const void *data,
+                       vk::DeviceSize size);
+};
+
+}  // namespace seng::rendering
@@ -5,10 +5,12 @@
 #include <seng/rendering/command_buffer.hpp>
 #include <seng/rendering/debug_messenger.hpp>
 #include <seng/rendering/device.hpp>
+#include <seng/rendering/geometry_arena.hpp>
 #include <seng/rendering/global_uniform.hpp>
 #include <seng/rendering/image.hpp>
 #include <seng/rendering/render_pass.hpp>
 #include <seng/rendering/swapchain.hpp>
+#include <seng/rendering/uploader.hpp>
 #include <seng/resources/mesh.hpp>
 #include <seng/resources/shader_cache.hpp>
 #include <seng/resources/texture.hpp>
@@ -20,6 +22,7 @@
 #include <vulkan/vulkan_raii.hpp>
 
 #include <cstdint>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -151,6 +154,18 @@ class Renderer {
    */
   void clearDescriptorSets();
 
+  /**
+   * Uploader executing the UploadBatches of meshes and textures. Like the
+   * geometry arena, it is mutable even through a const renderer.
+   */
+  Uploader &uploader() const { return *m_uploader; }
+
+  /**
+   * Arena the device copies of all meshes are allocated from. It is mutable
+   * even through a const renderer, since that is all meshes hold.
+   */
+  GeometryArena &geometry() const { return *m_geometry; }
+
   /**
    * Fetch the mesh with the given name from the mesh cache. If such mesh cannot
    * be found, load it from disk and save it in cache for later use.
@@ -159,6 +174,15 @@ class Renderer {
    */
   Mesh &requestMesh(const std::string &name);
 
+  /// Return true if the mesh with the given name is in cache
+  bool hasMesh(const std::string &name) const;
+
+  /**
+   * Save the given mesh in cache with the given name, replacing any other with
+   * the same name.
+   */
+  Mesh &insertMesh(const std::string &name, Mesh mesh);
+
   /**
    * Delete the mesh with the given name from cache.
    */
@@ -185,6 +209,15 @@ class Renderer {
    */
   const Texture &requestTexture(const std::string &name, TextureType type);
 
+  /// Return true if the texture with the given name and type is in cache
+  bool hasTexture(const std::string &name, TextureType type) const;
+
+  /**
+   * Save the given texture in cache with the given name and type, replacing any
+   * other with the same name and type.
+   */
+  const Texture &insertTexture(const std::string &name, TextureType type, Texture tex);
+
   /**
    * Delete the texture with the given name from cache.
    */
@@ -273,6 +306,7 @@ class Renderer {
   // Pools
   vk::raii::CommandPool m_commandPool;
   vk::raii::DescriptorPool m_descriptorPool;
+  std::unique_ptr<Uploader> m_uploader;
 
   // Renderpasses
   RenderPass m_renderPass;
@@ -285,7 +319,8 @@ class Renderer {
   // Descriptor layout cache
   std::unordered_map<size_t, vk::raii::DescriptorSetLayout> m_layoutCache;
 
-  // Mesh cache
+  // Mesh cache, with the arena their device copies live in
+  std::unique_ptr<GeometryArena> m_geometry;
   std::unordered_map<std::string, Mesh> m_meshes;
   Mesh m_fallbackMesh;
 
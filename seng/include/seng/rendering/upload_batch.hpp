@@ -0,0 +1,85 @@
+#pragma once
+
+#include <seng/rendering/buffer.hpp>
+#include <seng/rendering/uploader.hpp>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace seng::rendering {
+
+class CommandBuffer;
+
+/**
+ * Collects transfers of host data into device resources, so that they can all be
+ * executed with a single command buffer submission.
+ *
+ * Data is copied into the Uploader's staging ring as soon as it is added, so
+ * the source can be freed right away. Data too big for the ring gets a staging
+ * buffer of its own, kept alive until the transfers complete. `submit()` records
+ * all transfers and submits them through the Uploader, without waiting for their
+ * completion.
+ *
+ * It is not copyable nor movable.
+ */
+class UploadBatch {
+ public:
+  explicit UploadBatch(Uploader &uploader);
+  UploadBatch(const UploadBatch &) = delete;
+  UploadBatch(UploadBatch &&) = delete;
+  ~UploadBatch();
+
+  UploadBatch &operator=(const UploadBatch &) = delete;
+  UploadBatch &operator=(UploadBatch &&) = delete;
+
+  /// Number of transfers recorded so far
+  size_t size() const { return m_commands.size(); }
+
+  /// Total size of the data staged so far, in bytes
+  vk::DeviceSize stagedBytes() const { return m_stagedBytes; }
+
+  /**
+   * Stage `size` bytes from `data` to be copied into `dst` at the given offset.
+   */
+  void copy(const void *data,
+            vk::DeviceSize size,
+            const Buffer &dst,
+            vk::DeviceSize offset = 0);
+
+  /**
+   * Stage `size` bytes from `data` and return where, so that they can be
+   * referenced by commands added with `record` (e.g. for image uploads).
+   */
+  Uploader::Staged stage(const void *data, vk::DeviceSize size);
+
+  /**
+   * Add the given function to those called when recording the command buffer.
+   * Functions are called in the order they were added. Since they may do more
+   * than transfers, batches with any are submitted to the graphics queue.
+   */
+  void record(std::function<void(CommandBuffer &)> commands);
+
+  /**
+   * Record all transfers into a single command buffer and submit it, without
+   * waiting. The batch is empty afterwards.
+   */
+  void submit();
+
+ private:
+  Uploader *m_uploader;
+  std::optional<uint64_t> m_pin;
+
+  // Deque, so that references to the staging buffers stay valid
+  std::deque<Buffer> m_staging;
+  std::vector<std::function<void(CommandBuffer &)>> m_commands;
+  vk::DeviceSize m_stagedBytes = 0;
+  bool m_graphics = false;
+};
+
+}  // namespace seng::rendering
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <seng/rendering/buffer.hpp>
+#include <seng/rendering/command_buffer.hpp>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <set>
+#include <vector>
+
+namespace seng::rendering {
+
+class Device;
+
+/**
+ * Executes the transfers collected by UploadBatches, without making the caller
+ * wait for them to complete.
+ *
+ * Data is staged in a persistent staging ring: a mapped host-visible buffer
+ * that is written front to back, wrapping around at the end. Each submission
+ * remembers how far the ring was written when it was made, and that space is
+ * given back once its fence signals. Batches pin the ring where they started
+ * staging until their own submission completes, so that batches that were
+ * submitted after them, but completed first, don't give back their data. The
+ * caller only waits when the ring is full, for the oldest submissions to
+ * complete.
+ *
+ * Batches only copying between buffers are submitted to the device's
+ * dedicated transfer queue, if it has one, so that they run alongside
+ * rendering. They signal a semaphore, which the renderer hands to the next
+ * frame to wait on before its vertex and shader stages. Other batches (e.g.
+ * image layout transitions and blits) are submitted to the graphics queue,
+ * ending with a barrier making their writes visible to later draws.
+ *
+ * It is not copyable nor movable.
+ */
+class Uploader {
+ public:
+  /// Where some data has been staged
+  struct Staged {
+    const Buffer *buffer;
+    vk::DeviceSize offset;
+  };
+
+  /// Size of the staging ring
+  static constexpr vk::DeviceSize RING_SIZE = 32 * 1024 * 1024;
+
+  /// Alignment of the staged data
+  static constexpr vk::DeviceSize ALIGNMENT = 16;
+
+  /// Stages that wait for uploads before reading what they wrote
+  static constexpr vk::PipelineStageFlags WAIT_STAGES =
+      vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader |
+      vk::PipelineStageFlagBits::eFragmentShader;
+
+  /// Create an uploader with an empty ring
+  explicit Uploader(const Device &device);
+  Uploader(const Uploader &) = delete;
+  Uploader(Uploader &&) = delete;
+  ~Uploader();
+
+  Uploader &operator=(const Uploader &) = delete;
+  Uploader &operator=(Uploader &&) = delete;
+
+  const Device &device() const { return *m_device; }
+
+  /// Staging ring, used by the Staged returned by `stage`
+  const Buffer &ring() const { return m_ring; }
+
+  /// Bytes of the ring in use by pending submissions or open batches
+  vk::DeviceSize ringUsage() const { return m_head - m_tail; }
+
+  /// Number of submissions that haven't been seen completing yet
+  size_t pendingSubmissions() const { return m_pending.size(); }
+
+  /**
+   * Keep the ring from being given back past the current position, until
+   * `unpin` is called with the returned value.
+   */
+  uint64_t pin();
+  void unpin(uint64_t pin);
+
+  /**
+   * Copy `size` bytes from `data` into the ring and return their offset in it,
+   * waiting for pending submissions to complete if there isn't enough space.
+   * Return nullopt if the data does not fit even then.
+   */
+  std::optional<vk::DeviceSize> stage(const void *data, vk::DeviceSize size);
+
+  /**
+   * Record the given commands into a command buffer, in order, and submit it
+   * without waiting. If `graphics` is false, it may go to the transfer queue.
+   * The given buffers are kept alive, and the given pin held, until the
+   * submission has completed.
+   */
+  void submit(const std::vector<std::function<void(CommandBuffer &)>> &commands,
+              bool graphics,
+              std::deque<Buffer> &&keepAlive,
+              std::optional<uint64_t> pin);
+
+  /**
+   * Give back the ring space and the resources of completed submissions,
+   * without waiting.
+   */
+  void collect();
+
+  /// Wait for all pending submissions, then collect them
+  void waitIdle();
+
+  /**
+   * Add to `semaphores` those signaled by transfer queue submissions that no
+   * frame waited on yet, which the given frame will wait on.
+   */
+  void takeSemaphores(size_t frame, std::vector<vk::Semaphore> &semaphores);
+
+  /// Recycle the semaphores the given frame waited on, once it has completed
+  void frameCompleted(size_t frame);
+
+ private:
+  struct Submission {
+    CommandBuffer commandBuffer;
+    vk::raii::Fence fence;
+    uint64_t end;  // Position of the ring head when submitted
+    std::deque<Buffer> keepAlive;
+    std::optional<uint64_t> pin;
+  };
+
+  const Device *m_device;
+  vk::raii::CommandPool m_graphicsPool;
+  vk::raii::CommandPool m_transferPool;  // Null without a dedicated queue
+
+  // Head and tail grow forever, the position in the ring is their remainder
+  Buffer m_ring;
+  uint64_t m_head = 0;
+  uint64_t m_tail = 0;
+  std::multiset<uint64_t> m_pins;
+
+  std::deque<Submission> m_pending;
+
+  std::vector<vk::raii::Semaphore> m_freeSemaphores;
+  std::vector<vk::raii::Semaphore> m_signaledSemaphores;
+  std::vector<std::vector<vk::raii::Semaphore>> m_frameSemaphores;
+
+  std::optional<vk::DeviceSize> reserve(vk::DeviceSize size);
+  void retire();
+};
+
+}  // namespace seng::rendering
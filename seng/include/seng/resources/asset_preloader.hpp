@@ -0,0 +1,92 @@
+#pragma once
+
+#include <seng/jobs/job_system.hpp>
+#include <seng/resources/mesh.hpp>
+#include <seng/resources/texture.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace seng {
+
+class Application;
+class Scene;
+
+/**
+ * Loads all the meshes and textures used by a scene before it is rendered, so
+ * that they don't have to be loaded lazily during its first frames.
+ *
+ * Usage is split in three phases:
+ *
+ * 1. `add` collects the assets referenced by the MeshRenderers of a scene and by
+ *    the shader instances they use. It does not touch the renderer, so it can be
+ *    called from any thread.
+ * 2. `start` schedules the decoding of every asset that is not already cached on
+ *    the job system, one job per asset.
+ * 3. Once `decoded` returns true, `upload` sends all decoded assets to the device
+ *    in a single batch and saves them in the renderer's caches.
+ *
+ * `start` and `upload` touch the renderer's caches, so they must be called from
+ * the main thread. The decoding time of each asset and the upload time are logged.
+ *
+ * It is not copyable nor movable.
+ */
+class AssetPreloader {
+ public:
+  AssetPreloader(const Application &app);
+  AssetPreloader(const AssetPreloader &) = delete;
+  AssetPreloader(AssetPreloader &&) = delete;
+  ~AssetPreloader();
+
+  AssetPreloader &operator=(const AssetPreloader &) = delete;
+  AssetPreloader &operator=(AssetPreloader &&) = delete;
+
+  /// Collect the assets used by the given scene
+  void add(Scene &scene);
+
+  /// Start decoding the collected assets that are not already in cache
+  void start();
+
+  /// Number of assets being loaded
+  size_t assetCount() const { return m_meshes.size() + m_textures.size(); }
+
+  /// Number of assets that have already been decoded
+  size_t decodedCount() const { return m_decoded; }
+
+  /// Return true once all assets have been decoded
+  bool decoded() const { return m_started && m_counter.done(); }
+
+  /// Upload the decoded assets and save them in cache. Blocks until decoded.
+  void upload();
+
+ private:
+  struct MeshAsset {
+    std::string name;
+    std::optional<Mesh> mesh;
+    float seconds = 0.0f;
+  };
+  struct TextureAsset {
+    std::string name;
+    TextureType type;
+    std::optional<Texture::Pixels> pixels;
+    float seconds = 0.0f;
+  };
+
+  const Application *m_app;
+  std::set<std::string> m_meshNames;
+  std::set<std::pair<std::string, TextureType>> m_textureNames;
+
+  // Each decode job writes only to its own asset
+  std::vector<MeshAsset> m_meshes;
+  std::vector<TextureAsset> m_textures;
+  jobs::Counter m_counter;
+  std::atomic<size_t> m_decoded = 0;
+  bool m_started = false;
+};
+
+}  // namespace seng
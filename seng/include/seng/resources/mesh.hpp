@@ -1,19 +1,55 @@
 #pragma once
 
-#include <seng/rendering/buffer.hpp>
+#include <seng/math.hpp>
+#include <seng/rendering/geometry_arena.hpp>
 #include <seng/rendering/primitive_types.hpp>
 
 #include <vulkan/vulkan.hpp>
 
+#include <cstddef>
 #include <cstdint>
-#include <optional>
+#include <string>
 #include <vector>
 
 namespace seng {
 
+class Application;
+
+namespace jobs {
+class JobSystem;
+}
+
 namespace rendering {
 class Renderer;
-}
+class UploadBatch;
+}  // namespace rendering
+
+/**
+ * Parameters for loading meshes from disk.
+ */
+struct MeshLoadOptions {
+  /// Directory where processed meshes are cached, no caching if empty (see
+  /// `mesh_cache.hpp`)
+  std::string cachePath = "";
+
+  /// Reorder triangles and vertices for faster rendering (see `optimizeMesh`)
+  bool optimize = false;
+
+  /// Layout of the vertices on the device. Meshes whose UVs are too big to be
+  /// packed precisely enough are never packed.
+  rendering::VertexLayout layout = rendering::VertexLayout::eFull;
+
+  /// Number of simplified levels of detail to generate, each with about half the
+  /// triangles of the previous one (see `simplifyMesh`). Levels that can't be
+  /// simplified enough are not generated.
+  unsigned int lodLevels = 0;
+
+  /// Job system used to parse big models in parallel, if any
+  jobs::JobSystem *jobs = nullptr;
+
+  /// Return the parameters set in the configuration of the given Application.
+  static MeshLoadOptions fromConfig(const Application &app);
+};
 
 /**
  * A collection of vertices and indices that defines the shape of a 3D model.
@@ -21,17 +57,54 @@ class Renderer;
  *
  * A mesh can be created by reading a 3D model from disk. Onyl OBJ files are supported.
  *
+ * Vertices are always kept in host memory in the full layout, while the device
+ * copy can be packed (see `rendering::VertexLayout`) to save memory and
+ * bandwidth. Packed meshes can only be drawn by shaders supporting them.
+ *
+ * Similarly, indices are uploaded with 16 bits whenever possible. Meshes with
+ * more vertices than that are split in ranges of triangles, each drawn with its
+ * own vertex offset, so that the indices inside each of them fit.
+ *
+ * Meshes can also hold simplified levels of detail (LODs) of themselves. Each
+ * one is a slice of the index buffer drawing the same vertices, split in ranges
+ * as above. The first level is always the full mesh.
+ *
+ * The device copy does not have buffers of its own, vertices and indices are
+ * allocated from the renderer's GeometryArena. Index ranges are relative to the
+ * mesh: draws have to add `firstIndex()` and `vertexOffset()` to them.
+ *
  * It is non-copyable, but movable.
  */
 class Mesh {
  public:
+  /// Triangles drawn with a single indexed draw call. Indices are relative to
+  /// `vertexOffset`.
+  struct IndexRange {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+  };
+
+  /// Level of detail, a slice of the indices
+  struct Lod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+
+    /// Largest distance the surface moved while simplifying it, relative to
+    /// the largest side of the mesh's bounding box
+    float error;
+  };
+
   /// Create an empty mesh
   Mesh(const rendering::Renderer &renderer);
 
-  /// Create a mesh with the given vertices and indices
+  /// Create a mesh with the given vertices and indices, which hold the given
+  /// levels of detail. If there are none, all indices are the first level.
   Mesh(const rendering::Renderer &renderer,
        std::vector<rendering::Vertex> vertices,
-       std::vector<uint32_t> indices);
+       std::vector<uint32_t> indices,
+       rendering::VertexLayout layout = rendering::VertexLayout::eFull,
+       std::vector<Lod> lods = {});
 
   Mesh(const Mesh &) = delete;
   Mesh(Mesh &&) = default;
@@ -42,12 +115,37 @@ class Mesh {
   // Accessors
   const std::vector<rendering::Vertex> &vertices() const { return m_vertices; }
   const std::vector<uint32_t> &indices() const { return m_indices; }
+  rendering::VertexLayout vertexLayout() const { return m_layout; }
+  vk::IndexType indexType() const { return m_indexType; }
+  const std::vector<Lod> &lods() const { return m_lods; }
+  size_t lodCount() const { return m_lods.size(); }
+
+  /// Ranges to draw for the given level of detail, which must exist
+  const std::vector<IndexRange> &indexRanges(size_t lod = 0) const
+  {
+    return m_ranges[lod];
+  }
+
+  /// Bounding box of the vertices, in model space
+  const Aabb &bounds() const { return m_bounds; }
 
-  const std::optional<rendering::Buffer> &vertexBuffer() const { return m_vbo; }
-  const std::optional<rendering::Buffer> &indexBuffer() const { return m_ibo; }
+  /// Radius of the bounding sphere of the vertices centered in the bounding box
+  float boundsRadius() const { return m_radius; }
+
+  /// Size in bytes of the vertex and index data on the device
+  size_t deviceSize() const;
+
+  /// Index of the mesh's first vertex in the arena's vertex buffer for its layout
+  int32_t vertexOffset() const
+  {
+    return static_cast<int32_t>(m_vertexAlloc.offset() / rendering::vertexSize(m_layout));
+  }
+
+  /// Index of the mesh's first index in the arena's index buffer
+  uint32_t firstIndex() const;
 
   /// Return true if device buffers are up to date with the ones in host memory
-  bool synced() const { return m_vbo.has_value() && m_ibo.has_value(); }
+  bool synced() const { return m_vertexAlloc.valid() && m_indexAlloc.valid(); }
 
   /**
    * Send the in-host-memory mesh data to the device
@@ -55,27 +153,58 @@ class Mesh {
   void sync();
 
   /**
-   * Clear the vertex and index buffers from the device
+   * Allocate room in the geometry arena and add the upload of the in-host-memory mesh
+   * data to the given batch. The mesh must not be moved nor destroyed until the
+   * batch has been submitted.
+   */
+  void sync(rendering::UploadBatch &batch);
+
+  /**
+   * Give the room of the vertices and indices back to the geometry arena, once
+   * the frames in flight are done drawing from it
    */
   void free();
 
+  /**
+   * Change the layout of the device copy of the vertices. If it is different,
+   * the device buffers are cleared and the mesh needs to be synced again, so it
+   * must not be in use by the device.
+   */
+  void vertexLayout(rendering::VertexLayout layout);
+
   /**
    * Factory method that creates a mesh by loading the model with the given name.
    *
    * Models are searched inside the asset path (defined in ApplicationConfig) and
-   * filename construction is done like this: `${assetPath}/${name}.obj`
+   * filename construction is done like this: `${assetPath}/${name}.obj`. Big
+   * models are parsed in parallel if a JobSystem is given (see `parseObj`) and,
+   * if requested, parsed meshes are optimized (see `optimizeMesh`) and their
+   * levels of detail generated.
+   *
+   * If a cache path is given, the processed mesh is cached there (see
+   * `mesh_cache.hpp`) and read back from it on later loads, as long as the
+   * model has not changed.
+   *
+   * It does not touch the device, so it can be called from any thread.
    */
   static Mesh loadFromDisk(const rendering::Renderer &renderer,
                            const std::string &assetPath,
-                           const std::string &name);
+                           const std::string &name,
+                           const MeshLoadOptions &opts = {});
 
  private:
   const rendering::Renderer *m_renderer;
   std::vector<rendering::Vertex> m_vertices;
   std::vector<uint32_t> m_indices;
-
-  std::optional<rendering::Buffer> m_vbo;
-  std::optional<rendering::Buffer> m_ibo;
+  rendering::VertexLayout m_layout;
+  vk::IndexType m_indexType;
+  std::vector<Lod> m_lods;
+  std::vector<std::vector<IndexRange>> m_ranges;
+  Aabb m_bounds;
+  float m_radius;
+
+  rendering::GeometryArena::Allocation m_vertexAlloc;
+  rendering::GeometryArena::Allocation m_indexAlloc;
 };
 
 };  // namespace seng
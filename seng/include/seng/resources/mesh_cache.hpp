@@ -0,0 +1,96 @@
+#pragma once
+
+#include <seng/rendering/primitive_types.hpp>
+#include <seng/resources/mesh.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace seng {
+
+/**
+ * Layout of cached mesh files (`.smesh`).
+ *
+ * A cached mesh holds the vertices and indices of a model exactly as they are
+ * after loading it from its source file (deduplicated, with tangents and, if
+ * flagged so, optimized), so that they can be copied out without any
+ * processing. Indices include those of the levels of detail, if any were
+ * requested. It is valid only for the source
+ * file it was produced from, identified by its path and the hash of its contents.
+ *
+ * The file is a `Header`, followed by the source path padded to 4 bytes, the
+ * `Lod` array, the `rendering::Vertex` array and the `uint32_t` index array, in
+ * native byte order.
+ */
+namespace smesh {
+
+constexpr char MAGIC[4] = {'S', 'M', 'S', 'H'};
+constexpr uint32_t VERSION = 4;
+
+/// The mesh has been run through `optimizeMesh`
+constexpr uint32_t FLAG_OPTIMIZED = 1;
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint64_t sourceHash;   ///< FNV-1a hash of the source file contents
+  uint32_t vertexSize;   ///< Size of `rendering::Vertex` when the file was written
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  uint32_t pathLength;   ///< Length of the source path, without padding
+  uint32_t flags;        ///< Combination of the `FLAG_*` constants
+  uint32_t lodLevels;    ///< Levels of detail requested when generating them
+  uint32_t lodCount;     ///< Levels of detail stored, zero if none were requested
+};
+
+/// A level of detail, whose indices follow those of the previous one
+struct Lod {
+  uint32_t indexCount;
+  float error;
+};
+
+}  // namespace smesh
+
+/**
+ * Return the path of the cache file for the model at `modelPath`, inside the
+ * given cache directory. The name is derived from the hash of the model path.
+ */
+std::string meshCacheFile(const std::string &cacheDir, const std::string &modelPath);
+
+/**
+ * Read the mesh data cached in `cacheFile` into the given vectors. The file is
+ * memory-mapped and its arrays copied out as they are.
+ *
+ * Returns false, leaving the vectors untouched, if the file does not exist,
+ * is invalid or has not been produced from the model at `modelPath` with
+ * contents hashing to `sourceHash`, processed as described by `flags` and with
+ * `lodLevels` levels of detail requested.
+ */
+bool readMeshCache(const std::string &cacheFile,
+                   const std::string &modelPath,
+                   uint64_t sourceHash,
+                   uint32_t flags,
+                   uint32_t lodLevels,
+                   std::vector<rendering::Vertex> &vertices,
+                   std::vector<uint32_t> &indices,
+                   std::vector<Mesh::Lod> &lods);
+
+/**
+ * Write the given mesh data to `cacheFile`, creating its directory if needed.
+ * The file is replaced atomically, so concurrent readers never see a partial
+ * one, and concurrent writers of the same file don't corrupt it: the last one
+ * wins.
+ *
+ * Throws a std::runtime_error if the file can't be written.
+ */
+void writeMeshCache(const std::string &cacheFile,
+                    const std::string &modelPath,
+                    uint64_t sourceHash,
+                    uint32_t flags,
+                    uint32_t lodLevels,
+                    const std::vector<rendering::Vertex> &vertices,
+                    const std::vector<uint32_t> &indices,
+                    const std::vector<Mesh::Lod> &lods);
+
+}  // namespace seng
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <seng/rendering/primitive_types.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace seng {
+
+/// Cache size used for simulations if none is given, in vertices
+constexpr unsigned int DEFAULT_VERTEX_CACHE_SIZE = 16;
+
+/**
+ * Post-transform vertex cache efficiency of an index buffer, as simulated on a
+ * FIFO cache.
+ */
+struct VertexCacheStats {
+  /// Number of vertices transformed, i.e. cache misses
+  size_t transformed = 0;
+
+  /// Average cache miss ratio: transformed vertices per triangle. It goes from
+  /// 3 (no reuse) down to about 0.5 for regular meshes.
+  float acmr = 0.0f;
+
+  /// Average transform to vertex ratio: transformed vertices per vertex. It goes
+  /// down to 1 (each vertex transformed once).
+  float atvr = 0.0f;
+};
+
+/**
+ * Simulate drawing the given triangle list with a FIFO post-transform vertex
+ * cache of the given size and return how well it was used.
+ */
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices,
+                                    size_t vertexCount,
+                                    unsigned int cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+/**
+ * Reorder the triangles of the given list to improve post-transform vertex cache
+ * usage, using Tipsify (Sander et al., "Fast Triangle Reordering for Vertex
+ * Locality and Reduced Overdraw", 2007).
+ *
+ * Returns the index of the first triangle of each cluster, i.e. each sequence of
+ * triangles after which Tipsify had to jump to an unrelated part of the mesh.
+ * Clusters can be reordered freely without affecting cache usage much.
+ */
+std::vector<size_t> optimizeVertexCache(
+    std::vector<uint32_t> &indices,
+    size_t vertexCount,
+    unsigned int cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+/**
+ * Reorder the clusters of the given triangle list, as returned by
+ * `optimizeVertexCache`, so that those facing outwards are drawn first and hide
+ * the ones behind them from most points of view.
+ *
+ * Clusters are first split further wherever the cache miss ratio of the part
+ * before the split is within `threshold` times the one of the whole cluster, so
+ * there are more to sort at a small cache cost. The cache miss ratio of the
+ * whole list never grows more than `threshold` times: if sorting the clusters
+ * would go past it, they are sorted without splitting them, or not at all.
+ */
+void optimizeOverdraw(std::vector<uint32_t> &indices,
+                      const std::vector<rendering::Vertex> &vertices,
+                      const std::vector<size_t> &clusters,
+                      float threshold = 1.05f,
+                      unsigned int cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+/**
+ * Reorder the vertices in the order they are first referenced by the indices,
+ * so that vertex fetches are as sequential as possible. Vertices that are not
+ * referenced are dropped.
+ */
+void optimizeVertexFetch(std::vector<rendering::Vertex> &vertices,
+                         std::vector<uint32_t> &indices);
+
+/**
+ * Run all the passes above on the given mesh, in order, and return the cache
+ * statistics before and after.
+ */
+std::pair<VertexCacheStats, VertexCacheStats> optimizeMesh(
+    std::vector<rendering::Vertex> &vertices, std::vector<uint32_t> &indices);
+
+}  // namespace seng
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <seng/rendering/primitive_types.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace seng {
+
+/**
+ * Simplify the given triangle list down to about `targetIndexCount` indices by
+ * repeatedly collapsing the edge that moves the surface the least, as measured
+ * by quadric error metrics (Garland and Heckbert, "Surface Simplification Using
+ * Quadric Error Metrics", 1997).
+ *
+ * Vertices are only ever collapsed onto other existing vertices, so the returned
+ * list indexes the same vertices. Open borders and attribute seams (i.e. vertices
+ * sharing a position but not their normal or UVs) keep their shape: their
+ * vertices can only slide along them, while vertices where more of them meet are
+ * never moved.
+ *
+ * Simplification stops early, leaving more indices than requested, once the next
+ * collapse would move the surface by more than `maxError`, relative to the
+ * largest side of the mesh's bounding box. If `error` is not null, the largest
+ * error reached is written to it, with the same scale.
+ */
+std::vector<uint32_t> simplifyMesh(const std::vector<rendering::Vertex> &vertices,
+                                   const std::vector<uint32_t> &indices,
+                                   size_t targetIndexCount,
+                                   float maxError,
+                                   float *error = nullptr);
+
+}  // namespace seng
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace seng {
+
+namespace jobs {
+class JobSystem;
+}
+
+/// Indices of a face vertex in the attribute arrays of ObjData, -1 if missing
+struct ObjIndex {
+  int32_t vertex;
+  int32_t normal;
+  int32_t texcoord;
+};
+
+/**
+ * Geometry read from an OBJ file.
+ *
+ * Attributes are stored flattened, three floats per position and normal, two per
+ * texture coordinate. Faces are triangulated as fans and all of them, no matter
+ * the object or group, are stored in file order, three indices per triangle.
+ */
+struct ObjData {
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::vector<float> texcoords;
+  std::vector<ObjIndex> indices;
+};
+
+/**
+ * Parse the OBJ file at the given path.
+ *
+ * Only geometry is read (`v`, `vn`, `vt` and `f` statements), everything else
+ * (objects, groups, materials, lines, ...) is ignored. Negative (relative) indices
+ * are supported.
+ *
+ * The file is memory-mapped and, if a JobSystem is given, big files are split in
+ * line-aligned chunks that are parsed in parallel. The result does not depend on
+ * how the file is split.
+ *
+ * Throws a std::runtime_error if the file can't be read or is malformed.
+ */
+ObjData parseObj(const std::string &path, jobs::JobSystem *jobs = nullptr);
+
+}  // namespace seng
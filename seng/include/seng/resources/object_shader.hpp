@@ -29,6 +29,10 @@ class ObjectShaderInstance;
  * shader stages (see also VulkanShaderStage) and is rendered by a specific
  * pipeline.
  *
+ * Meshes with vertices in the packed layout (see `rendering::PackedVertex`) need
+ * their own vertex stage decoding them. If one is given, a second pipeline using
+ * it in place of the regular one is created for them.
+ *
  * It implements the RAII paradigm, meaning instantiation allocates resources
  * while destruction deallocates them.
  *
@@ -41,7 +45,8 @@ class ObjectShader {
   ObjectShader(rendering::Renderer& dev,
                std::string name,
                std::vector<TextureType> textures,
-               const std::vector<const ShaderStage*>& stages);
+               const std::vector<const ShaderStage*>& stages,
+               const ShaderStage* packedVertexStage = nullptr);
   ObjectShader(const ObjectShader&) = delete;
   ObjectShader(ObjectShader&&) = default;
   ~ObjectShader();
@@ -59,10 +64,15 @@ class ObjectShader {
     return m_instances;
   }
 
+  /// Return true if meshes with the given vertex layout can be drawn
+  bool supports(rendering::VertexLayout layout) const;
+
   /**
-   * Use the shader by binding the pipeline in the given command buffer
+   * Use the shader by binding the pipeline for the given vertex layout in the
+   * given command buffer. The layout must be supported.
    */
-  void use(const rendering::CommandBuffer& buffer) const;
+  void use(const rendering::CommandBuffer& buffer,
+           rendering::VertexLayout layout = rendering::VertexLayout::eFull) const;
 
   /**
    * Bind the given descriptor sets to the pipeline used by this object shader
@@ -70,17 +80,6 @@ class ObjectShader {
   void bindDescriptorSets(const rendering::CommandBuffer& buf,
                           const std::vector<vk::DescriptorSet>& sets) const;
 
-  /**
-   * Push the given model matrix to the shader
-   */
-  void updateModelState(const rendering::CommandBuffer& buf,
-                        const glm::mat4& model) const;
-
-  /**
-   * Push the given UV scale to the shader
-   */
-  void updateUVScale(const rendering::CommandBuffer& buf, glm::vec2 scale) const;
-
  private:
   const rendering::Renderer* m_renderer;
   std::string m_name;
@@ -89,6 +88,7 @@ class ObjectShader {
   vk::DescriptorSetLayout m_texSetLayout;
 
   rendering::Pipeline m_pipeline;
+  rendering::Pipeline m_packedPipeline;
 
   std::unordered_set<const ObjectShaderInstance*> m_instances;
 
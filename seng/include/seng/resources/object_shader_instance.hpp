@@ -52,6 +52,7 @@ class ObjectShaderInstance {
 
   const std::string& name() const { return m_name; }
   const ObjectShader& instanceOf() const { return *m_shader; }
+  const std::vector<std::string>& texturePaths() const { return m_texturePaths; }
   const std::vector<vk::DescriptorImageInfo>& imageInfos() const { return m_imgInfos; }
 
   /**
@@ -62,17 +63,6 @@ class ObjectShaderInstance {
   void bindDescriptorSets(const rendering::FrameHandle& handle,
                           const rendering::CommandBuffer& buf) const;
 
-  /**
-   * Push the given model matrix to the shader.
-   */
-  void updateModelState(const rendering::CommandBuffer& buf,
-                        const glm::mat4& model) const;
-
-  /**
-   * Push the given UV scale to the shader
-   */
-  void updateUVScale(const rendering::CommandBuffer& buf, glm::vec2 scale) const;
-
  private:
   rendering::Renderer* m_renderer;
   ObjectShader* m_shader;
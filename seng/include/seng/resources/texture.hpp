@@ -6,13 +6,16 @@
 #include <vulkan/vulkan_raii.hpp>
 
 #include <cstddef>
+#include <memory>
+#include <optional>
 #include <string>
 
 namespace seng {
 
 namespace rendering {
 class Renderer;
-}
+class UploadBatch;
+}  // namespace rendering
 
 /// Dimensions of a Texture
 enum class TextureType { e1D, e2D };
@@ -41,11 +44,28 @@ struct SamplerOptions {
  */
 class Texture {
  public:
+  /// Decoded R8G8B8A8 pixel data, as returned by `decodeFromDisk`
+  struct Pixels {
+    std::unique_ptr<unsigned char, void (*)(void *)> data;
+    unsigned int width, height;
+  };
+
   /// Create a single-pixel texture of the given type with the given color (in
   /// R8G8B8A8 format). By default it is a bright magenta.
   Texture(rendering::Renderer &renderer,
           TextureType type,
           glm::vec<4, unsigned char> color = {255, 0, 255, 255});
+
+  /**
+   * Create a texture of the given type from the given pixels, adding the upload
+   * to the given batch. The texture must not be moved nor destroyed until the
+   * batch has been submitted.
+   */
+  Texture(rendering::Renderer &renderer,
+          TextureType type,
+          SamplerOptions opts,
+          const Pixels &pixels,
+          rendering::UploadBatch &batch);
   Texture(const Texture &) = delete;
   Texture(Texture &&) = default;
 
@@ -70,6 +90,15 @@ class Texture {
                               const std::string &assetPath,
                               const std::string &name);
 
+  /**
+   * Decode the image with the given name, searched like in `loadFromDisk`,
+   * without touching the device. Returns nullopt if it could not be loaded.
+   *
+   * It can be called from any thread.
+   */
+  static std::optional<Pixels> decodeFromDisk(const std::string &assetPath,
+                                              const std::string &name);
+
  private:
   TextureType m_type;
   unsigned int m_width, m_height;
@@ -79,15 +108,17 @@ class Texture {
   /// Creates an empty object. To be filled by an appropriate call to `fill()`
   Texture();
 
-  /// Fills in the objct with the data given, allocating all that is necessary
+  /// Fills in the objct with the data given, allocating all that is necessary.
+  /// The upload of the pixel data is added to the given batch.
   static void fill(Texture &tex,
                    rendering::Renderer &renderer,
                    TextureType typ,
                    SamplerOptions opts,
-                   void *pixelData,
+                   const void *pixelData,
                    vk::DeviceSize size,
                    unsigned int width,
-                   unsigned int height);
+                   unsigned int height,
+                   rendering::UploadBatch &batch);
 };
 
 };  // namespace seng
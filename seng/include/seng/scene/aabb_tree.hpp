@@ -0,0 +1,149 @@
+#pragma once
+
+#include <seng/math.hpp>
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace seng {
+class Entity;
+struct Frustum;
+
+/**
+ * Dynamic bounding volume hierarchy over a set of axis-aligned boxes, each
+ * tagged with the Entity it belongs to.
+ *
+ * Leaves store the box they were given and a "fat" copy of it, enlarged by a
+ * margin on each side, which is what the tree is built on. Moving a box that is
+ * still contained in its fat copy is then just a matter of updating it, and only
+ * boxes that moved further than the margin are taken out and inserted again.
+ * Insertion descends to the sibling that increases the total area of the tree
+ * the least (like Box2D's `b2DynamicTree`), and the tree is kept balanced with
+ * AVL-style rotations on the way back up.
+ *
+ * Queries append to the given vector the entities of all boxes satisfying them,
+ * tested against the actual boxes, not the fat ones. An entity is reported once
+ * for each box it has in the tree.
+ *
+ * Boxes are identified by the proxy returned on insertion, which stays valid
+ * until the box is removed.
+ */
+class AabbTree {
+ public:
+  static constexpr int32_t NULL_NODE = -1;
+  static constexpr float DEFAULT_MARGIN = 0.5f;
+
+  /// Result of a raycast
+  struct RayHit {
+    Entity *entity = nullptr;
+    float distance = 0.0f;
+  };
+
+  /// Create an empty tree whose fat boxes are enlarged by the given margin
+  explicit AabbTree(float margin = DEFAULT_MARGIN);
+
+  /// Number of boxes in the tree
+  size_t size() const { return m_leaves; }
+
+  /// Height of the tree, 0 if it has a single box or none
+  int32_t height() const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+
+  /// Insert a new box, returning its proxy
+  int32_t insert(const Aabb &box, Entity *entity);
+
+  /// Remove the box with the given proxy
+  void remove(int32_t proxy);
+
+  /**
+   * Change the box with the given proxy. Returns true if it had to be inserted
+   * again, i.e. if the new box is not contained in its fat box anymore or the
+   * latter has become too large.
+   */
+  bool move(int32_t proxy, const Aabb &box);
+
+  /// Remove all boxes
+  void clear();
+
+  /**
+   * Build the tree again from scratch, splitting boxes in halves top-down. Much
+   * faster than inserting them one by one, so it is worth calling after adding
+   * lots of boxes at once, even if the tree it builds is a bit worse. Proxies
+   * are left untouched.
+   */
+  void rebuild();
+
+  /// Return the entity of the box with the given proxy
+  Entity *entity(int32_t proxy) const { return m_nodes[proxy].entity; }
+
+  /// Return the box with the given proxy
+  const Aabb &bounds(int32_t proxy) const { return m_nodes[proxy].tight; }
+
+  /// Collect the entities of the boxes overlapping the given one
+  void query(const Aabb &box, std::vector<Entity *> &out) const;
+
+  /// Collect the entities of the boxes overlapping the given sphere
+  void query(glm::vec3 center, float radius, std::vector<Entity *> &out) const;
+
+  /**
+   * Collect the entities of the boxes which may intersect the given frustum,
+   * with the same conservative test as `cullAabbs`.
+   */
+  void query(const Frustum &frustum, std::vector<Entity *> &out) const;
+
+  /**
+   * Find the nearest box hit by the ray starting at `origin` and going along
+   * `direction` for at most `maxDistance`. Returns false if nothing was hit,
+   * otherwise `hit` is filled with the entity and the distance of the point
+   * where the ray enters the box (0 if the origin is inside of it).
+   */
+  bool raycast(glm::vec3 origin,
+               glm::vec3 direction,
+               float maxDistance,
+               RayHit &hit) const;
+
+ private:
+  struct Node {
+    Aabb box;    // Fat box for leaves
+    Aabb tight;  // Only meaningful for leaves
+    Entity *entity;
+    int32_t parent;  // Next free node if unused
+    int32_t child1;
+    int32_t child2;
+    int32_t height;  // 0 for leaves, -1 if unused
+
+    bool isLeaf() const { return child1 == NULL_NODE; }
+  };
+
+  float m_margin;
+  std::vector<Node> m_nodes;
+  int32_t m_root;
+  int32_t m_free;
+  size_t m_leaves;
+
+  // Scratch space for insertions
+  struct Candidate {
+    int32_t node;
+    float ancestors;  // Growth of the ancestors' area
+    float bound;      // Lower bound of the cost of the node and its descendants
+  };
+  std::vector<Candidate> m_candidates;
+
+  struct BuildItem {
+    glm::vec3 center;
+    int32_t leaf;
+  };
+
+  int32_t allocateNode();
+  void freeNode(int32_t node);
+  void insertLeaf(int32_t leaf);
+  void removeLeaf(int32_t leaf);
+  int32_t balance(int32_t node);
+  int32_t build(BuildItem *items, size_t count);
+  void refit(int32_t node);
+  void collectLeaves(int32_t node, std::vector<Entity *> &out) const;
+};
+
+}  // namespace seng
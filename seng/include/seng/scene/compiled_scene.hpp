@@ -0,0 +1,154 @@
+#pragma once
+
+#include <seng/utils.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+namespace YAML {
+class Node;
+}
+
+namespace seng {
+
+/**
+ * Layout of compiled scene files (`.sscene`), as produced by `seng-scenec`.
+ *
+ * A compiled scene is the scene YAML with all the parsing already done: entity
+ * transforms are stored as plain floats with their parent already resolved to
+ * an entity index, while the parameters of every other component are stored as
+ * a flattened tree of YAML nodes. All strings (names, keys, scalars) are
+ * interned in a single string table.
+ *
+ * The file is a header followed by tightly packed arrays of the records below,
+ * in native byte order. Every record only contains 4 byte fields, so the file
+ * can be mapped and used in-place.
+ */
+namespace sscene {
+
+constexpr char MAGIC[4] = {'S', 'S', 'C', 'N'};
+constexpr uint32_t VERSION = 1;
+
+/// Bits of `Header::lightFlags`, telling which light parameters are set
+enum LightFlags : uint32_t { eAmbient = 0x1, eColor = 0x2, eDirection = 0x4 };
+
+/// Kind of a `Node` record
+enum struct NodeKind : uint32_t { eNull, eScalar, eSequence, eMap };
+
+/// Position and number of records of an array in the file
+struct Section {
+  uint32_t offset;
+  uint32_t count;
+};
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+
+  uint32_t lightFlags;
+  float ambient[4];
+  float lightColor[4];
+  float lightDirection[3];
+
+  Section strings;     ///< `String` records
+  Section stringData;  ///< Characters of all strings, count is in bytes
+  Section entities;    ///< `Entity` records, in definition order
+  Section components;  ///< `Component` records, grouped by entity
+  Section nodes;       ///< `Node` records
+};
+
+/// Slice of the string data
+struct String {
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct Entity {
+  uint32_t name;     ///< String index
+  uint32_t parent;   ///< Index of an entity defined earlier, or `NO_PARENT`
+  float position[3];
+  float scale[3];
+  float rotation[3];  ///< Euler angles, in radians
+  uint32_t firstComponent;
+  uint32_t componentCount;
+};
+
+constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+struct Component {
+  uint32_t id;    ///< String index of the component ID
+  uint32_t node;  ///< Index of the node holding its configuration
+};
+
+/**
+ * Node of a YAML tree. The children of a node are stored contiguously starting
+ * from `value`, maps store their keys and values interleaved.
+ */
+struct Node {
+  NodeKind kind;
+  uint32_t value;  ///< String index for scalars, first child for containers
+  uint32_t size;   ///< Number of children (two per map entry)
+};
+
+}  // namespace sscene
+
+/**
+ * Compile the given scene YAML (see the README for the format) into the binary
+ * format described in `sscene` and write it to `out`.
+ *
+ * Throws a std::runtime_error if the scene is malformed.
+ */
+void compileScene(const YAML::Node &scene, std::ostream &out);
+
+/**
+ * Read-only view over a compiled scene file mapped in memory.
+ *
+ * The whole file is validated at construction, after which records can be
+ * accessed directly without any further check.
+ *
+ * It is not copyable nor movable.
+ */
+class CompiledScene {
+ public:
+  /**
+   * Map the compiled scene at the given path. Throws a std::runtime_error if
+   * the file can't be mapped or is not a valid compiled scene.
+   */
+  explicit CompiledScene(const std::string &path);
+  CompiledScene(const CompiledScene &) = delete;
+  CompiledScene(CompiledScene &&) = delete;
+
+  CompiledScene &operator=(const CompiledScene &) = delete;
+  CompiledScene &operator=(CompiledScene &&) = delete;
+
+  const sscene::Header &header() const { return *m_header; }
+
+  /// Return the string with the given index. It points inside the mapping.
+  std::string_view string(uint32_t index) const;
+
+  size_t entityCount() const { return m_header->entities.count; }
+  const sscene::Entity &entity(size_t i) const { return m_entities[i]; }
+  const sscene::Component &component(size_t i) const { return m_components[i]; }
+
+  /// Rebuild the YAML tree rooted at the node with the given index
+  YAML::Node node(uint32_t index) const;
+
+ private:
+  internal::MappedFile m_file;
+
+  const sscene::Header *m_header;
+  const sscene::String *m_strings;
+  const char *m_stringData;
+  const sscene::Entity *m_entities;
+  const sscene::Component *m_components;
+  const sscene::Node *m_nodes;
+
+  void validate();
+  template <typename T>
+  const T *section(const sscene::Section &s) const;
+};
+
+}  // namespace seng
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <seng/components/base_component.hpp>
+#include <seng/log.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace seng {
+class Entity;
+
+/**
+ * Type-erased interface of a ComponentPool, used by ComponentPtr to give back
+ * memory to the pool that allocated a Component.
+ */
+class ComponentPoolBase {
+ public:
+  ComponentPoolBase(const std::type_info &type) : m_type(std::addressof(type)) {}
+  ComponentPoolBase(const ComponentPoolBase &) = delete;
+  ComponentPoolBase(ComponentPoolBase &&) = delete;
+  virtual ~ComponentPoolBase() = default;
+
+  ComponentPoolBase &operator=(const ComponentPoolBase &) = delete;
+  ComponentPoolBase &operator=(ComponentPoolBase &&) = delete;
+
+  /// The concrete type of the Components stored in this pool
+  const std::type_info &type() const { return *m_type; }
+
+  /// Destroy the given Component, which must have been allocated from this pool
+  virtual void destroy(BaseComponent *component) = 0;
+
+ private:
+  const std::type_info *m_type;
+};
+
+/**
+ * Storage for all Components of type T in a Scene.
+ *
+ * Components are allocated in fixed-size chunks, so their addresses are stable
+ * (Components keep raw pointers to each other) while still being tightly packed
+ * in memory. Live Components are also kept in a dense array, together with the
+ * Entity they are attached to, which is walked linearly when iterating.
+ *
+ * Creating or destroying Components invalidates the dense array, so don't do it
+ * while iterating.
+ *
+ * It is not copyable nor movable.
+ */
+template <typename T>
+class ComponentPool : public ComponentPoolBase {
+ public:
+  ComponentPool() : ComponentPoolBase(typeid(T)) {}
+  ComponentPool(const ComponentPool &) = delete;
+  ComponentPool(ComponentPool &&) = delete;
+  ~ComponentPool()
+  {
+    if (!m_dense.empty())
+      seng::log::warning("Destroying pool with {} live components... Something is wrong",
+                         m_dense.size());
+  }
+
+  ComponentPool &operator=(const ComponentPool &) = delete;
+  ComponentPool &operator=(ComponentPool &&) = delete;
+
+  /**
+   * Construct a new T in the pool. The given Entity is passed as the first argument
+   * of the constructor.
+   */
+  template <typename... Args>
+  T *create(Entity &entity, Args &&...args)
+  {
+    Slot *slot = allocate();
+    T *ptr;
+    try {
+      ptr = new (slot->storage) T(entity, std::forward<Args>(args)...);
+    } catch (...) {
+      m_free.push_back(slot);
+      throw;
+    }
+    slot->dense = static_cast<uint32_t>(m_dense.size());
+    m_dense.push_back(ptr);
+    m_owners.push_back(std::addressof(entity));
+    return ptr;
+  }
+
+  void destroy(BaseComponent *component) override
+  {
+    T *ptr = static_cast<T *>(component);
+    Slot *slot = slotOf(ptr);
+
+    // Unlink before destructing, in case the destructor touches the pool
+    uint32_t index = slot->dense;
+    uint32_t last = static_cast<uint32_t>(m_dense.size() - 1);
+    if (index != last) {
+      m_dense[index] = m_dense[last];
+      m_owners[index] = m_owners[last];
+      slotOf(m_dense[index])->dense = index;
+    }
+    m_dense.pop_back();
+    m_owners.pop_back();
+
+    ptr->~T();
+    m_free.push_back(slot);
+  }
+
+  /// Number of live components in the pool
+  size_t size() const { return m_dense.size(); }
+
+  /// Dense array of live components
+  const std::vector<T *> &components() const { return m_dense; }
+
+  /// Entities to which the components in `components()` are attached
+  const std::vector<Entity *> &owners() const { return m_owners; }
+
+ private:
+  static constexpr size_t CHUNK_SIZE = 64;
+
+  struct Slot {
+    alignas(T) unsigned char storage[sizeof(T)];
+    uint32_t dense;
+  };
+
+  std::vector<std::unique_ptr<Slot[]>> m_chunks;
+  std::vector<Slot *> m_free;
+  std::vector<T *> m_dense;
+  std::vector<Entity *> m_owners;
+
+  static Slot *slotOf(T *ptr) { return reinterpret_cast<Slot *>(ptr); }
+
+  Slot *allocate()
+  {
+    if (m_free.empty()) {
+      m_chunks.emplace_back(new Slot[CHUNK_SIZE]);
+      Slot *chunk = m_chunks.back().get();
+      // Push in reverse, so that slots get handed out in address order
+      for (size_t i = CHUNK_SIZE; i > 0; i--) m_free.push_back(chunk + i - 1);
+    }
+    Slot *slot = m_free.back();
+    m_free.pop_back();
+    return slot;
+  }
+};
+
+};  // namespace seng
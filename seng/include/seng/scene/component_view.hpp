@@ -0,0 +1,121 @@
+#pragma once
+
+#include <seng/scene/component_pool.hpp>
+#include <seng/scene/entity.hpp>
+
+#include <cstddef>
+#include <iterator>
+#include <tuple>
+
+namespace seng {
+
+/**
+ * View over all the Components of type T in a Scene whose Entity has also at
+ * least one Component of each of the `Others` types attached.
+ *
+ * Iteration walks linearly T's ComponentPool, yielding tuples of references
+ * `(Entity&, T&, Others&...)`. If an Entity has more than one Component of one
+ * of the `Others` types, the first one is used. Types are matched exactly, e.g. a
+ * view over `ScriptComponent` will not yield the Components inheriting from it.
+ *
+ * Views are cheap to create and copy. Creating or destroying Components of type
+ * T while iterating is not supported.
+ */
+template <typename T, typename... Others>
+class ComponentView {
+ public:
+  /// Type yielded by the iterators
+  using value_type = std::tuple<Entity &, T &, Others &...>;
+
+  /**
+   * Forward iterator over the view.
+   */
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ComponentView::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    iterator(const ComponentPool<T> *pool, size_t index) : m_pool(pool), m_index(index)
+    {
+      skip();
+    }
+
+    reference operator*() const
+    {
+      Entity &e = *m_pool->owners()[m_index];
+      return value_type(e, *m_pool->components()[m_index], first<Others>(e)...);
+    }
+
+    iterator &operator++()
+    {
+      m_index++;
+      skip();
+      return *this;
+    }
+
+    iterator operator++(int)
+    {
+      iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    friend bool operator==(const iterator &lhs, const iterator &rhs)
+    {
+      return lhs.m_index == rhs.m_index && lhs.m_pool == rhs.m_pool;
+    }
+    friend bool operator!=(const iterator &lhs, const iterator &rhs)
+    {
+      return !(lhs == rhs);
+    }
+
+   private:
+    const ComponentPool<T> *m_pool;
+    size_t m_index;
+
+    void skip()
+    {
+      while (m_index < m_pool->size() && !matches(*m_pool->owners()[m_index]))
+        m_index++;
+    }
+  };
+
+  ComponentView(const ComponentPool<T> &pool) : m_pool(std::addressof(pool)) {}
+
+  iterator begin() const { return iterator(m_pool, 0); }
+  iterator end() const { return iterator(m_pool, m_pool->size()); }
+
+  /**
+   * Call `f(Entity&, T&, Others&...)` for each match. Usually faster than
+   * iterating, since no tuples are constructed.
+   */
+  template <typename F>
+  void each(F &&f) const
+  {
+    const auto &components = m_pool->components();
+    const auto &owners = m_pool->owners();
+    for (size_t i = 0; i < components.size(); i++) {
+      Entity &e = *owners[i];
+      if (matches(e)) f(e, *components[i], first<Others>(e)...);
+    }
+  }
+
+ private:
+  const ComponentPool<T> *m_pool;
+
+  static bool matches([[maybe_unused]] const Entity &e)
+  {
+    return (!e.componentsOfType<Others>().empty() && ...);
+  }
+
+  template <typename O>
+  static O &first(const Entity &e)
+  {
+    return *e.componentsOfType<O>()[0].template sureGet<O>();
+  }
+};
+
+};  // namespace seng
@@ -1,13 +1,15 @@
 #pragma once
 
 #include <seng/components/component_ptr.hpp>
+#include <seng/components/definitions.hpp>
+#include <seng/utils.hpp>
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
-#include "seng/utils.hpp"
 
 namespace seng {
 class Application;
@@ -27,7 +29,9 @@ class Transform;
  * important.
  *
  * It owns all the components attached to it, provides lookup via iterators and
- * insertion/deletion modifiers. Other components that wish to store a
+ * insertion/deletion modifiers. The components' storage itself lives in the
+ * Scene's per-type pools (see `Scene::view()` for iterating over all components
+ * of a given type). Other components that wish to store a
  * reference to another attached Component should store a raw pointer (don't
  * worry, it is guaranteed to be valid for the whole lifetime of the Component,
  * unless some other Component deletes that instance).
@@ -37,8 +41,8 @@ class Entity {
   /// Alias for a vector of unique_ptr to components
   using ComponentList = std::vector<ComponentPtr>;
 
-  /// Alias for the Component store
-  using ComponentMap = std::unordered_map<std::string, ComponentList>;
+  /// Alias for the Component store, indexed by the Components' type id
+  using ComponentMap = std::unordered_map<ComponentTypeId, ComponentList>;
 
  public:
   Entity(const Entity&) = delete;
@@ -86,7 +90,7 @@ class Entity {
   template <typename T, typename = IfComponent<T>>
   const ComponentList& componentsOfType() const
   {
-    auto it = m_components.find(T::componentId());
+    auto it = m_components.find(componentTypeId<T>());
     if (it == m_components.end()) return EMPTY_VECTOR;
     return it->second;
   }
@@ -94,12 +98,11 @@ class Entity {
   /**
    * Create a new component of type T in-place. This function will add the
    * reference to this Entity as the first argument to the called constructor.
+   *
+   * Defined in `seng/scene/scene.hpp`.
    */
   template <typename T, typename = IfComponent<T>, typename... Args>
-  void emplaceComponent(Args&&... args)
-  {
-    m_components[T::componentId()].emplace_back(*this, std::make_unique<T>(args...));
-  }
+  void emplaceComponent(Args&&... args);
 
   /**
    * Destroy the component of type T stored at the given pointer location.
@@ -107,7 +110,7 @@ class Entity {
   template <typename T, typename = IfComponent<T>>
   void removeComponent(const BaseComponent* comp_ptr)
   {
-    auto it = m_components.find(T::componentId());
+    auto it = m_components.find(componentTypeId<T>());
     removeWithIterByPtr(it, comp_ptr);
   }
 
@@ -119,7 +122,8 @@ class Entity {
   ComponentPtr m_transform;
   ComponentMap m_components;
 
-  static uint64_t INDEX_COUNTER;
+  // Atomic since scenes may be loaded in the background
+  static std::atomic<uint64_t> INDEX_COUNTER;
   static const ComponentList EMPTY_VECTOR;
 
   void transform(ComponentPtr&& transform);
@@ -127,8 +131,8 @@ class Entity {
   bool checkAndWarnCompPtr(ComponentPtr& ptr);
 
   /**
-   * Constructor for a new entity with the given name and position in the origin.
-   * Private since users shoud use the appropriate method in SceneGraph.
+   * Constructor for a new entity with the given name. Private since users shoud
+   * use the appropriate method in Scene, which also attaches the default Transform.
    */
   Entity(Application& app, Scene& scene, std::string name);
 
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace seng {
+
+/**
+ * The six planes bounding the volume seen by a camera. Each plane is stored as
+ * `(normal, distance)`, with the normal pointing inside, so that a point `p` is
+ * on the inner side if `dot(normal, p) + distance >= 0`. Planes are normalized.
+ */
+struct Frustum {
+  enum Plane { eLeft, eRight, eBottom, eTop, eNear, eFar };
+
+  glm::vec4 planes[6];
+
+  /**
+   * Extract the planes of the given view-projection matrix (Gribb and Hartmann,
+   * "Fast Extraction of Viewing Frustum Planes from the World-View-Projection
+   * Matrix", 2001), which projects depth to [0; 1] like the engine's cameras.
+   */
+  static Frustum fromMatrix(const glm::mat4 &viewProjection);
+};
+
+/**
+ * Structure-of-arrays view over a batch of axis-aligned boxes, stored as their
+ * centers and half extents. Each pointer references an array with (at least)
+ * `count` elements.
+ */
+struct AabbBatch {
+  size_t count;
+  const float *cx, *cy, *cz;
+  const float *ex, *ey, *ez;
+};
+
+/**
+ * Test each box of the batch against the frustum, setting `visible[i]` to 1 if
+ * the box may intersect it and to 0 if it is entirely outside one of its planes.
+ * Returns the number of visible boxes.
+ *
+ * The test is conservative: boxes near the frustum's corners may be reported
+ * visible while being outside. Like `composeTRS`, on x86 the batch is processed
+ * 8 (AVX) or 4 (SSE) boxes at a time, depending on what the CPU supports.
+ */
+size_t cullAabbs(const Frustum &frustum, const AabbBatch &batch, uint8_t *visible);
+
+/// Name of the implementation picked by `cullAabbs`, e.g. for logging
+const char *cullKernelName();
+
+}  // namespace seng
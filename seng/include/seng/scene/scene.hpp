@@ -2,18 +2,32 @@
 
 #include <seng/hook.hpp>
 #include <seng/rendering/buffer.hpp>
+#include <seng/rendering/primitive_types.hpp>
+#include <seng/rendering/render_queue.hpp>
+#include <seng/scene/aabb_tree.hpp>
+#include <seng/scene/component_pool.hpp>
+#include <seng/scene/component_view.hpp>
 #include <seng/scene/direct_light.hpp>
 #include <seng/scene/entity.hpp>
+#include <seng/scene/script_scheduler.hpp>
+#include <seng/scene/transform_system.hpp>
 #include <seng/time.hpp>
 
+#include <glm/mat4x4.hpp>
 #include <glm/trigonometric.hpp>
 #include <glm/vec4.hpp>
 #include <vulkan/vulkan_raii.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <list>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <typeinfo>
 #include <unordered_map>
+#include <vector>
 
 namespace YAML {
 class Node;
@@ -22,6 +36,8 @@ class Node;
 namespace seng {
 class Application;
 class Camera;
+class CompiledScene;
+class Mesh;
 class MeshRenderer;
 
 namespace rendering {
@@ -43,12 +59,27 @@ class CommandBuffer;
  * The three most important hooks for game logic provided are:
  *
  * - `onEarlyUpdate`: runs first thing in the update cycle
- * - `onUpdate`: runs just before scene drawing
+ * - `onUpdate`: runs just before scene drawing (and before the world matrices of
+ *   all changed transforms are recomputed)
  * - `onLateUpdate`: runs last thing in the update cycle
  *
+ * The corresponding hooks of ScriptComponents are run right after each of these,
+ * possibly in parallel (see `ScriptScheduler`).
+ *
  * Also other hooks into other aspects of a scene's life (e.g. drawing) are exposed.
  * For more info referer to the specific hooks' documentation.
  *
+ * Components attached to the scene's entities are stored in per-type pools owned
+ * by the scene, which can be queried via `view()`.
+ *
+ * Entities with at least one MeshRenderer are also kept in a spatial index (see
+ * `spatialIndex()`), with the world space box containing all of their meshes.
+ * Boxes are refitted during the update cycle, right after world matrices are
+ * recomputed, for the entities that have moved or changed meshes only.
+ *
+ * Destroying a scene does not wait for the device: the owner must make sure that
+ * no in-flight frame references it anymore (see `Application`).
+ *
  * A scene is non-copyable and non movable.
  */
 class Scene {
@@ -69,9 +100,19 @@ class Scene {
    * and create a new instance maching it.
    *
    * Scenes are searched inside the `scenePath`. Filename construction is done
-   * like this: `${scenePath}/${sceneName}.yml`.
+   * like this: `${scenePath}/${sceneName}.yml`. If a compiled scene
+   * `${scenePath}/${sceneName}.sscene` (see `seng-scenec`) at least as recent
+   * as the YAML exists, it is loaded instead.
+   *
+   * If given, `progress` is called with the fraction of the scene loaded so far.
+   *
+   * Loading can be done from a thread other than the main one, as long as the
+   * scene is not touched by anyone else until it is returned.
    */
-  static std::unique_ptr<Scene> loadFromDisk(Application &app, std::string sceneName);
+  static std::unique_ptr<Scene> loadFromDisk(
+      Application &app,
+      std::string sceneName,
+      std::function<void(float)> progress = nullptr);
 
   /// Return a const reference to the list of entities
   const EntityList &entities() const { return m_entities; }
@@ -80,9 +121,9 @@ class Scene {
    * Find the first Entity in the scene graph with the given name. If no such
    * entity can be found, a past-the-end iterator is returned.
    *
-   * N.B.: searching for an entity is linear in the number of entites in the
-   * scene graph, so make sure to cache the iterator (it is safe to do
-   * so since they are guaranteed to not be invaliedated w.r.t. scene graph changes).
+   * Lookup is done through an index, so it takes constant time. Iterators are
+   * guaranteed to not be invaliedated w.r.t. scene graph changes, so it is safe
+   * to cache them.
    */
   EntityList::const_iterator findByName(const std::string &name) const;
 
@@ -90,29 +131,25 @@ class Scene {
    * Find the first Entity in the scene graph with the given name. If no such
    * entity can be found, a past-the-end iterator is returned.
    *
-   * N.B.: searching for an entity is linear in the number of entites in the
-   * scene graph, so make sure to cache the iterator (it is safe to do
-   * so since they are guaranteed to not be invaliedated w.r.t. scene graph changes).
+   * Lookup is done through an index, so it takes constant time. Iterators are
+   * guaranteed to not be invaliedated w.r.t. scene graph changes, so it is safe
+   * to cache them.
    */
   EntityList::iterator findByName(const std::string &name);
 
   /**
    * Collect all references to instances with the given name in a vector and
-   * return them.
+   * return them, in order of creation.
    *
-   * N.B.: searching for an entity is linear in the number of entites in the
-   * scene graph, so make sure to cache the iterator (it is safe to do
-   * so since they are guaranteed to not be invaliedated w.r.t. scene graph changes).
+   * Takes time linear in the number of entities with the given name.
    */
   std::vector<const Entity *> findAllByName(const std::string &name) const;
 
   /**
    * Collect all references to instances with the given name in a vector and
-   * return them.
+   * return them, in order of creation.
    *
-   * N.B.: searching for an entity is linear in the number of entites in the
-   * scene graph, so make sure to cache the iterator (it is safe to do
-   * so since they are guaranteed to not be invaliedated w.r.t. scene graph changes).
+   * Takes time linear in the number of entities with the given name.
    */
   std::vector<Entity *> findAllByName(const std::string &name);
 
@@ -124,15 +161,11 @@ class Scene {
 
   /**
    * Delete the corresponding Entity from the scene graph.
-   *
-   * N.B. This incurs linear search time.
    */
   void removeEntity(const Entity *e);
 
   /**
-   * Delete the Entity with the given name from the scene graph.
-   *
-   * N.B. This incurs linear search time.
+   * Delete the first Entity with the given name from the scene graph.
    */
   void removeEntity(const std::string &name);
 
@@ -146,6 +179,65 @@ class Scene {
    */
   void removeAllEntities();
 
+  /// Return the system caching the world matrices of this scene's transforms
+  TransformSystem &transforms() { return m_transforms; }
+
+  /// Return the scheduler running this scene's ScriptComponents
+  ScriptScheduler &scripts() { return m_scripts; }
+
+  /**
+   * Return the bounding volume hierarchy over the world space bounds of the
+   * scene's entities that have meshes, which can be used to find those near a
+   * point, visible from a camera or hit by a ray without going through all
+   * entities.
+   *
+   * It reflects the state of the scene at the last update: entities created
+   * or moved since then are not there yet or are in their old place.
+   */
+  const AabbTree &spatialIndex() const { return m_spatialIndex; }
+
+  /**
+   * Mark the bounds of the given entity as stale, so that they are computed
+   * again at the next update. MeshRenderers do so when created, destroyed or
+   * changing mesh.
+   */
+  void invalidateBounds(const Entity &e) { m_staleBounds.push_back(e.id()); }
+
+  /**
+   * Return the pool storing all Components of type T, creating it if needed.
+   *
+   * Throws a runtime_error if T shares its component ID with another type.
+   */
+  template <typename T, typename = IfComponent<T>>
+  ComponentPool<T> &componentPool()
+  {
+    ComponentTypeId id = componentTypeId<T>();
+    if (id >= m_pools.size()) m_pools.resize(id + 1);
+    if (m_pools[id] == nullptr) m_pools[id] = std::make_unique<ComponentPool<T>>();
+    if (m_pools[id]->type() != typeid(T))
+      throw std::runtime_error("Component ID " + T::componentId() +
+                               " is used by more than one type");
+    return static_cast<ComponentPool<T> &>(*m_pools[id]);
+  }
+
+  /**
+   * Return a view over all Components of type T attached to entities that also
+   * have at least one Component for each of the `Others` types.
+   *
+   * Example:
+   *
+   * ```
+   * scene.view<MeshRenderer, Camera>().each([](Entity &e, auto &mr, auto &cam) {
+   *   // ...
+   * });
+   * ```
+   */
+  template <typename T, typename... Others>
+  ComponentView<T, Others...> view()
+  {
+    return ComponentView<T, Others...>(componentPool<T>());
+  }
+
   /**
    * Return a pointer to the main camera, if one is registered.
    */
@@ -200,14 +292,41 @@ class Scene {
    * the given name.
    *
    * This hook gets executed when a shader instance is ready for drawing
-   * (pipeline and descriptors bound).
+   * (pipeline and descriptors bound), after all MeshRenderers have been drawn.
+   * Model matrices and UV scales are read from the vertex buffer bound at
+   * rendering::InstanceData::BINDING, which still holds the MeshRenderers' ones:
+   * hooks have to bind their own.
    */
   HookRegistrar<const rendering::CommandBuffer &> &onShaderInstanceDraw(
       const std::string &instance);
 
+  /**
+   * Vertex layout of the pipeline currently bound while drawing. Shader instances
+   * are drawn once for each layout their shader supports, each hook should only
+   * draw meshes with the current one.
+   */
+  rendering::VertexLayout drawLayout() const { return m_drawLayout; }
+
+  /// Number of enabled MeshRenderers drawn and skipped by frustum culling
+  struct CullStats {
+    size_t visible = 0;
+    size_t culled = 0;
+  };
+
+  /// Culling results of the last frame drawn
+  const CullStats &cullStats() const { return m_cullStats; }
+
+  /// Draws and binds recorded for MeshRenderers in the last frame drawn
+  const rendering::RenderQueue::Stats &renderStats() const { return m_renderStats; }
+
   /**
    * Draw the scene's contents into the currently on-going frame reprsented by the
    * given FrameHandle.
+   *
+   * Before recording anything, MeshRenderers whose mesh's bounding box is
+   * outside the main camera's frustum are marked as not visible. The visible ones
+   * are then collected into a RenderQueue, which sorts them to bind pipelines,
+   * descriptor sets and meshes as few times as possible.
    */
   void draw(const rendering::FrameHandle &handle);
 
@@ -229,12 +348,79 @@ class Scene {
   Hook<float> m_update;
   Hook<float> m_lateUpdate;
   std::unordered_map<std::string, Hook<const rendering::CommandBuffer &>> m_renderers;
+  rendering::VertexLayout m_drawLayout;
+
+  // Frustum culling, world space boxes are kept around to avoid allocating every
+  // frame
+  struct CullBatch {
+    std::vector<MeshRenderer *> renderers;
+    std::vector<Mesh *> meshes;
+    std::vector<float> cx, cy, cz;
+    std::vector<float> ex, ey, ez;
+    std::vector<uint8_t> visible;
+  };
+  CullBatch m_cull;
+  CullStats m_cullStats;
+
+  // Draws of the MeshRenderers, rebuilt every frame
+  rendering::RenderQueue m_queue;
+  rendering::RenderQueue::Stats m_renderStats;
+
+  // Spatial index, with the proxy of each entity in it
+  AabbTree m_spatialIndex;
+  std::unordered_map<uint64_t, int32_t> m_proxies;
+  std::vector<uint64_t> m_staleBounds;
+
+  // Transform hierarchy and scripts, must outlive the components
+  TransformSystem m_transforms;
+  ScriptScheduler m_scripts;
+
+  // Component storage, indexed by ComponentTypeId. Must outlive the entities
+  std::vector<std::unique_ptr<ComponentPoolBase>> m_pools;
 
   // Scene graph
   Camera *m_mainCamera;
   EntityList m_entities;
 
+  // Scene graph indices, entities with the same name are kept in creation order
+  using NameBucket = std::list<EntityList::iterator>;
+  struct IndexEntry {
+    EntityList::iterator entity;
+    NameBucket::iterator byName;
+  };
+  std::unordered_map<std::string, NameBucket> m_nameIndex;
+  std::unordered_map<uint64_t, IndexEntry> m_idIndex;
+
+  void cull(const glm::mat4 &viewProjection);
+  void enqueue(const glm::mat4 &view);
+  void drawHooks(const rendering::FrameHandle &handle);
+  void updateSpatialIndex();
+  void refitBounds(uint64_t id);
+  void loadYaml(const YAML::Node &config, const std::function<void(float)> &progress);
+  void loadCompiled(const CompiledScene &file,
+                    const std::function<void(float)> &progress);
   void parseEntity(const YAML::Node &node);
+  EntityList::iterator insertEntity(std::string name);
 };
 
+/**
+ * Create a Component of type T in the pool of the scene the given Entity belongs
+ * to. The Entity is passed as the first argument of T's constructor.
+ *
+ * The returned ComponentPtr is not attached to the Entity yet.
+ */
+template <typename T, typename... Args>
+ComponentPtr makeComponent(Entity &entity, Args &&...args)
+{
+  auto &pool = entity.scene().componentPool<T>();
+  return ComponentPtr(pool.create(entity, std::forward<Args>(args)...), pool);
+}
+
+template <typename T, typename, typename... Args>
+void Entity::emplaceComponent(Args &&...args)
+{
+  m_components[componentTypeId<T>()].push_back(
+      makeComponent<T>(*this, std::forward<Args>(args)...));
+}
+
 };  // namespace seng
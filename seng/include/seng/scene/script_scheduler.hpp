@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+namespace seng {
+class Application;
+class BaseComponent;
+class ScriptComponent;
+class Transform;
+class TransformSystem;
+
+/**
+ * Enumeration of the update phases in which scripts are run.
+ */
+enum struct ScriptPhase { eEarlyUpdate, eUpdate, eLateUpdate };
+
+/**
+ * Set of data read and written by a ScriptComponent during its update hooks.
+ * See `ScriptComponent::declareAccess`.
+ *
+ * Transforms are expanded to whatever they depend upon or influence: reading a
+ * transform reads all of its ancestors, while writing one writes its whole
+ * subtree (and reads its ancestors).
+ */
+class ScriptAccess {
+ public:
+  ScriptAccess() = default;
+  ScriptAccess(const ScriptAccess &) = delete;
+  ScriptAccess(ScriptAccess &&) = delete;
+
+  ScriptAccess &operator=(const ScriptAccess &) = delete;
+  ScriptAccess &operator=(ScriptAccess &&) = delete;
+
+  /// Declare that the given transform is read, in local or world space
+  ScriptAccess &reads(const Transform *transform);
+
+  /// Declare that the given transform is modified
+  ScriptAccess &writes(const Transform *transform);
+
+  /// Declare that the given component is read
+  ScriptAccess &reads(const BaseComponent *component);
+
+  /// Declare that the given component is modified
+  ScriptAccess &writes(const BaseComponent *component);
+
+ private:
+  std::vector<const void *> m_reads;
+  std::vector<const void *> m_writes;
+
+  void readAncestors(const Transform *transform);
+  void writeSubtree(const Transform *transform);
+  void clear();
+
+  friend class ScriptScheduler;
+};
+
+/**
+ * Runs the update hooks of all ScriptComponents in a scene.
+ *
+ * Scripts that declare their accesses are grouped in batches of scripts that do
+ * not conflict with one another (i.e. no script writes something that another
+ * one reads or writes). Batches are run one after the other, while the scripts
+ * in each batch run concurrently on the application's job system. A script that
+ * conflicts with earlier ones is always placed in a later batch, so the
+ * relative order of conflicting scripts is preserved. Scripts that do not
+ * declare their accesses are run serially on the calling thread after all
+ * batches, in registration order.
+ *
+ * Pending world matrix updates are flushed before each batch, so that scripts
+ * running concurrently never recompute shared cached matrices.
+ *
+ * An exception thrown by a script ends the phase and reaches the caller of
+ * `run`, whether the script ran in a batch or serially. Scripts in the same
+ * batch that were already running still complete.
+ *
+ * Scripts register and unregister themselves, so users should never need to
+ * interact with this class directly.
+ *
+ * It is not copyable nor movable.
+ */
+class ScriptScheduler {
+ public:
+  ScriptScheduler(Application &app, TransformSystem &transforms);
+  ScriptScheduler(const ScriptScheduler &) = delete;
+  ScriptScheduler(ScriptScheduler &&) = delete;
+
+  ScriptScheduler &operator=(const ScriptScheduler &) = delete;
+  ScriptScheduler &operator=(ScriptScheduler &&) = delete;
+
+  /// Number of registered scripts
+  size_t size() const { return m_scripts.size() - m_holes; }
+
+  /// Run the given phase for all enabled scripts
+  void run(ScriptPhase phase, float deltaTime);
+
+ private:
+  // Scripts are referenced through their index in m_scripts
+  struct Batch {
+    std::vector<size_t> scripts;
+    std::unordered_set<const void *> reads;
+    std::unordered_set<const void *> writes;
+  };
+
+  Application *m_app;
+  TransformSystem *m_transforms;
+
+  // Registered scripts, in registration order. Removed scripts leave holes that
+  // are compacted at the start of the next run
+  std::vector<ScriptComponent *> m_scripts;
+  size_t m_holes = 0;
+  bool m_running = false;
+
+  // Scratch space, kept around to avoid allocating every frame
+  ScriptAccess m_access;
+  std::vector<Batch> m_batches;
+  size_t m_batchCount = 0;
+  std::vector<size_t> m_serial;
+
+  void add(ScriptComponent *script);
+  void remove(ScriptComponent *script);
+  void schedule(size_t index);
+  void runBatch(Batch &batch, ScriptPhase phase, float deltaTime);
+  void compact();
+
+  static bool conflicts(const Batch &batch, const ScriptAccess &access);
+  static void runScript(ScriptComponent *script, ScriptPhase phase, float deltaTime);
+
+  friend class ScriptComponent;
+};
+
+}  // namespace seng
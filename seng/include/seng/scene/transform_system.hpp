@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace seng {
+class Transform;
+
+/**
+ * Per-scene store of the Transform hierarchy, responsible for computing and
+ * caching world-space matrices.
+ *
+ * Transforms are kept in flat arrays sorted in topological order (i.e. parents
+ * always come before their children) together with their parent's index, their
+ * world matrix and a dirty flag. Changing a Transform marks it and all of its
+ * descendants as dirty, and `update()` recomputes all dirty world matrices in a
+ * single linear pass. Stale local matrices are gathered beforehand and composed
+ * in bulk by the SIMD kernel in `trs_kernel.hpp`. Reading the world matrix of a
+ * dirty Transform in between updates recomputes it (and its dirty ancestors) on
+ * the spot.
+ *
+ * Transforms register and unregister themselves, so users should only ever need
+ * to call `update()`.
+ *
+ * It is not copyable nor movable.
+ */
+class TransformSystem {
+ public:
+  TransformSystem() = default;
+  TransformSystem(const TransformSystem &) = delete;
+  TransformSystem(TransformSystem &&) = delete;
+
+  TransformSystem &operator=(const TransformSystem &) = delete;
+  TransformSystem &operator=(TransformSystem &&) = delete;
+
+  /// Number of transforms registered
+  size_t size() const { return m_nodes.size() - m_holes; }
+
+  /// Recompute all dirty world matrices
+  void update();
+
+  /**
+   * Return the transforms whose world matrix has been recomputed since the last
+   * call, in topological order, and forget about them. Updates in between (e.g.
+   * the ones run before parallel scripts) accumulate.
+   *
+   * The list is valid until the next call or Transform removal.
+   */
+  const std::vector<Transform *> &consumeMoved();
+
+ private:
+  static constexpr int32_t NO_PARENT = -1;
+
+  std::vector<Transform *> m_nodes;
+  std::vector<int32_t> m_parents;
+  std::vector<glm::mat4> m_world;
+  std::vector<uint8_t> m_dirty;
+  std::vector<uint8_t> m_moved;
+  std::vector<Transform *> m_movedList;
+  size_t m_holes = 0;
+
+  // Scratch space for batching local matrix composition, kept around to avoid
+  // allocating every frame
+  std::vector<uint32_t> m_stale;
+  std::vector<float> m_trs;
+  std::vector<glm::mat4> m_locals;
+
+  void add(Transform &t);
+  void remove(Transform &t);
+  void markDirty(uint32_t index);
+  const glm::mat4 &worldMatrix(uint32_t index);
+  void recompute(uint32_t index);
+  void compact();
+  void composeLocals();
+
+  friend class Transform;
+};
+
+}  // namespace seng
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+
+namespace seng {
+
+/**
+ * Structure-of-arrays view over a batch of translation/rotation/scale triples.
+ * Each pointer references an array with (at least) `count` elements. Rotations
+ * are quaternions, which need not be normalized.
+ */
+struct TRSBatch {
+  size_t count;
+  const float *px, *py, *pz;
+  const float *qx, *qy, *qz, *qw;
+  const float *sx, *sy, *sz;
+};
+
+/**
+ * Compose each triple of the batch into the affine matrix `T * R * S`, writing
+ * it into `out`, which must have space for `batch.count` matrices.
+ *
+ * The result is the same as `glm::translate(p) * glm::toMat4(glm::normalize(q)) *
+ * glm::scale(s)`. On x86 the batch is processed 8 (AVX2) or 4 (SSE) transforms
+ * at a time, depending on what the CPU supports, which is detected on first use.
+ */
+void composeTRS(const TRSBatch &batch, glm::mat4 *out);
+
+/// Name of the implementation picked by `composeTRS`, e.g. for logging
+const char *trsKernelName();
+
+}  // namespace seng
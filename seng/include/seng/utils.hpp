@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -10,6 +12,43 @@ namespace seng::internal {
  */
 extern std::vector<char> readFile(const std::string &name);
 
+/**
+ * Read-only memory mapping of a whole file.
+ *
+ * It is movable, not copyable.
+ */
+class MappedFile {
+ public:
+  /**
+   * Map the file with the given path. Throws a std::runtime_error if it can't
+   * be opened or mapped.
+   */
+  explicit MappedFile(const std::string &path);
+  MappedFile(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  ~MappedFile();
+
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  /// Start of the mapping, null if the file is empty
+  const char *data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+ private:
+  const char *m_data = nullptr;
+  size_t m_size = 0;
+};
+
+/// Offset basis of the 64 bit FNV-1a hash
+constexpr uint64_t FNV1A_OFFSET_BASIS = 0xcbf29ce484222325;
+
+/**
+ * Compute the 64 bit FNV-1a hash of the given bytes. A previous hash can be
+ * passed as `hash` to continue it.
+ */
+extern uint64_t fnv1a(const void *data, size_t size, uint64_t hash = FNV1A_OFFSET_BASIS);
+
 /**
  * Create a vector containing n in-place created objects
  */
@@ -1,28 +1,50 @@
 #include <seng/application.hpp>
 #include <seng/input_manager.hpp>
+#include <seng/jobs/job_system.hpp>
 #include <seng/log.hpp>
 #include <seng/rendering/glfw_window.hpp>
 #include <seng/rendering/renderer.hpp>
+#include <seng/resources/asset_preloader.hpp>
 #include <seng/scene/scene.hpp>
 #include <seng/time.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <exception>
 #include <functional>
 #include <memory>
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 using namespace std;
 using namespace seng;
 using namespace seng::rendering;
 
+// State of a scene being loaded in the background
+struct Application::SceneLoad {
+  std::string name;
+  Timestamp start;
+  std::thread thread;
+
+  // Written by the loading thread, the rest only once done is set
+  std::atomic<float> progress = 0.0f;
+  std::atomic<bool> done = false;
+  std::unique_ptr<Scene> scene;
+  std::unique_ptr<AssetPreloader> assets;
+
+  // Touched only by the main thread
+  float lastReported = -1.0f;
+};
+
 Application::Application() : Application(ApplicationConfig{}) {}
 Application::Application(ApplicationConfig& config) : conf{config} {}
 Application::Application(ApplicationConfig&& config) : conf{std::move(config)} {}
 
 void Application::run(unsigned int width, unsigned int height)
 {
+  m_jobs = make_unique<jobs::JobSystem>(conf.workerThreads);
   m_glfwWindow = make_unique<GlfwWindow>(conf.appName, width, height);
 
   // Don't bother with the token since this callback will live for the
@@ -42,6 +64,7 @@ void Application::run(unsigned int width, unsigned int height)
   while (!m_glfwWindow->shouldClose()) {
     try {
       m_inputManager->updateEvents();
+      m_jobs->runMainThreadJobs();
       m_vulkan->scopedFrame([&](auto& handle) {
         lastTime = completedTime;
 
@@ -50,12 +73,16 @@ void Application::run(unsigned int width, unsigned int height)
         deltaTime = completedTime - lastTime;
         deltaTime = frameLimit(lastTime, deltaTime);
 
-        // Handle scene update
-        if (m_newSceneName.has_value()) {
-          handleSceneSwitch(handle);
-          if (m_scene == nullptr) seng::log::error("No scene loaded");
-        } else if (m_scene != nullptr) {
+        // Handle scene switch and update
+        retireScenes();
+        if (m_newSceneName.has_value() && m_loading == nullptr) startSceneLoad();
+        if (m_loading != nullptr) updateSceneLoad();
+        if (m_scene != nullptr) {
           m_scene->update(deltaTime, handle);
+        } else {
+          // Dummy frame
+          m_vulkan->beginMainRenderPass(handle);
+          m_vulkan->endMainRenderPass(handle);
         }
       });
     } catch (const exception& e) {
@@ -63,10 +90,17 @@ void Application::run(unsigned int width, unsigned int height)
     }
   }
 
+  // Let a pending load finish, it is still using the application
+  if (m_loading != nullptr && m_loading->thread.joinable()) m_loading->thread.join();
+  m_loading = nullptr;
+
+  m_vulkan->device().logical().waitIdle();
+  m_retiredScenes.clear();
   m_scene = nullptr;
   m_inputManager = nullptr;
   m_vulkan = nullptr;
   m_glfwWindow = nullptr;
+  m_jobs = nullptr;
 }
 
 Duration Application::frameLimit(Timestamp lastTime, Duration delta) const
@@ -89,17 +123,86 @@ void Application::switchScene(const std::string& name)
   m_newSceneName = name;
 }
 
-void Application::handleSceneSwitch(FrameHandle handle)
+void Application::startSceneLoad()
 {
-  // Dummy frame
-  m_vulkan->beginMainRenderPass(handle);
-  m_vulkan->endMainRenderPass(handle);
-
-  // Load scene
-  m_scene = nullptr;  // destroys the current scene
-  auto newScene = Scene::loadFromDisk(*this, *m_newSceneName);
-  m_scene = std::move(newScene);
+  m_loading = make_unique<SceneLoad>();
+  m_loading->name = std::move(*m_newSceneName);
+  m_loading->start = Clock::now();
+  m_loading->assets = make_unique<AssetPreloader>(*this);
   m_newSceneName.reset();
+
+  // Not a job: the main thread helps running those while waiting, and we don't
+  // want it to pick up the whole load
+  m_loading->thread = thread([this, load = m_loading.get()]() {
+    try {
+      load->scene = Scene::loadFromDisk(*this, load->name,
+                                        [load](float p) { load->progress = p; });
+
+      // Assets are preloaded by the main thread, since the renderer's caches
+      // are not thread-safe
+      if (load->scene != nullptr) load->assets->add(*load->scene);
+    } catch (const exception &e) {
+      log::error("Unable to load scene {}: {}", load->name, e.what());
+      load->scene = nullptr;
+    }
+    load->done = true;
+  });
+}
+
+void Application::updateSceneLoad()
+{
+  SceneLoad &load = *m_loading;
+
+  // Entities are half of the work, decoding assets the other half
+  if (!load.done) {
+    reportSceneLoadProgress(load.progress * 0.5f);
+    return;
+  }
+  if (load.thread.joinable()) load.thread.join();
+
+  if (load.scene == nullptr) {
+    log::error("Scene {} could not be loaded, keeping the current one", load.name);
+    m_loading = nullptr;
+    return;
+  }
+
+  // Assets are decoded by the job system while the current scene keeps running,
+  // then uploaded all at once
+  load.assets->start();
+  if (!load.assets->decoded()) {
+    size_t total = max<size_t>(load.assets->assetCount(), 1);
+    reportSceneLoadProgress(0.5f + 0.5f * load.assets->decodedCount() / total);
+    return;
+  }
+  load.assets->upload();
+
+  reportSceneLoadProgress(1.0f);
+  log::dbg("Switching to scene {}, loaded in {}s", load.name,
+           inSeconds(Clock::now() - load.start));
+
+  // Frames still in flight may reference the old scene
+  if (m_scene != nullptr)
+    m_retiredScenes.emplace_back(std::move(m_scene), m_vulkan->framesInFlight());
+  m_scene = std::move(load.scene);
+  m_loading = nullptr;
+}
+
+void Application::reportSceneLoadProgress(float progress)
+{
+  if (progress == m_loading->lastReported) return;
+  m_loading->lastReported = progress;
+  m_sceneLoadProgress(m_loading->name, progress);
+}
+
+void Application::retireScenes()
+{
+  // Once as many frames as there are in flight have begun, the ones that used
+  // a retired scene have completed
+  for (auto &retired : m_retiredScenes)
+    if (retired.second > 0) retired.second--;
+  auto end = remove_if(m_retiredScenes.begin(), m_retiredScenes.end(),
+                       [](const auto &retired) { return retired.second == 0; });
+  m_retiredScenes.erase(end, m_retiredScenes.end());
 }
 
 Application::~Application() = default;
@@ -18,13 +18,13 @@
 
 #include <algorithm>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 using namespace seng;
 using namespace std;
 
-using namespace std::placeholders;
-
+std::mutex Camera::camerasLock;
 std::vector<Camera*> Camera::cameras;
 
 Camera::Camera(
@@ -37,26 +37,33 @@ Camera::Camera(
   m_far = far;
   m_fov = fov;
 
-  auto& window = entity->application().window();
-  m_resizeToken = window->onResize().insert(std::bind(&Camera::resize, this, _2, _3));
-
-  auto windowSize = window->framebufferSize();
-  m_aspectRatio = windowSize.first / static_cast<float>(windowSize.second);
+  m_aspectRatio = 1.0f;
+  syncAspectRatio();
 
-  cameras.push_back(this);
+  {
+    lock_guard lock(camerasLock);
+    cameras.push_back(this);
+  }
 
   if (main) entity->scene().mainCamera(this);
 }
 
 Camera::~Camera()
 {
-  entity->application().window()->onResize().remove(m_resizeToken);
+  lock_guard lock(camerasLock);
   auto end = std::remove(cameras.begin(), cameras.end(), this);
   cameras.erase(end, cameras.end());
 }
 
+std::vector<Camera*> Camera::allCameras()
+{
+  lock_guard lock(camerasLock);
+  return cameras;
+}
+
 glm::mat4 Camera::projectionMatrix() const
 {
+  syncAspectRatio();
   if (m_projectionDirty) {
     if (m_ortho) {
       float top = m_half / m_aspectRatio;
@@ -83,8 +90,13 @@ glm::mat4 Camera::viewMatrix() const
   return m_view;
 }
 
-void Camera::resize(int width, int height)
+void Camera::syncAspectRatio() const
 {
+  auto& window = entity->application().window();
+  unsigned int width = window->width();
+  unsigned int height = window->height();
+  if (width == 0 || height == 0) return;  // minimized, keep the last one
+
   float newAr = width / static_cast<float>(height);
   if (newAr != m_aspectRatio) {
     m_projectionDirty = true;
@@ -146,5 +158,5 @@ DEFINE_CREATE_FROM_CONFIG(Camera, entity, node)
   if (node["fov_radians"] && node["fov_radians"].IsScalar())
     fov = node["fov_radians"].as<float>(DEFAULT_FOV);
 
-  return std::make_unique<Camera>(entity, main, near, far, fov, ortho, halfWidth);
+  return makeComponent<Camera>(entity, main, near, far, fov, ortho, halfWidth);
 }
@@ -0,0 +1,22 @@
+#include <seng/components/definitions.hpp>
+
+#include <mutex>
+#include <unordered_map>
+
+using namespace seng;
+using namespace std;
+
+ComponentTypeId seng::componentTypeId(const ComponentIdType &id)
+{
+  // Same as SceneConfigComponentFactory: construct on first use, never freed
+  static mutex *lock = new mutex();
+  static unordered_map<ComponentIdType, ComponentTypeId> *ids =
+      new unordered_map<ComponentIdType, ComponentTypeId>();
+
+  scoped_lock guard(*lock);
+  auto it = ids->find(id);
+  if (it != ids->end()) return it->second;
+  ComponentTypeId newId = static_cast<ComponentTypeId>(ids->size());
+  ids->emplace(id, newId);
+  return newId;
+}
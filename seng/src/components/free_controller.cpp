@@ -3,6 +3,7 @@
 #include <seng/components/transform.hpp>
 #include <seng/input_manager.hpp>
 #include <seng/scene/entity.hpp>
+#include <seng/scene/scene.hpp>
 
 #include <yaml-cpp/yaml.h>
 #include <glm/gtx/norm.hpp>
@@ -18,7 +19,7 @@ DEFINE_CREATE_FROM_CONFIG(FreeController, entity, node)
   if (node["enabled"]) enabled = node["enabled"].as<bool>();
   if (node["moveSpeed"]) move = node["moveSpeed"].as<float>();
   if (node["rotationSpeed"]) rot = node["rotationSpeed"].as<float>();
-  return std::make_unique<FreeController>(entity, move, rot, enabled);
+  return makeComponent<FreeController>(entity, move, rot, enabled);
 }
 
 FreeController::FreeController(seng::Entity &entity,
@@ -0,0 +1,120 @@
+#include <seng/application.hpp>
+#include <seng/components/camera.hpp>
+#include <seng/components/lod_group.hpp>
+#include <seng/components/mesh_renderer.hpp>
+#include <seng/components/transform.hpp>
+#include <seng/log.hpp>
+#include <seng/rendering/renderer.hpp>
+#include <seng/resources/mesh.hpp>
+#include <seng/scene/entity.hpp>
+#include <seng/scene/scene.hpp>
+
+#include <yaml-cpp/yaml.h>
+#include <glm/geometric.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/trigonometric.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace seng;
+using namespace std;
+
+LodGroup::LodGroup(
+    Entity& e, Metric metric, vector<float> thresholds, float hysteresis, bool enabled) :
+    ScriptComponent(e, enabled)
+{
+  m_metric = metric;
+  m_thresholds = std::move(thresholds);
+  m_hysteresis = hysteresis;
+  m_level = 0;
+
+  if (m_metric == Metric::eDistance)
+    sort(m_thresholds.begin(), m_thresholds.end());
+  else
+    sort(m_thresholds.begin(), m_thresholds.end(), greater<float>());
+}
+
+float LodGroup::coarseness() const
+{
+  const Camera* cam = entity->scene().mainCamera();
+  if (cam == nullptr) return -1.0f;
+  glm::vec3 eye = cam->attachedTo().transform()->worldMartix()[3];
+
+  // Bounding sphere of the biggest of the meshes, if any is loaded
+  auto& renderer = *entity->application().renderer();
+  glm::mat4 world = entity->transform()->worldMartix();
+  glm::vec3 center = world[3];
+  float scale = max({glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])),
+                     glm::length(glm::vec3(world[2]))});
+  float radius = 0.0f;
+  for (const auto& ptr : entity->componentsOfType<MeshRenderer>()) {
+    const auto& name = ptr.sureGet<MeshRenderer>()->meshName();
+    if (!renderer.hasMesh(name)) continue;
+    const Mesh& mesh = renderer.requestMesh(name);
+    if (mesh.boundsRadius() * scale > radius) {
+      radius = mesh.boundsRadius() * scale;
+      center = world * glm::vec4(mesh.bounds().center(), 1.0f);
+    }
+  }
+
+  float distance = glm::length(center - eye);
+  if (m_metric == Metric::eDistance) return distance;
+
+  float size;
+  if (cam->orthographic())
+    size = radius * cam->aspectRatio() / cam->halfWidth();
+  else
+    size = radius / (distance * tan(cam->fov() / 2.0f));
+  return size > 0.0f ? 1.0f / size : -1.0f;
+}
+
+void LodGroup::onUpdate([[maybe_unused]] float deltaTime)
+{
+  float c = coarseness();
+  if (c < 0.0f) return;
+
+  // Thresholds of the current level and the previous ones are moved back by
+  // the hysteresis, so that getting back to them takes a bit more
+  size_t level = 0;
+  for (size_t i = 0; i < m_thresholds.size(); i++) {
+    float bound =
+        m_metric == Metric::eDistance ? m_thresholds[i] : 1.0f / m_thresholds[i];
+    if (i < m_level) bound *= 1.0f - m_hysteresis;
+    if (c <= bound) break;
+    level = i + 1;
+  }
+  m_level = level;
+
+  for (const auto& ptr : entity->componentsOfType<MeshRenderer>())
+    ptr.sureGet<MeshRenderer>()->lod(m_level);
+}
+
+DEFINE_CREATE_FROM_CONFIG(LodGroup, entity, node)
+{
+  LodGroup::Metric metric = LodGroup::Metric::eDistance;
+  vector<float> thresholds;
+  float hysteresis = LodGroup::DEFAULT_HYSTERESIS;
+  bool enabled = true;
+
+  if (node["metric"] && node["metric"].IsScalar()) {
+    auto name = node["metric"].as<string>();
+    if (name == "screen_size")
+      metric = LodGroup::Metric::eScreenSize;
+    else if (name != "distance")
+      seng::log::warning("Unknown LOD metric {}, using distance", name);
+  }
+  if (node["thresholds"] && node["thresholds"].IsSequence())
+    thresholds = node["thresholds"].as<vector<float>>();
+  if (node["hysteresis"] && node["hysteresis"].IsScalar())
+    hysteresis = node["hysteresis"].as<float>(LodGroup::DEFAULT_HYSTERESIS);
+  if (node["enabled"] && node["enabled"].IsScalar()) enabled = node["enabled"].as<bool>();
+  return makeComponent<LodGroup>(entity, metric, std::move(thresholds), hysteresis,
+                                 enabled);
+}
@@ -1,10 +1,9 @@
 #include <seng/application.hpp>
 #include <seng/components/mesh_renderer.hpp>
 #include <seng/components/toggle.hpp>
-#include <seng/components/transform.hpp>
-#include <seng/hook.hpp>
-#include <seng/rendering/command_buffer.hpp>
+#include <seng/log.hpp>
 #include <seng/rendering/renderer.hpp>
+#include <seng/resources/shader_cache.hpp>
 #include <seng/scene/entity.hpp>
 #include <seng/scene/scene.hpp>
 #include <seng/yaml_utils.hpp>
@@ -12,12 +11,18 @@
 #include <yaml-cpp/yaml.h>
 #include <glm/vec2.hpp>
 
-#include <memory>
 #include <string>
 #include <utility>
 
 using namespace seng;
-using namespace std::placeholders;
+
+// Warn about shader instances that don't exist, since nothing will be drawn
+static void checkInstance(const Entity& e, const std::string& name)
+{
+  const auto& instances = e.application().renderer()->shaders().objectShaderInstances();
+  if (instances.find(name) == instances.end())
+    seng::log::warning("MeshRenderer of {} uses unknown instance {}", e.name(), name);
+}
 
 MeshRenderer::MeshRenderer(
     Entity& e, std::string mesh, std::string material, glm::vec2 scale, bool enabled) :
@@ -27,47 +32,25 @@ MeshRenderer::MeshRenderer(
   m_matName = std::move(material);
   m_scale = scale;
 
-  m_tok = e.scene().onShaderInstanceDraw(m_matName).insert(
-      std::bind(&MeshRenderer::render, this, _1));
+  checkInstance(e, m_matName);
+  e.scene().invalidateBounds(e);
 }
 
 MeshRenderer::~MeshRenderer()
 {
-  entity->scene().onShaderInstanceDraw(m_matName).remove(m_tok);
+  entity->scene().invalidateBounds(*entity);
 }
 
-void MeshRenderer::shaderInstanceName(std::string name)
+void MeshRenderer::meshName(std::string name)
 {
-  entity->scene().onShaderInstanceDraw(m_matName).remove(m_tok);
-  m_matName = std::move(name);
-  m_tok = entity->scene().onShaderInstanceDraw(m_matName).insert(
-      std::bind(&MeshRenderer::render, this, _1));
+  m_meshName = std::move(name);
+  entity->scene().invalidateBounds(*entity);
 }
 
-void MeshRenderer::render(const rendering::CommandBuffer& cmd) const
+void MeshRenderer::shaderInstanceName(std::string name)
 {
-  // If it is not disabled
-  if (!enabled()) return;
-
-  // Get the corresponding mesh
-  auto& meshName = m_meshName;
-  auto& mesh = entity->application().renderer()->requestMesh(meshName);
-  if (mesh.vertices().empty()) return;
-  if (!mesh.synced()) mesh.sync();
-
-  // Update the models transform
-  auto& instance =
-      entity->application().renderer()->shaders().objectShaderInstances().at(m_matName);
-  instance.updateModelState(cmd, entity->transform()->worldMartix());
-  instance.updateUVScale(cmd, m_scale);
-
-  // Bind the vertex/index buffers
-  cmd.buffer().bindVertexBuffers(0, *(*mesh.vertexBuffer()).buffer(), {0});
-  cmd.buffer().bindIndexBuffer(*(*mesh.indexBuffer()).buffer(), 0,
-                               vk::IndexType::eUint32);
-
-  // Draw it it
-  cmd.buffer().drawIndexed(mesh.indices().size(), 1, 0, 0, 0);
+  m_matName = std::move(name);
+  checkInstance(*entity, m_matName);
 }
 
 DEFINE_CREATE_FROM_CONFIG(MeshRenderer, entity, node)
@@ -82,5 +65,5 @@ DEFINE_CREATE_FROM_CONFIG(MeshRenderer, entity, node)
     mat = node["instance"].as<std::string>();
   if (node["uv_scale"]) scale = node["uv_scale"].as<glm::vec2>(glm::vec2(1.0f));
   if (node["enabled"] && node["enabled"].IsScalar()) enabled = node["enabled"].as<bool>();
-  return std::make_unique<MeshRenderer>(entity, mesh, mat, scale, enabled);
+  return makeComponent<MeshRenderer>(entity, mesh, mat, scale, enabled);
 }
@@ -2,6 +2,7 @@
 #include <seng/log.hpp>
 #include <seng/scene/entity.hpp>
 #include <seng/scene/scene.hpp>
+#include <seng/scene/transform_system.hpp>
 #include <seng/yaml_utils.hpp>
 
 #include <yaml-cpp/yaml.h>
@@ -18,37 +19,61 @@
 
 using namespace seng;
 
+static Transform* findParent(Entity& e, const std::optional<std::string>& parentName)
+{
+  if (!parentName.has_value()) return nullptr;
+
+  auto parent = e.scene().findByName(*parentName);
+  if (parent == e.scene().entities().end()) {
+    seng::log::warning(
+        "Parent does not exists or has not been defined, defaulting to null");
+    return nullptr;
+  }
+  seng::log::dbg("Parenting to {}", *parentName);
+  return parent->transform();
+}
+
 Transform::Transform(Entity& e,
                      std::optional<std::string> parentName,
                      glm::vec3 p,
                      glm::vec3 s,
                      glm::vec3 r) :
-    BaseComponent(e)
-{
-  if (parentName.has_value()) {
-    auto parent = e.scene().findByName(*parentName);
-    if (parent == e.scene().entities().end()) {
-      seng::log::warning(
-          "Parent does not exists or has not been defined, defaulting to null");
-      m_parent = nullptr;
-    } else {
-      seng::log::dbg("Parenting to {}", *parentName);
-      m_parent = parent->transform();
-      m_parent->m_children.insert(this);
-    }
-  } else
-    m_parent = nullptr;
+    Transform(e, findParent(e, parentName), p, s, r)
+{
+}
+
+Transform::Transform(
+    Entity& e, Transform* parent, glm::vec3 p, glm::vec3 s, glm::vec3 r) :
+    BaseComponent(e),
+    m_system(std::addressof(e.scene().transforms())),
+    m_parent(parent),
+    m_changes(0)
+{
+  if (m_parent != nullptr) m_parent->m_children.insert(this);
+  m_system->add(*this);
 
   position(p);
   scale(s);
   rotation(r);
-  m_changes = POSITION | ROTATION | SCALE | CHANGE_TRACKER;
+  m_changes = LOCAL_CHANGES | ROTATION_MATRIX | CHANGE_TRACKER;
+}
+
+void Transform::markChanged(uint32_t what)
+{
+  m_changes |= what | CHANGE_TRACKER;
+  m_system->markDirty(m_index);
+}
+
+bool Transform::changed() const
+{
+  // Dirty world matrices still have to be recomputed, so they count as changes
+  return (m_changes & CHANGE_TRACKER) || m_system->m_dirty[m_index];
 }
 
 void Transform::position(glm::vec3 p)
 {
   m_pos = p;
-  m_changes |= POSITION | CHANGE_TRACKER;
+  markChanged(POSITION);
 }
 
 void Transform::translate(glm::vec3 pos)
@@ -62,13 +87,13 @@ void Transform::scale(glm::vec3 scale)
   scale.y = scale.y <= 0.0f ? 1.0 : scale.y;
   scale.z = scale.z <= 0.0f ? 1.0 : scale.z;
   m_scale = scale;
-  m_changes |= SCALE | CHANGE_TRACKER;
+  markChanged(SCALE);
 }
 
 void Transform::rotation(glm::quat r)
 {
   m_rotation = r;
-  m_changes |= ROTATION | CHANGE_TRACKER;
+  markChanged(ROTATION | ROTATION_MATRIX);
 }
 
 void Transform::rotation(glm::vec3 euler)
@@ -113,9 +138,9 @@ void Transform::lookAt(const Transform& other, glm::vec3 upDirection)
 
 const glm::mat4& Transform::rotationMatrix() const
 {
-  if (m_changes & ROTATION) {
+  if (m_changes & ROTATION_MATRIX) {
     m_rotMat = glm::toMat4(glm::normalize(m_rotation));
-    m_changes &= ~ROTATION;
+    m_changes &= ~ROTATION_MATRIX;
   }
   return m_rotMat;
 }
@@ -137,20 +162,17 @@ glm::vec3 Transform::right() const
 
 const glm::mat4& Transform::localMatrix() const
 {
-  if ((m_changes & ~CHANGE_TRACKER)) {
+  if (m_changes & LOCAL_CHANGES) {
     m_local = glm::translate(glm::mat4(1.0f), m_pos) * rotationMatrix() *
               glm::scale(glm::mat4(1.0f), m_scale);
-    m_changes &= CHANGE_TRACKER;
+    m_changes &= ~LOCAL_CHANGES;
   }
   return m_local;
 }
 
 glm::mat4 Transform::worldMartix() const
 {
-  if (m_parent != nullptr)
-    return m_parent->worldMartix() * localMatrix();
-  else
-    return localMatrix();
+  return m_system->worldMatrix(m_index);
 }
 
 glm::vec3 Transform::transformToWorld(const glm::vec3& v) const
@@ -163,26 +185,38 @@ glm::vec3 Transform::transformToWorld(const glm::vec3& v) const
 
 Transform::~Transform()
 {
+  m_system->remove(*this);
   if (!m_children.empty()) {
     seng::log::dbg("Reparenting children to nearest parent");
-    for (auto c : m_children) c->m_parent = m_parent;
+    for (auto c : m_children) {
+      c->m_parent = m_parent;
+      if (m_parent != nullptr) m_parent->m_children.insert(c);
+    }
   }
   if (m_parent != nullptr) m_parent->m_children.erase(this);
 }
 
-DEFINE_CREATE_FROM_CONFIG(Transform, entity, node)
+void Transform::parseConfig(const YAML::Node& node,
+                            std::optional<std::string>& parent,
+                            glm::vec3& pos,
+                            glm::vec3& scale,
+                            glm::vec3& rot)
 {
-  glm::vec3 pos = DEFAULT_POS;
-  glm::vec3 scale = DEFAULT_SCALE;
-  glm::vec3 rot = DEFAULT_ROT;
-  std::optional<std::string> parent = std::nullopt;
-
   if (node["parent"]) parent = node["parent"].as<std::string>();
   if (node["position"]) pos = node["position"].as<glm::vec3>(DEFAULT_POS);
   if (node["scale"]) scale = node["scale"].as<glm::vec3>(DEFAULT_SCALE);
   if (node["rotation_deg"])
     rot = glm::radians(node["rotation_deg"].as<glm::vec3>(DEFAULT_ROT));
   if (node["rotation_rad"]) rot = node["rotation_rad"].as<glm::vec3>(DEFAULT_ROT);
+}
+
+DEFINE_CREATE_FROM_CONFIG(Transform, entity, node)
+{
+  glm::vec3 pos = DEFAULT_POS;
+  glm::vec3 scale = DEFAULT_SCALE;
+  glm::vec3 rot = DEFAULT_ROT;
+  std::optional<std::string> parent = std::nullopt;
 
-  return std::make_unique<Transform>(entity, parent, pos, scale, rot);
+  parseConfig(node, parent, pos, scale, rot);
+  return makeComponent<Transform>(entity, parent, pos, scale, rot);
 }
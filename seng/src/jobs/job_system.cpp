@@ -0,0 +1,198 @@
+#include <seng/jobs/job_system.hpp>
+#include <seng/log.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace seng;
+using namespace seng::jobs;
+using namespace std;
+
+// Queue used by the current thread, only meaningful if it is a worker of the
+// JobSystem in t_owner. Other threads use the shared queue.
+static thread_local const JobSystem *t_owner = nullptr;
+static thread_local size_t t_queue = 0;
+
+JobSystem::JobSystem(unsigned int workers) : m_mainThread(this_thread::get_id())
+{
+  if (workers == 0) workers = max(thread::hardware_concurrency(), 2u) - 1;
+
+  m_queues.reserve(workers + 1);
+  for (unsigned int i = 0; i <= workers; i++) m_queues.push_back(make_unique<Queue>());
+
+  m_workers.reserve(workers);
+  for (unsigned int i = 1; i <= workers; i++)
+    m_workers.emplace_back([this, i]() { workerLoop(i); });
+  log::dbg("Started job system with {} workers", workers);
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    lock_guard lock(m_sleepMutex);
+    m_stop = true;
+  }
+  m_wakeUp.notify_all();
+  for (auto &w : m_workers) w.join();
+
+  if (m_queued > 0)
+    log::warning("Destroying job system with {} pending jobs... Something is wrong",
+                 m_queued.load());
+}
+
+void JobSystem::run(Job job, Counter *counter)
+{
+  if (counter != nullptr) {
+    lock_guard lock(counter->m_mutex);
+    counter->m_pending++;
+  }
+  push({std::move(job), counter});
+}
+
+void JobSystem::runAfter(Counter &dependency, Job job, Counter *counter)
+{
+  if (counter != nullptr) {
+    lock_guard lock(counter->m_mutex);
+    counter->m_pending++;
+  }
+  {
+    lock_guard lock(dependency.m_mutex);
+    if (dependency.m_pending > 0) {
+      dependency.m_continuations.emplace_back(std::move(job), counter);
+      return;
+    }
+  }
+  push({std::move(job), counter});
+}
+
+void JobSystem::wait(Counter &counter)
+{
+  while (!counter.done()) {
+    if (tryRunOne()) continue;
+    if (isMainThread()) runMainThreadJobs();
+    this_thread::yield();
+  }
+}
+
+void JobSystem::runOnMainThread(Job job, Counter *counter)
+{
+  if (counter != nullptr) {
+    lock_guard lock(counter->m_mutex);
+    counter->m_pending++;
+  }
+  lock_guard lock(m_mainThreadQueue.mutex);
+  m_mainThreadQueue.tasks.push_back({std::move(job), counter});
+}
+
+void JobSystem::runMainThreadJobs()
+{
+  if (!isMainThread()) {
+    log::error("Main thread jobs run from another thread... Something is wrong");
+    return;
+  }
+
+  // Jobs queued while running will be picked up by the next call
+  deque<Task> tasks;
+  {
+    lock_guard lock(m_mainThreadQueue.mutex);
+    swap(tasks, m_mainThreadQueue.tasks);
+  }
+  for (auto &t : tasks) execute(t);
+}
+
+void JobSystem::workerLoop(size_t index)
+{
+  t_owner = this;
+  t_queue = index;
+
+  while (!m_stop) {
+    if (tryRunOne()) continue;
+
+    unique_lock lock(m_sleepMutex);
+    m_wakeUp.wait(lock, [this]() { return m_stop || m_queued > 0; });
+  }
+}
+
+void JobSystem::push(Task task)
+{
+  {
+    // Taking the lock prevents the wake up from getting lost between a worker
+    // checking the predicate and going to sleep. Counting before pushing keeps
+    // the count from going below zero when the task is stolen right away.
+    lock_guard lock(m_sleepMutex);
+    m_queued++;
+  }
+
+  size_t index = t_owner == this ? t_queue : 0;
+  {
+    lock_guard lock(m_queues[index]->mutex);
+    m_queues[index]->tasks.push_back(std::move(task));
+  }
+  m_wakeUp.notify_one();
+}
+
+bool JobSystem::tryRunOne()
+{
+  size_t index = t_owner == this ? t_queue : 0;
+  Task task;
+  if (!pop(index, task) && !steal(index, task)) return false;
+  m_queued--;
+  execute(task);
+  return true;
+}
+
+bool JobSystem::pop(size_t index, Task &task)
+{
+  Queue &q = *m_queues[index];
+  lock_guard lock(q.mutex);
+  if (q.tasks.empty()) return false;
+  task = std::move(q.tasks.back());
+  q.tasks.pop_back();
+  return true;
+}
+
+bool JobSystem::steal(size_t index, Task &task)
+{
+  for (size_t i = 1; i < m_queues.size(); i++) {
+    Queue &q = *m_queues[(index + i) % m_queues.size()];
+    lock_guard lock(q.mutex);
+    if (q.tasks.empty()) continue;
+    task = std::move(q.tasks.front());
+    q.tasks.pop_front();
+    return true;
+  }
+  return false;
+}
+
+void JobSystem::execute(Task &task)
+{
+  try {
+    task.job();
+  } catch (const exception &e) {
+    log::warning("Unhandled exception in job: {}", e.what());
+  } catch (...) {
+    log::warning("Unhandled exception in job");
+  }
+  complete(task.counter);
+}
+
+void JobSystem::complete(Counter *counter)
+{
+  if (counter == nullptr) return;
+
+  // The counter may be destroyed as soon as the lock is released, so grab what
+  // we need while holding it
+  vector<pair<Job, Counter *>> continuations;
+  {
+    lock_guard lock(counter->m_mutex);
+    if (--counter->m_pending > 0) return;
+    swap(continuations, counter->m_continuations);
+  }
+  for (auto &[job, c] : continuations) push({std::move(job), c});
+}
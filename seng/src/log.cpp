@@ -1,6 +1,7 @@
 #include <seng/log.hpp>
 
 #include <iostream>
+#include <mutex>
 #include <string>
 
 #define INFO_STR "[INFO] "
@@ -13,11 +14,14 @@
 using namespace seng;
 
 static log::LogLevels minLvl = log::LogLevels::DBUG;
+static std::mutex outputMutex;
 
 void log::logOutput(seng::log::LogLevels lvl, std::string out)
 {
   if (lvl_lt(lvl, minLvl)) return;
 
+  // Keep lines coming from different threads from interleaving
+  std::lock_guard lock(outputMutex);
   switch (lvl) {
     case seng::log::LogLevels::DBUG:
       std::cerr << DBUG_STR;
@@ -1,7 +1,10 @@
 #include <seng/math.hpp>
 
+#include <glm/common.hpp>
 #include <glm/fwd.hpp>
 #include <glm/gtc/constants.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
 
 #include <algorithm>
 #include <cmath>
@@ -20,6 +23,40 @@ float seng::smoothDamp(float current,
   return x.x;
 }
 
+glm::vec2 seng::octEncode(glm::vec3 dir)
+{
+  float l1 = std::abs(dir.x) + std::abs(dir.y) + std::abs(dir.z);
+  if (l1 == 0.0f) return glm::vec2(0.0f);
+  dir /= l1;
+
+  glm::vec2 p(dir.x, dir.y);
+  if (dir.z < 0.0f)
+    p = glm::vec2((1.0f - std::abs(dir.y)) * sign(dir.x),
+                  (1.0f - std::abs(dir.x)) * sign(dir.y));
+  return p;
+}
+
+glm::vec3 seng::octDecode(glm::vec2 p)
+{
+  glm::vec3 dir(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+  float t = std::max(-dir.z, 0.0f);
+  dir.x += dir.x >= 0.0f ? -t : t;
+  dir.y += dir.y >= 0.0f ? -t : t;
+  return glm::normalize(dir);
+}
+
+seng::Aabb seng::transformAabb(const Aabb &box, const glm::mat4 &m)
+{
+  // The extent along each world axis is the sum of the projections of the
+  // box's transformed half axes (Arvo, "Transforming Axis-Aligned Bounding
+  // Boxes", 1990)
+  glm::vec3 center = m * glm::vec4(box.center(), 1.0f);
+  glm::vec3 e = box.extent();
+  glm::vec3 extent = glm::abs(glm::vec3(m[0])) * e.x + glm::abs(glm::vec3(m[1])) * e.y +
+                     glm::abs(glm::vec3(m[2])) * e.z;
+  return {center - extent, center + extent};
+}
+
 float seng::repeat(float t, float length)
 {
   // Taken directly from the Unity reference source code
@@ -2,11 +2,15 @@
 #include <seng/rendering/buffer.hpp>
 #include <seng/rendering/command_buffer.hpp>
 #include <seng/rendering/device.hpp>
+#include <seng/rendering/memory_allocator.hpp>
 
 #include <vulkan/vulkan_raii.hpp>
 
 #include <string.h>  // for memcpy
+#include <array>
+#include <cstdint>
 #include <functional>
+#include <stdexcept>
 #include <string>
 #include <utility>
 
@@ -21,13 +25,31 @@
 using namespace std;
 using namespace seng::rendering;
 
+// Buffers taking part in transfers are shared with the dedicated transfer
+// queue, if any, so that uploads need no queue family ownership transfers
+static vk::raii::Buffer createBuffer(const Device &dev,
+                                     vk::DeviceSize size,
+                                     vk::BufferUsageFlags usage)
+{
+  vk::BufferCreateInfo info{{}, size, usage, vk::SharingMode::eExclusive};
+  const auto &indices = dev.queueFamilyIndices();
+  array<uint32_t, 2> families{*indices.graphicsFamily,
+                              indices.transferFamily.value_or(0)};
+  auto transfers = vk::BufferUsageFlagBits::eTransferSrc |
+                   vk::BufferUsageFlagBits::eTransferDst;
+  if (dev.hasTransferQueue() && (usage & transfers)) {
+    info.sharingMode = vk::SharingMode::eConcurrent;
+    info.setQueueFamilyIndices(families);
+  }
+  return vk::raii::Buffer(dev.logical(), info);
+}
+
 Buffer::Buffer(std::nullptr_t) :
     m_device(nullptr),
     m_usage{},
     m_size{},
     m_handle(nullptr),
-    m_memRequirements{},
-    m_memIndex{},
+    m_memFlags{},
     m_memory(nullptr)
 {
 }
@@ -40,11 +62,9 @@ Buffer::Buffer(const Device &dev,
     m_device(std::addressof(dev)),
     m_usage(usage),
     m_size(size),
-    m_handle(
-        vk::raii::Buffer(dev.logical(), {{}, size, usage, vk::SharingMode::eExclusive})),
-    m_memRequirements(m_handle.getMemoryRequirements()),
-    m_memIndex(dev.findMemoryIndex(m_memRequirements.memoryTypeBits, memFlags)),
-    m_memory(dev.logical(), vk::MemoryAllocateInfo{m_memRequirements.size, m_memIndex})
+    m_handle(createBuffer(dev, size, usage)),
+    m_memFlags(memFlags),
+    m_memory(dev.allocator().allocate(m_handle.getMemoryRequirements(), memFlags, true))
 {
   log::dbg("Allocated buffer");
   if (bind) this->bind(0);
@@ -53,7 +73,7 @@ Buffer::Buffer(const Device &dev,
 void Buffer::bind(vk::DeviceSize offset) const
 {
   BAIL_OUT_ON_UNINITIALIZED();
-  m_handle.bindMemory(*m_memory, offset);
+  m_handle.bindMemory(m_memory.memory(), m_memory.offset() + offset);
 }
 
 void Buffer::resize(vk::DeviceSize size,
@@ -63,38 +83,38 @@ void Buffer::resize(vk::DeviceSize size,
   BAIL_OUT_ON_UNINITIALIZED();
 
   // Create new buffer
-  vk::BufferCreateInfo newInfo{{}, size, m_usage, vk::SharingMode::eExclusive};
-  vk::raii::Buffer newBuffer(m_device->logical(), newInfo);
+  vk::raii::Buffer newBuffer = createBuffer(*m_device, size, m_usage);
 
   // Allocate new buffer
-  vk::MemoryRequirements newMemRequirements(newBuffer.getMemoryRequirements());
-  vk::MemoryAllocateInfo newAllocateInfo{newMemRequirements.size, m_memIndex};
-  vk::raii::DeviceMemory newMemory(m_device->logical(), newAllocateInfo);
-  newBuffer.bindMemory(*newMemory, 0);
+  MemoryAllocator::Allocation newMemory = m_device->allocator().allocate(
+      newBuffer.getMemoryRequirements(), m_memFlags, true);
+  newBuffer.bindMemory(newMemory.memory(), newMemory.offset());
 
-  // Copy old contents to new buffer
-  this->rawCopy(newBuffer, {0, 0, this->m_size}, pool, queue);
+  // The old buffer may still be read by frames in flight or written by uploads
+  // on any queue, so wait for all of them before copying and replacing it
   m_device->logical().waitIdle();
+  this->rawCopy(newBuffer, {0, 0, this->m_size}, pool, queue);
 
   // Replace the old handles (RAII takes care of deallocation)
   this->m_size = size;
-  this->m_memRequirements = newMemRequirements;
   this->m_memory = std::move(newMemory);
   this->m_handle = std::move(newBuffer);
 }
 
 void *Buffer::lockMemory(vk::DeviceSize offset,
-                         vk::DeviceSize size,
-                         vk::MemoryMapFlags flags) const
+                         [[maybe_unused]] vk::DeviceSize size,
+                         [[maybe_unused]] vk::MemoryMapFlags flags) const
 {
   BAIL_OUT_ON_UNINITIALIZED(nullptr);
-  return m_memory.mapMemory(offset, size, flags);
+  if (m_memory.mapped() == nullptr)
+    throw runtime_error("Cannot lock buffer memory that is not host visible");
+  return static_cast<char *>(m_memory.mapped()) + offset;
 }
 
 void Buffer::unlockMemory() const
 {
   BAIL_OUT_ON_UNINITIALIZED();
-  m_memory.unmapMemory();
+  m_memory.flush();
 }
 
 void Buffer::load(const void *data,
@@ -114,7 +134,6 @@ void Buffer::rawCopy(const vk::raii::Buffer &dest,
                      const vk::raii::Queue &queue,
                      [[maybe_unused]] const vk::raii::Fence *fence) const
 {
-  queue.waitIdle();
   CommandBuffer::recordSingleUse(*m_device, pool, queue, [&](auto &buf) {
     buf.buffer().copyBuffer(*m_handle, *dest, copyRegion);
   });
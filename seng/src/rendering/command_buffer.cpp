@@ -6,6 +6,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <limits>
 #include <string>
 #include <utility>
 #include <vector>
@@ -95,11 +96,16 @@ void CommandBuffer::recordSingleUse(const Device &dev,
 
   buf.end();
 
+  // Wait just for this submission, not for everything else on the queue
+  vk::raii::Fence fence(dev.logical(), vk::FenceCreateInfo{});
   vk::SubmitInfo submitInfo{};
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &(*buf.buffer());
-  q.submit(submitInfo);
-  q.waitIdle();
+  q.submit(submitInfo, *fence);
+  vk::Result result =
+      dev.logical().waitForFences(*fence, true, numeric_limits<uint64_t>::max());
+  if (result != vk::Result::eSuccess)
+    log::error("Waiting for single-use command buffer: {}", vk::to_string(result));
 }
 
 void CommandBuffer::reset() const
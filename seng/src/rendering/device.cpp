@@ -3,6 +3,7 @@
 #include <seng/log.hpp>
 #include <seng/rendering/device.hpp>
 #include <seng/rendering/glfw_window.hpp>
+#include <seng/rendering/memory_allocator.hpp>
 
 #include <vulkan/vulkan_raii.hpp>
 
@@ -24,11 +25,15 @@ QueueFamilyIndices::QueueFamilyIndices(const vk::raii::PhysicalDevice &dev,
 {
   vector<vk::QueueFamilyProperties> queueFamilies = dev.getQueueFamilyProperties();
 
-  int i = 0;
+  uint32_t i = 0;
   for (const auto &familyProperties : queueFamilies) {
-    if (familyProperties.queueFlags & vk::QueueFlagBits::eGraphics) graphicsFamily = i;
-    if (dev.getSurfaceSupportKHR(i, *surface)) presentFamily = i;
-    if (isComplete()) break;
+    bool graphics = bool(familyProperties.queueFlags & vk::QueueFlagBits::eGraphics);
+    bool transfer = bool(familyProperties.queueFlags & vk::QueueFlagBits::eTransfer);
+    if (!isComplete()) {
+      if (graphics) graphicsFamily = i;
+      if (dev.getSurfaceSupportKHR(i, *surface)) presentFamily = i;
+    }
+    if (transfer && !graphics && !transferFamily.has_value()) transferFamily = i;
     ++i;
   }
 }
@@ -85,6 +90,7 @@ static bool checkSwapchain(const vk::raii::PhysicalDevice &,
                            const vk::raii::SurfaceKHR &);
 static bool checkFeatures(const seng::ApplicationConfig &,
                           const vk::raii::PhysicalDevice &);
+static bool supportsMultiDrawIndirect(const vk::raii::PhysicalDevice &);
 static vk::raii::Device createLogicalDevice(const seng::ApplicationConfig &,
                                             const vk::raii::PhysicalDevice &,
                                             const QueueFamilyIndices &);
@@ -101,11 +107,20 @@ Device::Device(const ApplicationConfig &config,
     m_logical(createLogicalDevice(config, m_physical, m_queueIndices)),
     m_presentQueue(m_logical, *m_queueIndices.presentFamily, 0),
     m_graphicsQueue(m_logical, *m_queueIndices.graphicsFamily, 0),
+    m_transferQueue(m_queueIndices.transferFamily.has_value()
+                        ? vk::raii::Queue(m_logical, *m_queueIndices.transferFamily, 0)
+                        : vk::raii::Queue(nullptr)),
     m_depthFormat(detectDepthFormat(m_physical)),
     m_maxAnisotropy(m_physical.getProperties().limits.maxSamplerAnisotropy),
-    m_supportedSampleCounts(getSupportedSampleCounts(m_physical))
+    m_supportedSampleCounts(getSupportedSampleCounts(m_physical)),
+    m_maxDrawIndirectCount(supportsMultiDrawIndirect(m_physical)
+                               ? m_physical.getProperties().limits.maxDrawIndirectCount
+                               : 0),
+    m_allocator(std::make_unique<MemoryAllocator>(*this))
 {
   log::dbg("Device has beeen created successfully");
+  if (hasTransferQueue())
+    log::dbg("Using dedicated transfer queue family {}", *m_queueIndices.transferFamily);
 }
 
 vk::raii::PhysicalDevice pickPhysicalDevice(const seng::ApplicationConfig &config,
@@ -151,6 +166,12 @@ bool checkFeatures(const seng::ApplicationConfig &cfg,
   return true;
 }
 
+bool supportsMultiDrawIndirect(const vk::raii::PhysicalDevice &phy)
+{
+  auto features = phy.getFeatures();
+  return features.multiDrawIndirect && features.drawIndirectFirstInstance;
+}
+
 vk::raii::Device createLogicalDevice(const seng::ApplicationConfig &cfg,
                                      const vk::raii::PhysicalDevice &phy,
                                      const QueueFamilyIndices &indices)
@@ -159,6 +180,8 @@ vk::raii::Device createLogicalDevice(const seng::ApplicationConfig &cfg,
 
   vector<vk::DeviceQueueCreateInfo> qcis;
   set<uint32_t> uniqueQueueFamilies{*indices.graphicsFamily, *indices.presentFamily};
+  if (indices.transferFamily.has_value())
+    uniqueQueueFamilies.insert(*indices.transferFamily);
   for (auto queueFamily : uniqueQueueFamilies) {
     vk::DeviceQueueCreateInfo qci{};
     qci.queueFamilyIndex = queueFamily;
@@ -168,6 +191,10 @@ vk::raii::Device createLogicalDevice(const seng::ApplicationConfig &cfg,
 
   vk::PhysicalDeviceFeatures features{};
   if (cfg.useAnisotropy) features.samplerAnisotropy = true;
+  if (supportsMultiDrawIndirect(phy)) {
+    features.multiDrawIndirect = true;
+    features.drawIndirectFirstInstance = true;
+  }
 
   vk::DeviceCreateInfo dci{};
   dci.setQueueCreateInfos(qcis);
@@ -0,0 +1,225 @@
+#include <seng/log.hpp>
+#include <seng/rendering/buffer.hpp>
+#include <seng/rendering/device.hpp>
+#include <seng/rendering/geometry_arena.hpp>
+#include <seng/rendering/primitive_types.hpp>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+using namespace seng;
+using namespace seng::rendering;
+using namespace std;
+
+static constexpr vk::BufferUsageFlags VERTEX_USAGE =
+    vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferSrc |
+    vk::BufferUsageFlagBits::eTransferDst;
+static constexpr vk::BufferUsageFlags INDEX_USAGE =
+    vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferSrc |
+    vk::BufferUsageFlagBits::eTransferDst;
+
+// ==== Allocation
+GeometryArena::Allocation::Allocation(std::nullptr_t) :
+    m_pool(nullptr), m_offset(0), m_size(0)
+{
+}
+
+GeometryArena::Allocation::Allocation(Pool *pool,
+                                      vk::DeviceSize offset,
+                                      vk::DeviceSize size) :
+    m_pool(pool), m_offset(offset), m_size(size)
+{
+}
+
+GeometryArena::Allocation::Allocation(Allocation &&other) noexcept :
+    m_pool(std::exchange(other.m_pool, nullptr)),
+    m_offset(other.m_offset),
+    m_size(other.m_size)
+{
+}
+
+GeometryArena::Allocation &GeometryArena::Allocation::operator=(
+    Allocation &&other) noexcept
+{
+  if (this != &other) {
+    release();
+    m_pool = std::exchange(other.m_pool, nullptr);
+    m_offset = other.m_offset;
+    m_size = other.m_size;
+  }
+  return *this;
+}
+
+GeometryArena::Allocation::~Allocation()
+{
+  release();
+}
+
+void GeometryArena::Allocation::release()
+{
+  if (m_pool == nullptr) return;
+  m_pool->released.push_back({{m_offset, m_size}, 0});
+  m_pool = nullptr;
+}
+
+// ==== Pool
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+bool GeometryArena::Pool::take(vk::DeviceSize size,
+                               vk::DeviceSize alignment,
+                               vk::DeviceSize &offset)
+{
+  for (auto it = free.begin(); it != free.end(); ++it) {
+    vk::DeviceSize start = alignUp(it->offset, alignment);
+    vk::DeviceSize end = it->offset + it->size;
+    if (start + size > end) continue;
+
+    // Whatever is left before and after the allocation stays free
+    Block before{it->offset, start - it->offset};
+    Block after{start + size, end - start - size};
+    if (before.size > 0 && after.size > 0) {
+      *it = before;
+      free.insert(it + 1, after);
+    } else if (before.size > 0) {
+      *it = before;
+    } else if (after.size > 0) {
+      *it = after;
+    } else {
+      free.erase(it);
+    }
+    used += size;
+    offset = start;
+    return true;
+  }
+  return false;
+}
+
+void GeometryArena::Pool::give(vk::DeviceSize offset, vk::DeviceSize size)
+{
+  auto next = lower_bound(free.begin(), free.end(), offset,
+                          [](const Block &b, vk::DeviceSize o) { return b.offset < o; });
+
+  // Merge with the free blocks right before and after, if any
+  auto before = next == free.begin() ? free.end() : prev(next);
+  bool mergePrev = before != free.end() && before->offset + before->size == offset;
+  bool mergeNext = next != free.end() && offset + size == next->offset;
+  if (mergePrev && mergeNext) {
+    before->size += size + next->size;
+    free.erase(next);
+  } else if (mergePrev) {
+    before->size += size;
+  } else if (mergeNext) {
+    next->offset = offset;
+    next->size += size;
+  } else {
+    free.insert(next, {offset, size});
+  }
+}
+
+// ==== Arena
+GeometryArena::GeometryArena(const Device &device,
+                             const vk::raii::CommandPool &pool,
+                             size_t framesInFlight) :
+    m_device(std::addressof(device)),
+    m_commandPool(std::addressof(pool)),
+    m_framesInFlight(framesInFlight)
+{
+  for (auto &p : m_vertexPools) {
+    p.usage = VERTEX_USAGE;
+    p.initialSize = INITIAL_VERTEX_BYTES;
+  }
+  m_indexPool.usage = INDEX_USAGE;
+  m_indexPool.initialSize = INITIAL_INDEX_BYTES;
+}
+
+GeometryArena::Allocation GeometryArena::allocateVertices(VertexLayout layout,
+                                                          size_t count)
+{
+  vk::DeviceSize stride = vertexSize(layout);
+  return allocate(m_vertexPools[static_cast<size_t>(layout)], count * stride, stride);
+}
+
+GeometryArena::Allocation GeometryArena::allocateIndices(vk::IndexType type,
+                                                         size_t count)
+{
+  vk::DeviceSize size = type == vk::IndexType::eUint16 ? sizeof(uint16_t)
+                                                       : sizeof(uint32_t);
+  return allocate(m_indexPool, count * size, size);
+}
+
+GeometryArena::Allocation GeometryArena::allocate(Pool &pool,
+                                                  vk::DeviceSize size,
+                                                  vk::DeviceSize alignment)
+{
+  vk::DeviceSize offset;
+  if (!pool.take(size, alignment, offset)) {
+    grow(pool, size + alignment);
+    pool.take(size, alignment, offset);
+  }
+  return Allocation(&pool, offset, size);
+}
+
+void GeometryArena::grow(Pool &pool, vk::DeviceSize size)
+{
+  // The free block at the end, if any, counts towards the requested size
+  vk::DeviceSize tail = 0;
+  const Block *last = pool.free.empty() ? nullptr : &pool.free.back();
+  if (last != nullptr && last->offset + last->size == pool.capacity) tail = last->size;
+  vk::DeviceSize capacity = max({pool.initialSize, 2 * pool.capacity,
+                                 pool.capacity - tail + size});
+
+  if (pool.capacity == 0) {
+    pool.buffer = Buffer(*m_device, pool.usage, capacity);
+  } else {
+    log::dbg("Growing geometry buffer from {} to {} bytes", pool.capacity, capacity);
+    pool.buffer.resize(capacity, m_device->graphicsQueue(), *m_commandPool);
+  }
+  pool.give(pool.capacity, capacity - pool.capacity);
+  pool.capacity = capacity;
+}
+
+void GeometryArena::collect()
+{
+  // Once as many frames as there are in flight have begun, the ones that may
+  // have drawn from a released slice have completed
+  auto collectPool = [&](Pool &pool) {
+    for (auto &r : pool.released) r.frames++;
+    auto end = remove_if(pool.released.begin(), pool.released.end(), [&](Released &r) {
+      if (r.frames < m_framesInFlight) return false;
+      pool.used -= r.block.size;
+      pool.give(r.block.offset, r.block.size);
+      return true;
+    });
+    pool.released.erase(end, pool.released.end());
+  };
+  for (auto &p : m_vertexPools) collectPool(p);
+  collectPool(m_indexPool);
+}
+
+vk::DeviceSize GeometryArena::usedBytes() const
+{
+  vk::DeviceSize ret = m_indexPool.used;
+  for (const auto &p : m_vertexPools) ret += p.used;
+  return ret;
+}
+
+vk::DeviceSize GeometryArena::capacityBytes() const
+{
+  vk::DeviceSize ret = m_indexPool.capacity;
+  for (const auto &p : m_vertexPools) ret += p.capacity;
+  return ret;
+}
+
+size_t GeometryArena::freeBlocks() const
+{
+  size_t ret = m_indexPool.free.size();
+  for (const auto &p : m_vertexPools) ret += p.free.size();
+  return ret;
+}
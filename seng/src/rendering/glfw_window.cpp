@@ -24,6 +24,11 @@ GlfwWindow::GlfwWindow(string appName, unsigned int width, unsigned int height)
   m_ptr = glfwCreateWindow(width, height, m_appName.c_str(), nullptr, nullptr);
   glfwSetWindowUserPointer(m_ptr, this);
 
+  // The framebuffer may not match the requested size (e.g. on HiDPI screens)
+  auto fbSize = framebufferSize();
+  m_width = fbSize.first;
+  m_height = fbSize.second;
+
   // Callbacks
   glfwSetFramebufferSizeCallback(m_ptr, resizeCallback);
   glfwSetKeyCallback(m_ptr, onKeyCallback);
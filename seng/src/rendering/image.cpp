@@ -3,6 +3,7 @@
 #include <seng/rendering/command_buffer.hpp>
 #include <seng/rendering/device.hpp>
 #include <seng/rendering/image.hpp>
+#include <seng/rendering/memory_allocator.hpp>
 
 #include <vulkan/vulkan_raii.hpp>
 
@@ -54,19 +55,16 @@ Image::Image(const Device &dev, const Image::CreateInfo &info) :
       ci.sharingMode = vk::SharingMode::eExclusive;
       return vk::raii::Image(dev.logical(), ci);
     })),
-    // Allocate memory
+    // Allocate memory, attachments get their own since they are big and
+    // recreated with the swapchain
     m_memory(std::invoke([&]() {
-      vk::MemoryRequirements requirements(m_handle.getMemoryRequirements());
-      uint32_t memoryIndex =
-          dev.findMemoryIndex(requirements.memoryTypeBits, info.memoryFlags);
-
-      vk::MemoryAllocateInfo ai;
-      ai.allocationSize = requirements.size;
-      ai.memoryTypeIndex = memoryIndex;
-
-      vk::raii::DeviceMemory ret(dev.logical(), ai);
-      m_handle.bindMemory(*ret, 0);
-
+      bool linear = info.tiling == vk::ImageTiling::eLinear;
+      auto attachmentUsage = vk::ImageUsageFlagBits::eColorAttachment |
+                             vk::ImageUsageFlagBits::eDepthStencilAttachment;
+      bool attachment = bool(info.usage & attachmentUsage);
+      auto ret = dev.allocator().allocate(m_handle.getMemoryRequirements(),
+                                          info.memoryFlags, linear, attachment);
+      m_handle.bindMemory(ret.memory(), ret.offset());
       return ret;
     })),
     m_unmanaged(nullptr),
@@ -117,12 +115,14 @@ void Image::createView(vk::ImageViewType type,
   log::dbg("Created new image view");
 }
 
-void Image::copyFromBuffer(const CommandBuffer &commandBuf, const Buffer &buf) const
+void Image::copyFromBuffer(const CommandBuffer &commandBuf,
+                           const Buffer &buf,
+                           vk::DeviceSize offset) const
 {
   BAIL_OUT_ON_UNINITIALIZED();
 
   vk::BufferImageCopy region;
-  region.bufferOffset = 0;
+  region.bufferOffset = offset;
   region.bufferRowLength = 0;
   region.bufferImageHeight = 0;
 
@@ -0,0 +1,273 @@
+#include <seng/log.hpp>
+#include <seng/rendering/device.hpp>
+#include <seng/rendering/memory_allocator.hpp>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace seng;
+using namespace seng::rendering;
+using namespace std;
+
+// Return the order of the smallest range holding the given number of bytes
+static uint32_t orderOf(vk::DeviceSize size)
+{
+  uint32_t order = 0;
+  while ((MemoryAllocator::MIN_ALLOCATION << order) < size) order++;
+  return order;
+}
+
+static vk::DeviceSize rangeSize(uint32_t order)
+{
+  return MemoryAllocator::MIN_ALLOCATION << order;
+}
+
+// ==== Allocation
+MemoryAllocator::Allocation::Allocation(std::nullptr_t) :
+    m_allocator(nullptr), m_block(nullptr), m_offset(0), m_size(0), m_order(0)
+{
+}
+
+MemoryAllocator::Allocation::Allocation(Allocation &&other) noexcept :
+    m_allocator(std::exchange(other.m_allocator, nullptr)),
+    m_block(std::exchange(other.m_block, nullptr)),
+    m_offset(other.m_offset),
+    m_size(other.m_size),
+    m_order(other.m_order)
+{
+}
+
+MemoryAllocator::Allocation &MemoryAllocator::Allocation::operator=(
+    Allocation &&other) noexcept
+{
+  if (this != &other) {
+    release();
+    m_allocator = std::exchange(other.m_allocator, nullptr);
+    m_block = std::exchange(other.m_block, nullptr);
+    m_offset = other.m_offset;
+    m_size = other.m_size;
+    m_order = other.m_order;
+  }
+  return *this;
+}
+
+MemoryAllocator::Allocation::~Allocation()
+{
+  release();
+}
+
+void MemoryAllocator::Allocation::release()
+{
+  if (m_allocator == nullptr) return;
+  m_allocator->free(*this);
+  m_allocator = nullptr;
+  m_block = nullptr;
+}
+
+vk::DeviceMemory MemoryAllocator::Allocation::memory() const
+{
+  return m_block == nullptr ? vk::DeviceMemory{} : *m_block->memory;
+}
+
+void *MemoryAllocator::Allocation::mapped() const
+{
+  if (m_block == nullptr || m_block->mapped == nullptr) return nullptr;
+  return static_cast<char *>(m_block->mapped) + m_offset;
+}
+
+void MemoryAllocator::Allocation::flush() const
+{
+  if (m_block == nullptr || m_block->mapped == nullptr || m_block->coherent) return;
+
+  // Ranges are at least MIN_ALLOCATION bytes and aligned to their size, so they
+  // only need rounding to the atom size if it is bigger
+  vk::DeviceSize atom = m_allocator->m_atomSize;
+  vk::DeviceSize offset = m_offset / atom * atom;
+  vk::DeviceSize size = m_block->dedicated ? VK_WHOLE_SIZE
+                                           : max(rangeSize(m_order), atom);
+  m_allocator->m_device->logical().flushMappedMemoryRanges(
+      vk::MappedMemoryRange{*m_block->memory, offset, size});
+}
+
+// ==== Allocator
+MemoryAllocator::MemoryAllocator(const Device &device) :
+    m_device(std::addressof(device)),
+    m_properties(device.physical().getMemoryProperties()),
+    m_atomSize(device.physical().getProperties().limits.nonCoherentAtomSize)
+{
+  m_blockSizes.resize(m_properties.memoryTypeCount);
+  for (uint32_t i = 0; i < m_properties.memoryTypeCount; i++) {
+    uint32_t heap = m_properties.memoryTypes[i].heapIndex;
+    vk::DeviceSize size = MAX_BLOCK_SIZE;
+    while (size > m_properties.memoryHeaps[heap].size / 8 && size > MIN_ALLOCATION)
+      size /= 2;
+    m_blockSizes[i] = size;
+  }
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+  Stats s = stats();
+  if (s.allocations + s.dedicated > 0)
+    log::warning("Destroying memory allocator with {} allocations still alive",
+                 s.allocations + s.dedicated);
+  log::dbg("Destroying memory allocator with {} blocks", s.blocks);
+}
+
+MemoryAllocator::Block &MemoryAllocator::createBlock(uint32_t memoryType,
+                                                     vk::DeviceSize size,
+                                                     bool linear,
+                                                     bool dedicated)
+{
+  auto flags = m_properties.memoryTypes[memoryType].propertyFlags;
+  vk::raii::DeviceMemory memory(m_device->logical(),
+                                vk::MemoryAllocateInfo{size, memoryType});
+  void *mapped = nullptr;
+  if (flags & vk::MemoryPropertyFlagBits::eHostVisible)
+    mapped = memory.mapMemory(0, VK_WHOLE_SIZE);
+
+  bool coherent = bool(flags & vk::MemoryPropertyFlagBits::eHostCoherent);
+  auto block = make_unique<Block>(Block{std::move(memory), size, mapped, memoryType,
+                                        linear, coherent, dedicated, {}});
+  if (!dedicated) {
+    uint32_t order = orderOf(size);
+    block->free.resize(order + 1);
+    block->free[order].insert(0);
+    log::dbg("Allocated memory block of {} bytes from memory type {}", size, memoryType);
+  }
+  m_blocks.push_back(std::move(block));
+  return *m_blocks.back();
+}
+
+MemoryAllocator::Allocation MemoryAllocator::allocate(
+    const vk::MemoryRequirements &requirements,
+    vk::MemoryPropertyFlags flags,
+    bool linear,
+    bool dedicated)
+{
+  uint32_t memoryType = m_device->findMemoryIndex(requirements.memoryTypeBits, flags);
+  vk::DeviceSize blockSize = m_blockSizes[memoryType];
+
+  lock_guard<mutex> lock(m_mutex);
+  Allocation ret(nullptr);
+  ret.m_size = requirements.size;
+
+  if (dedicated || requirements.size > blockSize / 2) {
+    ret.m_block = &createBlock(memoryType, requirements.size, linear, true);
+    ret.m_block->allocations++;
+    ret.m_allocator = this;
+    return ret;
+  }
+
+  // Ranges are aligned to their size, so this satisfies the alignment too
+  uint32_t order = orderOf(max(requirements.size, requirements.alignment));
+
+  // Take the smallest free range big enough, from the first block that has one
+  Block *block = nullptr;
+  uint32_t found = 0;
+  for (auto &b : m_blocks) {
+    if (b->dedicated || b->memoryType != memoryType || b->linear != linear) continue;
+    for (uint32_t o = order; o < b->free.size(); o++) {
+      if (b->free[o].empty()) continue;
+      if (block == nullptr || o < found) {
+        block = b.get();
+        found = o;
+      }
+      break;
+    }
+    if (block != nullptr && found == order) break;
+  }
+  if (block == nullptr) {
+    block = &createBlock(memoryType, blockSize, linear, false);
+    found = static_cast<uint32_t>(block->free.size() - 1);
+  }
+
+  // Split it in halves, keeping the lower one, until it is the right size
+  auto first = block->free[found].begin();
+  vk::DeviceSize offset = *first;
+  block->free[found].erase(first);
+  while (found > order) {
+    found--;
+    block->free[found].insert(offset + rangeSize(found));
+  }
+
+  block->allocations++;
+  block->used += rangeSize(order);
+  block->requested += requirements.size;
+  ret.m_allocator = this;
+  ret.m_block = block;
+  ret.m_offset = offset;
+  ret.m_order = order;
+  return ret;
+}
+
+void MemoryAllocator::free(Allocation &allocation)
+{
+  lock_guard<mutex> lock(m_mutex);
+  Block *block = allocation.m_block;
+  block->allocations--;
+
+  if (!block->dedicated) {
+    // Merge the range with its buddy for as long as it is free
+    vk::DeviceSize offset = allocation.m_offset;
+    uint32_t order = allocation.m_order;
+    auto top = static_cast<uint32_t>(block->free.size() - 1);
+    while (order < top && block->free[order].erase(offset ^ rangeSize(order)) > 0) {
+      offset &= ~rangeSize(order);
+      order++;
+    }
+    block->free[order].insert(offset);
+    block->used -= rangeSize(allocation.m_order);
+    block->requested -= allocation.m_size;
+  }
+  if (block->allocations > 0) return;
+
+  // Keep one empty block of each kind around, so that allocating and freeing in
+  // a loop does not allocate device memory every time, even if the other blocks
+  // are full
+  auto emptySameKind = [&](const unique_ptr<Block> &b) {
+    return b.get() != block && !b->dedicated && b->allocations == 0 &&
+           b->memoryType == block->memoryType && b->linear == block->linear;
+  };
+  if (!block->dedicated && none_of(m_blocks.begin(), m_blocks.end(), emptySameKind))
+    return;
+
+  if (!block->dedicated)
+    log::dbg("Freeing memory block of {} bytes from memory type {}", block->size,
+             block->memoryType);
+  auto it = find_if(m_blocks.begin(), m_blocks.end(),
+                    [&](const unique_ptr<Block> &b) { return b.get() == block; });
+  m_blocks.erase(it);
+}
+
+MemoryAllocator::Stats MemoryAllocator::stats() const
+{
+  lock_guard<mutex> lock(m_mutex);
+  Stats ret;
+  for (const auto &b : m_blocks) {
+    if (b->dedicated) {
+      ret.dedicated++;
+      ret.dedicatedBytes += b->size;
+      continue;
+    }
+    ret.blocks++;
+    ret.allocations += b->allocations;
+    ret.blockBytes += b->size;
+    ret.usedBytes += b->used;
+    ret.requestedBytes += b->requested;
+    for (uint32_t o = 0; o < b->free.size(); o++) {
+      if (!b->free[o].empty())
+        ret.largestFreeRange = max(ret.largestFreeRange, rangeSize(o));
+    }
+  }
+  return ret;
+}
@@ -26,15 +26,10 @@ Pipeline::Pipeline(std::nullptr_t) : m_layout(nullptr), m_pipeline(nullptr) {}
 
 Pipeline::Pipeline(const Renderer& renderer, const RenderPass& pass, CreateInfo info) :
     m_layout(std::invoke([&]() {
+      // No push constants: per-draw data goes in the instance buffer (see
+      // InstanceData)
       vk::PipelineLayoutCreateInfo layoutInfo{};
 
-      // Push constants
-      vk::PushConstantRange pushConstant{};
-      pushConstant.stageFlags = vk::ShaderStageFlagBits::eVertex;
-      pushConstant.offset = 0;
-      pushConstant.size = sizeof(PushConstants);
-      layoutInfo.setPushConstantRanges(pushConstant);
-
       // Layouts
       // Not using setLayouts since it breaks if passed a vector<>&
       layoutInfo.setLayoutCount = info.descriptorSetLayouts.size();
@@ -102,14 +97,23 @@ static vk::raii::Pipeline createPipeline(const Renderer& renderer,
   dynamicState.setDynamicStates(dynamicStates);
 
   // Vertex input
-  vk::VertexInputBindingDescription bindingDescription{};
-  bindingDescription.binding = 0;
-  bindingDescription.stride = sizeof(Vertex);
-  bindingDescription.inputRate = vk::VertexInputRate::eVertex;
+  vector<vk::VertexInputBindingDescription> bindingDescriptions(1);
+  bindingDescriptions[0].binding = 0;
+  bindingDescriptions[0].stride = info.vertexStride;
+  bindingDescriptions[0].inputRate = vk::VertexInputRate::eVertex;
+
+  // Instance input, if any
+  if (info.instanceStride != 0) {
+    vk::VertexInputBindingDescription instanceDescription{};
+    instanceDescription.binding = InstanceData::BINDING;
+    instanceDescription.stride = info.instanceStride;
+    instanceDescription.inputRate = vk::VertexInputRate::eInstance;
+    bindingDescriptions.push_back(instanceDescription);
+  }
 
   // Attributes
   vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
-  vertexInputInfo.setVertexBindingDescriptions(bindingDescription);
+  vertexInputInfo.setVertexBindingDescriptions(bindingDescriptions);
   vertexInputInfo.setVertexAttributeDescriptions(info.attributes);
 
   // Input Assembly
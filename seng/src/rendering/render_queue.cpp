@@ -0,0 +1,281 @@
+#include <seng/rendering/buffer.hpp>
+#include <seng/rendering/command_buffer.hpp>
+#include <seng/rendering/geometry_arena.hpp>
+#include <seng/rendering/primitive_types.hpp>
+#include <seng/rendering/render_queue.hpp>
+#include <seng/rendering/renderer.hpp>
+#include <seng/resources/mesh.hpp>
+#include <seng/resources/object_shader.hpp>
+#include <seng/resources/object_shader_instance.hpp>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace seng;
+using namespace seng::rendering;
+using namespace std;
+
+static constexpr int PIPELINE_BITS = 8;
+static constexpr int DESCRIPTOR_BITS = 16;
+static constexpr int MESH_BITS = 12;
+static constexpr int LOD_BITS = 4;
+static constexpr int DEPTH_BITS = 24;
+
+static constexpr vk::DeviceSize MIN_CAPACITY = 64 * sizeof(InstanceData);
+static const vk::MemoryPropertyFlags STREAM_MEM_FLAGS =
+    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+static constexpr uint64_t mask(int bits)
+{
+  return (uint64_t(1) << bits) - 1;
+}
+
+RenderQueue::FrameBuffers::FrameBuffers(vk::BufferUsageFlags flags, size_t frames) :
+    usage(flags)
+{
+  buffers.reserve(frames);
+  for (size_t i = 0; i < frames; i++) buffers.emplace_back(nullptr);
+  capacities.resize(frames, 0);
+}
+
+RenderQueue::RenderQueue(Renderer &renderer) :
+    m_renderer(std::addressof(renderer)),
+    m_maxDrawIndirectCount(renderer.device().maxDrawIndirectCount()),
+    m_instanceBuffers(vk::BufferUsageFlagBits::eVertexBuffer, renderer.framesInFlight()),
+    m_indirectBuffers(vk::BufferUsageFlagBits::eIndirectBuffer, renderer.framesInFlight())
+{
+}
+
+uint64_t RenderQueue::makeKey(uint32_t pipeline,
+                              uint32_t descriptorSets,
+                              uint32_t mesh,
+                              size_t lod,
+                              float depth)
+{
+  // Non-negative floats compare like their bit patterns, so the most
+  // significant ones (after the sign) are a quantized depth
+  uint32_t bits;
+  depth = max(depth, 0.0f);
+  memcpy(&bits, &depth, sizeof(bits));
+  uint64_t d = bits >> (31 - DEPTH_BITS);
+
+  uint64_t key = pipeline & mask(PIPELINE_BITS);
+  key = (key << DESCRIPTOR_BITS) | (descriptorSets & mask(DESCRIPTOR_BITS));
+  key = (key << MESH_BITS) | (mesh & mask(MESH_BITS));
+  key = (key << LOD_BITS) | min<uint64_t>(lod, mask(LOD_BITS));
+  key = (key << DEPTH_BITS) | (d & mask(DEPTH_BITS));
+  return key;
+}
+
+// Return the id of the given object, numbering new ones in order of appearance
+static uint32_t idOf(unordered_map<const void *, uint32_t> &ids, const void *ptr)
+{
+  return ids.emplace(ptr, static_cast<uint32_t>(ids.size())).first->second;
+}
+
+void RenderQueue::clear()
+{
+  m_items.clear();
+  m_keys.clear();
+  m_pipelineIds.clear();
+  m_instanceIds.clear();
+  m_meshIds.clear();
+}
+
+void RenderQueue::push(const DrawItem &item, float depth)
+{
+  // Each shader has one pipeline per vertex layout
+  uint32_t shader = idOf(m_pipelineIds, &item.instance->instanceOf());
+  uint32_t pipeline = 2 * shader + (item.mesh->vertexLayout() == VertexLayout::ePacked);
+  uint32_t instance = idOf(m_instanceIds, item.instance);
+  uint32_t mesh = idOf(m_meshIds, item.mesh);
+
+  m_keys.push_back(makeKey(pipeline, instance, mesh, item.lod, depth));
+  m_items.push_back(item);
+}
+
+void RenderQueue::sort()
+{
+  size_t n = m_keys.size();
+  m_order.resize(n);
+  for (size_t i = 0; i < n; i++) m_order[i] = static_cast<uint32_t>(i);
+  m_tmpKeys.resize(n);
+  m_tmpOrder.resize(n);
+
+  // Histograms of all bytes, gathered in a single pass
+  static constexpr int PASSES = sizeof(uint64_t);
+  size_t counts[PASSES][256] = {};
+  for (uint64_t key : m_keys)
+    for (int p = 0; p < PASSES; p++) counts[p][(key >> (8 * p)) & 0xff]++;
+
+  for (int p = 0; p < PASSES; p++) {
+    // All keys have the same byte here, the order doesn't change
+    size_t *count = counts[p];
+    if (n == 0 || count[(m_keys[0] >> (8 * p)) & 0xff] == n) continue;
+
+    size_t offset = 0;
+    for (int b = 0; b < 256; b++) {
+      size_t c = count[b];
+      count[b] = offset;
+      offset += c;
+    }
+    for (size_t i = 0; i < n; i++) {
+      size_t dst = count[(m_keys[i] >> (8 * p)) & 0xff]++;
+      m_tmpKeys[dst] = m_keys[i];
+      m_tmpOrder[dst] = m_order[i];
+    }
+    swap(m_keys, m_tmpKeys);
+    swap(m_order, m_tmpOrder);
+  }
+}
+
+const Buffer &RenderQueue::upload(FrameBuffers &buffers,
+                                  const FrameHandle &handle,
+                                  const void *data,
+                                  vk::DeviceSize size)
+{
+  // The frame's previous submission has completed by now, so its buffer can be
+  // written to or replaced
+  size_t frame = handle.asIndex();
+  Buffer &buffer = buffers.buffers[frame];
+  vk::DeviceSize &capacity = buffers.capacities[frame];
+  if (capacity < size) {
+    capacity = max(capacity, MIN_CAPACITY);
+    while (capacity < size) capacity *= 2;
+    buffer =
+        Buffer(m_renderer->device(), buffers.usage, capacity, STREAM_MEM_FLAGS, true);
+  }
+  buffer.load(data, 0, size, {});
+  return buffer;
+}
+
+// Whether the two items can be drawn with the same instanced draw
+static bool sameBatch(const DrawItem &a, const DrawItem &b)
+{
+  return a.instance == b.instance && a.mesh == b.mesh && a.lod == b.lod;
+}
+
+void RenderQueue::build(Stats &stats)
+{
+  size_t n = m_order.size();
+  m_instances.resize(n);
+  m_commands.clear();
+  m_runs.clear();
+
+  // Instance data is in sorted order, so that each batch is a contiguous range
+  // starting at its first instance
+  for (size_t first = 0, last; first < n; first = last) {
+    const DrawItem &item = m_items[m_order[first]];
+    for (last = first; last < n; last++) {
+      const DrawItem &other = m_items[m_order[last]];
+      if (!sameBatch(item, other)) break;
+      m_instances[last].model = other.model;
+      m_instances[last].uvScale = other.uvScale;
+    }
+
+    // Meshes share the arena's buffers, so they can go in the same run as long
+    // as they are bound in the same way
+    const DrawItem *runItem = m_runs.empty() ? nullptr : &m_items[m_runs.back().item];
+    if (runItem == nullptr || runItem->instance != item.instance ||
+        runItem->mesh->vertexLayout() != item.mesh->vertexLayout() ||
+        runItem->mesh->indexType() != item.mesh->indexType()) {
+      auto firstCommand = static_cast<uint32_t>(m_commands.size());
+      m_runs.push_back({m_order[first], firstCommand, 0});
+    }
+
+    auto count = static_cast<uint32_t>(last - first);
+    for (const auto &range : item.mesh->indexRanges(item.lod)) {
+      m_commands.emplace_back(range.indexCount, count,
+                              item.mesh->firstIndex() + range.firstIndex,
+                              item.mesh->vertexOffset() + range.vertexOffset,
+                              static_cast<uint32_t>(first));
+      m_runs.back().commandCount++;
+    }
+    stats.draws++;
+    stats.instances += count;
+  }
+}
+
+RenderQueue::Stats RenderQueue::record(const FrameHandle &handle,
+                                       const CommandBuffer &cmd)
+{
+  Stats stats;
+  if (m_order.empty()) return stats;
+  build(stats);
+
+  const Buffer &instanceBuffer = upload(m_instanceBuffers, handle, m_instances.data(),
+                                        m_instances.size() * sizeof(InstanceData));
+  cmd.buffer().bindVertexBuffers(InstanceData::BINDING, *instanceBuffer.buffer(), {0});
+
+  bool indirect = m_maxDrawIndirectCount > 0;
+  const Buffer *indirectBuffer = nullptr;
+  if (indirect)
+    indirectBuffer =
+        &upload(m_indirectBuffers, handle, m_commands.data(),
+                m_commands.size() * sizeof(vk::DrawIndexedIndirectCommand));
+
+  const GeometryArena &arena = m_renderer->geometry();
+  const ObjectShader *shader = nullptr;
+  VertexLayout layout = VertexLayout::eFull;
+  const ObjectShaderInstance *instance = nullptr;
+  optional<VertexLayout> vertexLayout;
+  optional<vk::IndexType> indexType;
+
+  for (const Run &run : m_runs) {
+    const DrawItem &item = m_items[run.item];
+
+    const ObjectShader *itemShader = &item.instance->instanceOf();
+    VertexLayout itemLayout = item.mesh->vertexLayout();
+    if (itemShader != shader || itemLayout != layout) {
+      itemShader->use(cmd, itemLayout);
+      shader = itemShader;
+      layout = itemLayout;
+      instance = nullptr;  // Sets have to be bound again with the new pipeline
+      stats.pipelineBinds++;
+    }
+    if (item.instance != instance) {
+      item.instance->bindDescriptorSets(handle, cmd);
+      instance = item.instance;
+      stats.descriptorBinds++;
+    }
+    if (itemLayout != vertexLayout) {
+      cmd.buffer().bindVertexBuffers(0, *arena.vertexBuffer(itemLayout).buffer(), {0});
+      vertexLayout = itemLayout;
+      stats.bufferBinds++;
+    }
+    if (item.mesh->indexType() != indexType) {
+      indexType = item.mesh->indexType();
+      cmd.buffer().bindIndexBuffer(*arena.indexBuffer().buffer(), 0, *indexType);
+      stats.bufferBinds++;
+    }
+
+    if (indirect) {
+      static constexpr auto STRIDE = sizeof(vk::DrawIndexedIndirectCommand);
+      for (uint32_t done = 0; done < run.commandCount;) {
+        uint32_t count = min(run.commandCount - done, m_maxDrawIndirectCount);
+        cmd.buffer().drawIndexedIndirect(*indirectBuffer->buffer(),
+                                         (run.firstCommand + done) * STRIDE, count,
+                                         STRIDE);
+        done += count;
+        stats.calls++;
+      }
+    } else {
+      for (uint32_t c = 0; c < run.commandCount; c++) {
+        const auto &command = m_commands[run.firstCommand + c];
+        cmd.buffer().drawIndexed(command.indexCount, command.instanceCount,
+                                 command.firstIndex, command.vertexOffset,
+                                 command.firstInstance);
+        stats.calls++;
+      }
+    }
+  }
+  return stats;
+}
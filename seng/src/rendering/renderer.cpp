@@ -6,11 +6,13 @@
 #include <seng/rendering/buffer.hpp>
 #include <seng/rendering/debug_messenger.hpp>
 #include <seng/rendering/device.hpp>
+#include <seng/rendering/geometry_arena.hpp>
 #include <seng/rendering/glfw_window.hpp>
 #include <seng/rendering/global_uniform.hpp>
 #include <seng/rendering/render_pass.hpp>
 #include <seng/rendering/renderer.hpp>
 #include <seng/rendering/swapchain.hpp>
+#include <seng/rendering/uploader.hpp>
 #include <seng/resources/mesh.hpp>
 #include <seng/resources/texture.hpp>
 #include <seng/utils.hpp>
@@ -27,6 +29,7 @@
 #include <cstddef>
 #include <cstdint>    // for uint32_t
 #include <exception>  // for exception
+#include <memory>     // for make_unique
 #include <optional>   // for optional
 #include <stdexcept>  // for runtime_error
 #include <string>     // for basic_string, allocator
@@ -100,11 +103,14 @@ Renderer::Renderer(Application &app, const GlfwWindow &window) :
                   {vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
                    *m_device.queueFamilyIndices().graphicsFamily}),
     m_descriptorPool(m_device.logical(), POOL_INFO),
+    m_uploader(std::make_unique<Uploader>(m_device)),
 
     // Renderpass is intialized later
     m_renderPass(nullptr),
 
     // Other stuff
+    m_geometry(std::make_unique<GeometryArena>(m_device, m_commandPool,
+                                               m_swapchain.MAX_FRAMES_IN_FLIGHT)),
     m_fallbackMesh(*this),
     m_gubo(nullptr)
 {
@@ -391,7 +397,19 @@ Mesh &Renderer::requestMesh(const std::string &name)
 
   if (iter != m_meshes.end()) return iter->second;
   auto ret = m_meshes.try_emplace(
-      name, Mesh::loadFromDisk(*this, m_app->config().assetPath, name));
+      name, Mesh::loadFromDisk(*this, m_app->config().assetPath, name,
+                               MeshLoadOptions::fromConfig(*m_app)));
+  return ret.first->second;
+}
+
+bool Renderer::hasMesh(const std::string &name) const
+{
+  return m_meshes.find(name) != m_meshes.end();
+}
+
+Mesh &Renderer::insertMesh(const std::string &name, Mesh mesh)
+{
+  auto ret = m_meshes.insert_or_assign(name, std::move(mesh));
   return ret.first->second;
 }
 
@@ -440,6 +458,23 @@ const Texture &Renderer::requestTexture(const std::string &name, TextureType typ
   return ret.first->second;
 }
 
+bool Renderer::hasTexture(const std::string &name, TextureType type) const
+{
+  size_t hash{0};
+  seng::internal::hashCombine(hash, name, type);
+  return m_textures.find(hash) != m_textures.end();
+}
+
+const Texture &Renderer::insertTexture(const std::string &name,
+                                       TextureType type,
+                                       Texture tex)
+{
+  size_t hash{0};
+  seng::internal::hashCombine(hash, name, type);
+  auto ret = m_textures.insert_or_assign(hash, std::move(tex));
+  return ret.first->second;
+}
+
 void Renderer::clearTexture(const std::string &name, TextureType type)
 {
   size_t hash{0};
@@ -486,6 +521,9 @@ optional<FrameHandle> Renderer::beginFrame()
         log::error("{}", vk::to_string(result));
         return nullopt;
     }
+    m_uploader->frameCompleted(m_currentFrame);
+    m_uploader->collect();
+    m_geometry->collect();
 
     std::tie(result, frame.m_index) =
         m_swapchain.swapchain().acquireNextImage(timeout, *frame.m_imageAvailableSem);
@@ -552,20 +590,26 @@ void Renderer::endFrame(FrameHandle &handle)
   vk::SubmitInfo submitInfo{};
   std::array<vk::CommandBuffer, 1> commandBuffers = {*frame.m_commandBuffer.buffer()};
   std::array<vk::Semaphore, 1> queueCompleteSems = {*frame.m_queueCompleteSem};
-  std::array<vk::Semaphore, 1> imageAvailableSems = {*frame.m_imageAvailableSem};
+  std::vector<vk::Semaphore> waitSems = {*frame.m_imageAvailableSem};
 
   submitInfo.setCommandBuffers(commandBuffers);
   // The semaphore(s) to be signaled when the queue is complete.
   submitInfo.setSignalSemaphores(queueCompleteSems);
-  // Wait semaphore ensures that the operation cannot begin until the image is available
-  submitInfo.setWaitSemaphores(imageAvailableSems);
 
   // Each semaphore waits on the corresponding pipeline stage to complete.
   // 1:1 ratio. VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT prevents
   // subsequent colour attachment writes from executing until the semaphore
   // signals (i.e. one frame is presented at a time)
-  array<vk::PipelineStageFlags, 1> flags = {
+  vector<vk::PipelineStageFlags> flags = {
       vk::PipelineStageFlagBits::eColorAttachmentOutput};
+
+  // Uploads made on the transfer queue since the last frame have to complete
+  // before anything reads their data
+  m_uploader->takeSemaphores(handle.asIndex(), waitSems);
+  flags.resize(waitSems.size(), Uploader::WAIT_STAGES);
+
+  // Wait semaphore ensures that the operation cannot begin until the image is available
+  submitInfo.setWaitSemaphores(waitSems);
   submitInfo.setWaitDstStageMask(flags);
 
   m_device.graphicsQueue().submit(submitInfo, *frame.m_inFlightFence);
@@ -0,0 +1,73 @@
+#include <seng/log.hpp>
+#include <seng/rendering/buffer.hpp>
+#include <seng/rendering/command_buffer.hpp>
+#include <seng/rendering/upload_batch.hpp>
+#include <seng/rendering/uploader.hpp>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+
+using namespace std;
+using namespace seng::rendering;
+
+static vk::MemoryPropertyFlags STAGING_MEMORY =
+    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+UploadBatch::UploadBatch(Uploader &uploader) : m_uploader(std::addressof(uploader)) {}
+
+UploadBatch::~UploadBatch()
+{
+  if (m_pin.has_value()) m_uploader->unpin(*m_pin);
+}
+
+void UploadBatch::copy(const void *data,
+                       vk::DeviceSize size,
+                       const Buffer &dst,
+                       vk::DeviceSize offset)
+{
+  Uploader::Staged staged = stage(data, size);
+  m_commands.push_back([staged, &dst, size, offset](CommandBuffer &cmd) {
+    cmd.buffer().copyBuffer(*staged.buffer->buffer(), *dst.buffer(),
+                            vk::BufferCopy{staged.offset, offset, size});
+  });
+}
+
+Uploader::Staged UploadBatch::stage(const void *data, vk::DeviceSize size)
+{
+  if (!m_pin.has_value()) m_pin = m_uploader->pin();
+  m_stagedBytes += size;
+
+  optional<vk::DeviceSize> offset = m_uploader->stage(data, size);
+  if (offset.has_value()) return {&m_uploader->ring(), *offset};
+
+  log::dbg("Staging {} bytes outside of the staging ring", size);
+  Buffer &staging = m_staging.emplace_back(m_uploader->device(),
+                                           vk::BufferUsageFlagBits::eTransferSrc, size,
+                                           STAGING_MEMORY, true);
+  staging.load(data, 0, size, {});
+  return {&staging, 0};
+}
+
+void UploadBatch::record(function<void(CommandBuffer &)> commands)
+{
+  m_commands.push_back(std::move(commands));
+  m_graphics = true;
+}
+
+void UploadBatch::submit()
+{
+  if (m_commands.empty()) return;
+
+  log::dbg("Submitting {} transfers ({} bytes staged)", m_commands.size(), m_stagedBytes);
+  m_uploader->submit(m_commands, m_graphics, std::move(m_staging), m_pin);
+
+  m_pin.reset();
+  m_commands.clear();
+  m_staging.clear();
+  m_stagedBytes = 0;
+  m_graphics = false;
+}
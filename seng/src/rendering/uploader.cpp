@@ -0,0 +1,191 @@
+#include <seng/log.hpp>
+#include <seng/rendering/buffer.hpp>
+#include <seng/rendering/command_buffer.hpp>
+#include <seng/rendering/device.hpp>
+#include <seng/rendering/uploader.hpp>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+using namespace seng;
+using namespace seng::rendering;
+using namespace std;
+
+static const vk::MemoryPropertyFlags STAGING_MEMORY =
+    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+static vk::raii::CommandPool createPool(const Device &device, uint32_t family)
+{
+  return vk::raii::CommandPool(device.logical(),
+                               {vk::CommandPoolCreateFlagBits::eTransient, family});
+}
+
+Uploader::Uploader(const Device &device) :
+    m_device(std::addressof(device)),
+    m_graphicsPool(createPool(device, *device.queueFamilyIndices().graphicsFamily)),
+    m_transferPool(device.hasTransferQueue()
+                       ? createPool(device, *device.queueFamilyIndices().transferFamily)
+                       : vk::raii::CommandPool(nullptr)),
+    m_ring(device, vk::BufferUsageFlagBits::eTransferSrc, RING_SIZE, STAGING_MEMORY, true)
+{
+  log::dbg("Allocated staging ring of {} bytes", RING_SIZE);
+}
+
+Uploader::~Uploader()
+{
+  waitIdle();
+}
+
+uint64_t Uploader::pin()
+{
+  m_pins.insert(m_head);
+  return m_head;
+}
+
+void Uploader::unpin(uint64_t pin)
+{
+  auto it = m_pins.find(pin);
+  if (it != m_pins.end()) m_pins.erase(it);
+}
+
+optional<vk::DeviceSize> Uploader::reserve(vk::DeviceSize size)
+{
+  uint64_t start = (m_head + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+  // Data can't wrap around, skip to the start of the ring instead
+  vk::DeviceSize offset = start % RING_SIZE;
+  if (offset + size > RING_SIZE) {
+    start += RING_SIZE - offset;
+    offset = 0;
+  }
+  if (start + size - m_tail > RING_SIZE) return nullopt;
+  m_head = start + size;
+  return offset;
+}
+
+optional<vk::DeviceSize> Uploader::stage(const void *data, vk::DeviceSize size)
+{
+  if (size > RING_SIZE) return nullopt;
+
+  collect();
+  optional<vk::DeviceSize> offset = reserve(size);
+  if (!offset.has_value() && !m_pending.empty())
+    log::dbg("Staging ring is full, waiting for pending uploads");
+  while (!offset.has_value() && !m_pending.empty()) {
+    vk::Result result = m_device->logical().waitForFences(
+        *m_pending.front().fence, true, numeric_limits<uint64_t>::max());
+    if (result != vk::Result::eSuccess)
+      log::error("Waiting for pending upload: {}", vk::to_string(result));
+    retire();
+    collect();
+    offset = reserve(size);
+  }
+
+  if (offset.has_value()) m_ring.load(data, *offset, size, {});
+  return offset;
+}
+
+void Uploader::submit(const vector<function<void(CommandBuffer &)>> &commands,
+                      bool graphics,
+                      deque<Buffer> &&keepAlive,
+                      optional<uint64_t> pin)
+{
+  bool transfer = !graphics && m_device->hasTransferQueue();
+  CommandBuffer cmd(*m_device, transfer ? m_transferPool : m_graphicsPool);
+  cmd.begin(CommandBuffer::SingleUse::eOn);
+  for (const auto &c : commands) c(cmd);
+  if (!transfer) {
+    // Later submissions to the graphics queue are ordered after this one, so a
+    // barrier is enough to make the writes visible to them
+    vk::MemoryBarrier barrier{vk::AccessFlagBits::eTransferWrite,
+                              vk::AccessFlagBits::eVertexAttributeRead |
+                                  vk::AccessFlagBits::eIndexRead |
+                                  vk::AccessFlagBits::eUniformRead |
+                                  vk::AccessFlagBits::eShaderRead};
+    cmd.buffer().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, WAIT_STAGES, {},
+                                 barrier, {}, {});
+  }
+  cmd.end();
+
+  vk::raii::Fence fence(m_device->logical(), vk::FenceCreateInfo{});
+  vk::CommandBuffer handle = *cmd.buffer();
+  vk::SubmitInfo info{};
+  info.setCommandBuffers(handle);
+  if (transfer) {
+    if (m_freeSemaphores.empty())
+      m_freeSemaphores.emplace_back(m_device->logical(), vk::SemaphoreCreateInfo{});
+    vk::Semaphore signal = *m_freeSemaphores.back();
+    info.setSignalSemaphores(signal);
+    m_device->transferQueue().submit(info, *fence);
+    m_signaledSemaphores.push_back(std::move(m_freeSemaphores.back()));
+    m_freeSemaphores.pop_back();
+  } else {
+    m_device->graphicsQueue().submit(info, *fence);
+  }
+
+  m_pending.push_back(
+      {std::move(cmd), std::move(fence), m_head, std::move(keepAlive), pin});
+}
+
+void Uploader::retire()
+{
+  // Space pinned by other batches is not given back, even if staged earlier
+  uint64_t end = m_pending.front().end;
+  if (m_pending.front().pin.has_value()) unpin(*m_pending.front().pin);
+  m_pending.pop_front();
+  if (!m_pins.empty()) end = min(end, *m_pins.begin());
+  m_tail = max(m_tail, end);
+}
+
+void Uploader::collect()
+{
+  // Submissions to different queues may complete out of order, but retiring
+  // them in order keeps the ring contiguous
+  while (!m_pending.empty() &&
+         m_pending.front().fence.getStatus() == vk::Result::eSuccess)
+    retire();
+
+  // Without anything in flight, all but the space pinned by open batches is free
+  if (m_pending.empty())
+    m_tail = max(m_tail, m_pins.empty() ? m_head : *m_pins.begin());
+}
+
+void Uploader::waitIdle()
+{
+  if (m_pending.empty()) return;
+
+  vector<vk::Fence> fences;
+  fences.reserve(m_pending.size());
+  for (const auto &s : m_pending) fences.push_back(*s.fence);
+  vk::Result result =
+      m_device->logical().waitForFences(fences, true, numeric_limits<uint64_t>::max());
+  if (result != vk::Result::eSuccess)
+    log::error("Waiting for pending uploads: {}", vk::to_string(result));
+  collect();
+}
+
+void Uploader::takeSemaphores(size_t frame, vector<vk::Semaphore> &semaphores)
+{
+  if (m_frameSemaphores.size() <= frame) m_frameSemaphores.resize(frame + 1);
+  for (auto &s : m_signaledSemaphores) {
+    semaphores.push_back(*s);
+    m_frameSemaphores[frame].push_back(std::move(s));
+  }
+  m_signaledSemaphores.clear();
+}
+
+void Uploader::frameCompleted(size_t frame)
+{
+  if (frame >= m_frameSemaphores.size()) return;
+  for (auto &s : m_frameSemaphores[frame]) m_freeSemaphores.push_back(std::move(s));
+  m_frameSemaphores[frame].clear();
+}
@@ -0,0 +1,151 @@
+#include <seng/application.hpp>
+#include <seng/components/mesh_renderer.hpp>
+#include <seng/jobs/job_system.hpp>
+#include <seng/log.hpp>
+#include <seng/rendering/primitive_types.hpp>
+#include <seng/rendering/renderer.hpp>
+#include <seng/rendering/upload_batch.hpp>
+#include <seng/resources/asset_preloader.hpp>
+#include <seng/resources/mesh.hpp>
+#include <seng/resources/object_shader.hpp>
+#include <seng/resources/object_shader_instance.hpp>
+#include <seng/resources/shader_cache.hpp>
+#include <seng/resources/texture.hpp>
+#include <seng/scene/entity.hpp>
+#include <seng/scene/scene.hpp>
+#include <seng/time.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+using namespace seng;
+using namespace std;
+
+AssetPreloader::AssetPreloader(const Application &app) : m_app(std::addressof(app)) {}
+
+AssetPreloader::~AssetPreloader()
+{
+  // Pending jobs still reference the assets
+  if (m_started) m_app->jobs()->wait(m_counter);
+}
+
+void AssetPreloader::add(Scene &scene)
+{
+  const auto &instances = m_app->renderer()->shaders().objectShaderInstances();
+  scene.view<MeshRenderer>().each([&](Entity &, MeshRenderer &mr) {
+    if (!mr.meshName().empty()) m_meshNames.insert(mr.meshName());
+
+    auto instance = instances.find(mr.shaderInstanceName());
+    if (instance == instances.end()) return;
+    const auto &layout = instance->second.instanceOf().textureLayout();
+    const auto &paths = instance->second.texturePaths();
+    for (size_t i = 0; i < layout.size() && i < paths.size(); i++)
+      m_textureNames.emplace(paths[i], layout[i]);
+  });
+}
+
+void AssetPreloader::start()
+{
+  if (m_started) return;
+  m_started = true;
+
+  const auto &renderer = *m_app->renderer();
+  for (const auto &name : m_meshNames)
+    if (!renderer.hasMesh(name)) m_meshes.push_back({name, nullopt});
+  for (const auto &[name, type] : m_textureNames)
+    if (!renderer.hasTexture(name, type)) m_textures.push_back({name, type, nullopt});
+  log::dbg("Preloading {} meshes and {} textures", m_meshes.size(), m_textures.size());
+
+  // Assets are not added anymore, so references to them stay valid
+  const auto &assetPath = m_app->config().assetPath;
+  auto &jobs = *m_app->jobs();
+  MeshLoadOptions opts = MeshLoadOptions::fromConfig(*m_app);
+  for (auto &asset : m_meshes) {
+    jobs.run(
+        [this, &asset, &renderer, &assetPath, opts]() {
+          Timestamp start = Clock::now();
+          asset.mesh = Mesh::loadFromDisk(renderer, assetPath, asset.name, opts);
+          asset.seconds = inSeconds(Clock::now() - start);
+          m_decoded++;
+        },
+        &m_counter);
+  }
+  for (auto &asset : m_textures) {
+    jobs.run(
+        [this, &asset, &assetPath]() {
+          Timestamp start = Clock::now();
+          asset.pixels = Texture::decodeFromDisk(assetPath, asset.name);
+          asset.seconds = inSeconds(Clock::now() - start);
+          m_decoded++;
+        },
+        &m_counter);
+  }
+}
+
+void AssetPreloader::upload()
+{
+  start();
+  m_app->jobs()->wait(m_counter);
+
+  auto &renderer = *m_app->renderer();
+  rendering::UploadBatch batch(renderer.uploader());
+  Timestamp start = Clock::now();
+
+  float decodeTime = 0.0f;
+  size_t meshBytes = 0, fullMeshBytes = 0;
+  for (auto &asset : m_meshes) {
+    log::dbg("Decoded mesh {} in {}ms", asset.name, asset.seconds * 1000.0f);
+    decodeTime += asset.seconds;
+    if (asset.mesh.has_value() && !asset.mesh->vertices().empty()) {
+      asset.mesh->sync(batch);
+      meshBytes += asset.mesh->deviceSize();
+      fullMeshBytes += asset.mesh->vertices().size() * sizeof(rendering::Vertex) +
+                       asset.mesh->indices().size() * sizeof(uint32_t);
+    }
+  }
+
+  // Textures can't be moved until the batch has been submitted
+  deque<Texture> textures;
+  for (auto &asset : m_textures) {
+    log::dbg("Decoded texture {} in {}ms", asset.name, asset.seconds * 1000.0f);
+    decodeTime += asset.seconds;
+    if (!asset.pixels.has_value()) {
+      log::error("Allocating fallback texture for {}", asset.name);
+      textures.emplace_back(renderer, asset.type);
+      continue;
+    }
+    try {
+      textures.emplace_back(renderer, asset.type, SamplerOptions::optimal(renderer),
+                            *asset.pixels, batch);
+    } catch (const exception &e) {
+      log::error("Could not create texture {}: {}", asset.name, e.what());
+      textures.emplace_back(renderer, asset.type);
+    }
+    asset.pixels.reset();
+  }
+
+  size_t bytes = batch.stagedBytes();
+  batch.submit();
+
+  for (auto &asset : m_meshes)
+    if (asset.mesh.has_value()) renderer.insertMesh(asset.name, std::move(*asset.mesh));
+  for (size_t i = 0; i < m_textures.size(); i++) {
+    const auto &asset = m_textures[i];
+    renderer.insertTexture(asset.name, asset.type, std::move(textures[i]));
+  }
+
+  log::info("Preloaded {} assets ({}s of decoding), submitted {} bytes in {}s",
+            assetCount(), decodeTime, bytes, inSeconds(Clock::now() - start));
+  log::info("Meshes take {} bytes on the device ({} with full vertices and 32 bit "
+            "indices)",
+            meshBytes, fullMeshBytes);
+  m_meshes.clear();
+  m_textures.clear();
+}
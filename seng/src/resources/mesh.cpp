@@ -1,141 +1,329 @@
+#include <seng/application.hpp>
 #include <seng/log.hpp>
-#include <seng/rendering/buffer.hpp>
+#include <seng/math.hpp>
+#include <seng/rendering/geometry_arena.hpp>
 #include <seng/rendering/primitive_types.hpp>
 #include <seng/rendering/renderer.hpp>
+#include <seng/rendering/upload_batch.hpp>
 #include <seng/resources/mesh.hpp>
-
-#include <tiny_obj_loader.h>
+#include <seng/resources/mesh_cache.hpp>
+#include <seng/resources/mesh_optimizer.hpp>
+#include <seng/resources/mesh_simplifier.hpp>
+#include <seng/resources/obj_parser.hpp>
+#include <seng/time.hpp>
+#include <seng/utils.hpp>
+
+#include <glm/common.hpp>
 #include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
 #include <vulkan/vulkan_raii.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <exception>
+#include <functional>
 #include <filesystem>
 #include <memory>
+#include <string>
+#include <vector>
 
 using namespace seng;
 using namespace seng::rendering;
 using namespace std;
 
-static constexpr vk::BufferUsageFlags vertexBufferUsage =
-    vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferSrc |
-    vk::BufferUsageFlagBits::eTransferDst;
-static constexpr vk::BufferUsageFlags indexBufferUsage =
-    vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferSrc |
-    vk::BufferUsageFlagBits::eTransferDst;
+MeshLoadOptions MeshLoadOptions::fromConfig(const Application &app)
+{
+  MeshLoadOptions opts;
+  opts.cachePath = app.config().meshCachePath;
+  opts.optimize = app.config().optimizeMeshes;
+  opts.layout = app.config().packVertices ? VertexLayout::ePacked : VertexLayout::eFull;
+  opts.lodLevels = app.config().meshLodLevels;
+  opts.jobs = app.jobs().get();
+  return opts;
+}
 
 Mesh::Mesh(const Renderer &renderer) :
     m_renderer(std::addressof(renderer)),
     m_vertices(),
     m_indices(),
-    m_vbo(nullopt),
-    m_ibo(nullopt)
+    m_layout(VertexLayout::eFull),
+    m_indexType(vk::IndexType::eUint32),
+    m_lods(),
+    m_ranges(),
+    m_bounds(),
+    m_radius(0.0f),
+    m_vertexAlloc(nullptr),
+    m_indexAlloc(nullptr)
+{
+}
+
+// Each range is an additional draw call, past this 32 bit indices are used
+static constexpr size_t MAX_16BIT_RANGES = 8;
+
+// Split the triangles of the given level of detail in ranges, in order, whose
+// indices span at most 2^16 vertices. Returns false if more than
+// MAX_16BIT_RANGES ranges are needed, or if a single triangle is too wide to fit
+// in any range.
+static bool split16BitRanges(const std::vector<uint32_t> &indices,
+                             const Mesh::Lod &lod,
+                             std::vector<Mesh::IndexRange> &ranges)
 {
+  ranges.clear();
+  size_t first = lod.firstIndex, last = size_t{lod.firstIndex} + lod.indexCount;
+  uint32_t lo = UINT32_MAX, hi = 0;
+  for (size_t i = first; i < last; i += 3) {
+    size_t end = std::min(i + 3, last);
+    uint32_t triLo = *std::min_element(&indices[i], &indices[0] + end);
+    uint32_t triHi = *std::max_element(&indices[i], &indices[0] + end);
+    if (triHi - triLo > UINT16_MAX) return false;
+
+    if (i > first && std::max(hi, triHi) - std::min(lo, triLo) > UINT16_MAX) {
+      if (ranges.size() + 1 == MAX_16BIT_RANGES) return false;
+      ranges.push_back({static_cast<uint32_t>(first), static_cast<uint32_t>(i - first),
+                        static_cast<int32_t>(lo)});
+      first = i;
+      lo = UINT32_MAX;
+      hi = 0;
+    }
+    lo = std::min(lo, triLo);
+    hi = std::max(hi, triHi);
+  }
+  if (first < last)
+    ranges.push_back({static_cast<uint32_t>(first), static_cast<uint32_t>(last - first),
+                      static_cast<int32_t>(lo)});
+  return true;
 }
 
 Mesh::Mesh(const Renderer &renderer,
            std::vector<Vertex> vertices,
-           std::vector<uint32_t> indices) :
+           std::vector<uint32_t> indices,
+           VertexLayout layout,
+           std::vector<Lod> lods) :
     m_renderer(std::addressof(renderer)),
     m_vertices(std::move(vertices)),
     m_indices(std::move(indices)),
-    m_vbo(nullopt),
-    m_ibo(nullopt)
+    m_layout(layout),
+    m_indexType(vk::IndexType::eUint16),
+    m_lods(std::move(lods)),
+    m_ranges(),
+    m_bounds(),
+    m_radius(0.0f),
+    m_vertexAlloc(nullptr),
+    m_indexAlloc(nullptr)
 {
+  if (m_lods.empty()) m_lods.push_back({0, static_cast<uint32_t>(m_indices.size()), 0});
+
+  m_ranges.resize(m_lods.size());
+  for (size_t i = 0; i < m_lods.size(); i++) {
+    if (!split16BitRanges(m_indices, m_lods[i], m_ranges[i])) {
+      m_indexType = vk::IndexType::eUint32;
+      break;
+    }
+  }
+  if (m_indexType == vk::IndexType::eUint32) {
+    for (size_t i = 0; i < m_lods.size(); i++)
+      m_ranges[i] = {{m_lods[i].firstIndex, m_lods[i].indexCount, 0}};
+  }
+
+  if (m_vertices.empty()) return;
+  m_bounds = {m_vertices[0].pos, m_vertices[0].pos};
+  for (const auto &v : m_vertices) {
+    m_bounds.min = glm::min(m_bounds.min, v.pos);
+    m_bounds.max = glm::max(m_bounds.max, v.pos);
+  }
+  glm::vec3 center = m_bounds.center();
+  for (const auto &v : m_vertices)
+    m_radius = std::max(m_radius, glm::length(v.pos - center));
 }
 
-static void uploadTo(const Device &device,
-                     const vk::raii::CommandPool &pool,
-                     const vk::raii::Queue &queue,
-                     const Buffer &to,
-                     vk::DeviceSize size,
-                     vk::DeviceSize offset,
-                     const void *data)
+// Size in bytes of an index of the given type
+static size_t indexSize(vk::IndexType type)
 {
-  vk::MemoryPropertyFlags hostVisible = vk::MemoryPropertyFlagBits::eHostCoherent |
-                                        vk::MemoryPropertyFlagBits::eHostVisible;
+  return type == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
 
-  Buffer temp(device, vk::BufferUsageFlagBits::eTransferSrc, size, hostVisible, true);
-  temp.load(data, 0, size, {});
-  temp.copy(to, {0, offset, size}, pool, queue);
+uint32_t Mesh::firstIndex() const
+{
+  return static_cast<uint32_t>(m_indexAlloc.offset() / indexSize(m_indexType));
 }
 
 void Mesh::sync()
+{
+  rendering::UploadBatch batch(m_renderer->uploader());
+  sync(batch);
+  batch.submit();
+}
+
+void Mesh::sync(rendering::UploadBatch &batch)
 {
   if (m_vertices.size() == 0 || m_indices.size() == 0) {
     seng::log::warning("No data to sync... aborting");
     return;
   }
-  seng::log::dbg("Uploading mesh to device");
+  size_t vertexBytes = m_vertices.size() * vertexSize(m_layout);
+  size_t indexBytes = m_indices.size() * indexSize(m_indexType);
+  seng::log::dbg("Uploading mesh to device ({} bytes of vertices, {} of indices)",
+                 vertexBytes, indexBytes);
+
+  auto &arena = m_renderer->geometry();
+  if (!m_vertexAlloc.valid())
+    m_vertexAlloc = arena.allocateVertices(m_layout, m_vertices.size());
+  if (!m_indexAlloc.valid())
+    m_indexAlloc = arena.allocateIndices(m_indexType, m_indices.size());
+  const Buffer &vbo = arena.vertexBuffer(m_layout);
+  const Buffer &ibo = arena.indexBuffer();
+
+  // Data is staged right away, so the packed data can be temporary
+  if (m_layout == VertexLayout::ePacked) {
+    std::vector<PackedVertex> packed;
+    packed.reserve(m_vertices.size());
+    for (const auto &v : m_vertices) packed.push_back(PackedVertex::pack(v));
+    batch.copy(packed.data(), vertexBytes, vbo, m_vertexAlloc.offset());
+  } else {
+    batch.copy(m_vertices.data(), vertexBytes, vbo, m_vertexAlloc.offset());
+  }
+  if (m_indexType == vk::IndexType::eUint16) {
+    std::vector<uint16_t> narrow(m_indices.size());
+    for (const auto &lodRanges : m_ranges) {
+      for (const auto &range : lodRanges) {
+        for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; i++)
+          narrow[i] = m_indices[i] - range.vertexOffset;
+      }
+    }
+    batch.copy(narrow.data(), indexBytes, ibo, m_indexAlloc.offset());
+  } else {
+    batch.copy(m_indices.data(), indexBytes, ibo, m_indexAlloc.offset());
+  }
+}
 
-  if (!m_vbo.has_value())
-    m_vbo = Buffer(m_renderer->device(), vertexBufferUsage,
-                   m_vertices.size() * sizeof(Vertex));
-  if (!m_ibo.has_value())
-    m_ibo = Buffer(m_renderer->device(), indexBufferUsage,
-                   m_indices.size() * sizeof(uint32_t));
+size_t Mesh::deviceSize() const
+{
+  return m_vertices.size() * vertexSize(m_layout) +
+         m_indices.size() * indexSize(m_indexType);
+}
 
-  const auto &device = m_renderer->device();
-  const auto &cmdPool = m_renderer->commandPool();
-  const auto &queue = device.graphicsQueue();
+void Mesh::free()
+{
+  m_vertexAlloc = nullptr;
+  m_indexAlloc = nullptr;
+}
 
-  uploadTo(device, cmdPool, queue, *m_vbo, m_vertices.size() * sizeof(Vertex), 0,
-           m_vertices.data());
-  uploadTo(device, cmdPool, queue, *m_ibo, m_indices.size() * sizeof(uint32_t), 0,
-           m_indices.data());
+void Mesh::vertexLayout(VertexLayout layout)
+{
+  if (layout == m_layout) return;
+  m_layout = layout;
+  free();
 }
 
-Mesh Mesh::loadFromDisk(const Renderer &renderer,
-                        const std::string &assetPath,
-                        const std::string &name)
+// Build the vertex referenced by the given face vertex
+static Vertex makeVertex(const ObjData &obj, const ObjIndex &index)
 {
-  std::string modelPath{filesystem::path{assetPath} / filesystem::path{name}};
-  if (!filesystem::exists(modelPath)) {
-    seng::log::error("Could not locate {}, returning empty mesh", name);
-    return Mesh(renderer);
-  }
+  // Lifted from vulkan-tutorial.com's "Loading models" chapter with minor adaptations
+  Vertex vertex{};
 
-  tinyobj::attrib_t attrib;
-  std::vector<tinyobj::shape_t> shapes;
-  std::vector<tinyobj::material_t> materials;
-  std::string err;
+  vertex.pos = {obj.positions[3 * index.vertex + 0], obj.positions[3 * index.vertex + 1],
+                obj.positions[3 * index.vertex + 2]};
 
-  // Lifted from vulkan-tutorial.com's "Loading models" chapter with minor adaptations
-  if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, modelPath.c_str())) {
-    seng::log::error("Could not load {}, returning empty mesh", name);
-    return Mesh(renderer);
+  if (index.normal >= 0) {
+    vertex.normal = {obj.normals[3 * index.normal + 0], obj.normals[3 * index.normal + 1],
+                     obj.normals[3 * index.normal + 2]};
+    vertex.normal = glm::normalize(vertex.normal);
   }
-  seng::log::dbg("Loaded mesh {} from disk", name);
 
-  std::vector<Vertex> vertices;
-  std::vector<uint32_t> indices;
-  std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-  for (const auto &shape : shapes) {
-    for (const auto &index : shape.mesh.indices) {
-      Vertex vertex{};
+  if (index.texcoord >= 0)
+    vertex.texCoord = {obj.texcoords[2 * index.texcoord + 0],
+                       1.0f - obj.texcoords[2 * index.texcoord + 1]};
 
-      vertex.pos = {attrib.vertices[3 * index.vertex_index + 0],
-                    attrib.vertices[3 * index.vertex_index + 1],
-                    attrib.vertices[3 * index.vertex_index + 2]};
+  vertex.color = {1.0f, 1.0f, 1.0f};
 
-      vertex.normal = {attrib.normals[3 * index.normal_index + 0],
-                       attrib.normals[3 * index.normal_index + 1],
-                       attrib.normals[3 * index.normal_index + 2]};
-      vertex.normal = glm::normalize(vertex.normal);
+  vertex.tangent = {0.0f, 0.0f, 0.0f};
+  return vertex;
+}
 
-      vertex.texCoord = {attrib.texcoords[2 * index.texcoord_index + 0],
-                         1.0f - attrib.texcoords[2 * index.texcoord_index + 1]};
+// Fibonacci hashing, spreads the given hash over a table of 2^bits slots
+static size_t slotOf(uint64_t hash, unsigned int bits)
+{
+  return (hash * 0x9e3779b97f4a7c15) >> (64 - bits);
+}
 
-      vertex.color = {1.0f, 1.0f, 1.0f};
+static uint64_t hashIndex(const ObjIndex &index)
+{
+  uint64_t hash = static_cast<uint32_t>(index.vertex);
+  hash = hash * 0x100000001b3 + static_cast<uint32_t>(index.normal);
+  hash = hash * 0x100000001b3 + static_cast<uint32_t>(index.texcoord);
+  return hash;
+}
 
-      vertex.tangent = {0.0f, 0.0f, 0.0f};
+static bool sameIndex(const ObjIndex &lhs, const ObjIndex &rhs)
+{
+  return lhs.vertex == rhs.vertex && lhs.normal == rhs.normal &&
+         lhs.texcoord == rhs.texcoord;
+}
 
-      if (uniqueVertices.count(vertex) == 0) {
-        uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+// Deduplicate the vertices referenced by the faces, in order of first appearance.
+//
+// Face vertices are looked up by their index tuple in an open-addressing table.
+// Since different tuples can still result in the same vertex (e.g. if the file
+// repeats a position), vertices of new tuples are also looked up by value, in a
+// second one. Both are sized upfront from the number of indices, with a load
+// factor of at most 1/2, so they never grow.
+static void buildVertices(const ObjData &obj,
+                          std::vector<Vertex> &vertices,
+                          std::vector<uint32_t> &indices)
+{
+  constexpr uint32_t EMPTY = UINT32_MAX;
+  struct TupleSlot {
+    ObjIndex key;
+    uint32_t vertex;
+  };
+
+  unsigned int bits = 4;
+  while ((size_t{1} << bits) < 2 * obj.indices.size()) bits++;
+  size_t mask = (size_t{1} << bits) - 1;
+  std::vector<TupleSlot> tuples(mask + 1, TupleSlot{{0, 0, 0}, EMPTY});
+  std::vector<uint32_t> values(mask + 1, EMPTY);
+  std::hash<Vertex> hasher;
+
+  indices.reserve(obj.indices.size());
+  for (const auto &index : obj.indices) {
+    size_t slot = slotOf(hashIndex(index), bits);
+    while (tuples[slot].vertex != EMPTY && !sameIndex(tuples[slot].key, index))
+      slot = (slot + 1) & mask;
+
+    if (tuples[slot].vertex == EMPTY) {
+      Vertex vertex = makeVertex(obj, index);
+      size_t valueSlot = slotOf(hasher(vertex), bits);
+      while (values[valueSlot] != EMPTY && !(vertices[values[valueSlot]] == vertex))
+        valueSlot = (valueSlot + 1) & mask;
+      if (values[valueSlot] == EMPTY) {
+        values[valueSlot] = static_cast<uint32_t>(vertices.size());
         vertices.push_back(vertex);
       }
-      indices.push_back(uniqueVertices[vertex]);
+      tuples[slot] = {index, values[valueSlot]};
     }
+    indices.push_back(tuples[slot].vertex);
+  }
+}
+
+// Load the OBJ at the given path, returns false if it could not be loaded
+static bool loadObj(const std::string &modelPath,
+                    const std::string &name,
+                    jobs::JobSystem *jobs,
+                    std::vector<Vertex> &vertices,
+                    std::vector<uint32_t> &indices)
+{
+  ObjData obj;
+  try {
+    obj = parseObj(modelPath, jobs);
+  } catch (const std::exception &e) {
+    seng::log::error("Could not load {}: {}, returning empty mesh", name, e.what());
+    return false;
   }
+  seng::log::dbg("Loaded mesh {} from disk", name);
+
+  buildVertices(obj, vertices, indices);
 
   seng::log::dbg("Calculating tangent vectors");
   // Adapted from: https://ogldev.org/www/tutorial26/tutorial26.html
@@ -174,5 +362,131 @@ Mesh Mesh::loadFromDisk(const Renderer &renderer,
     glm::normalize(vertices[i].tangent);
   }
 
-  return Mesh(renderer, std::move(vertices), std::move(indices));
+  return true;
+}
+
+// Half floats have a 10 bit mantissa, so UVs within [-4; 4] are off by at most
+// 1/1024 (a texel of a 1024 pixels wide texture) once packed
+static constexpr float MAX_PACKED_UV = 4.0f;
+
+// Return the layout to use for the given vertices, the requested one if it can
+// represent them well enough
+static VertexLayout chooseLayout(const std::vector<Vertex> &vertices,
+                                 VertexLayout requested,
+                                 const std::string &name)
+{
+  if (requested != VertexLayout::ePacked) return requested;
+  for (const auto &v : vertices) {
+    if (std::abs(v.texCoord.x) > MAX_PACKED_UV ||
+        std::abs(v.texCoord.y) > MAX_PACKED_UV) {
+      seng::log::dbg("Mesh {} has UVs out of the packed range, not packing it", name);
+      return VertexLayout::eFull;
+    }
+  }
+  return requested;
+}
+
+// Error allowed when simplifying the first level of detail, each following one
+// is allowed twice the error of the previous
+static constexpr float LOD_BASE_ERROR = 0.01f;
+
+// Levels that remove less than this fraction of the triangles of the previous
+// one are not worth their memory, and end the chain
+static constexpr float LOD_MIN_REDUCTION = 0.2f;
+
+// Append the simplified levels of detail of the mesh to its indices, return
+// all levels including the full mesh
+static std::vector<Mesh::Lod> buildLods(const std::vector<Vertex> &vertices,
+                                        std::vector<uint32_t> &indices,
+                                        unsigned int levels,
+                                        bool optimize)
+{
+  std::vector<Mesh::Lod> lods{{0, static_cast<uint32_t>(indices.size()), 0.0f}};
+  const std::vector<uint32_t> full = indices;
+  size_t target = full.size();
+  float maxError = LOD_BASE_ERROR;
+  for (unsigned int level = 1; level <= levels; level++, maxError *= 2.0f) {
+    target = target / 2 / 3 * 3;
+    float error = 0.0f;
+    std::vector<uint32_t> lod = simplifyMesh(vertices, full, target, maxError, &error);
+    if (lod.size() > (1.0f - LOD_MIN_REDUCTION) * lods.back().indexCount) break;
+
+    if (optimize) {
+      std::vector<size_t> clusters = optimizeVertexCache(lod, vertices.size());
+      optimizeOverdraw(lod, vertices, clusters);
+    }
+    lods.push_back({static_cast<uint32_t>(indices.size()),
+                    static_cast<uint32_t>(lod.size()), error});
+    indices.insert(indices.end(), lod.begin(), lod.end());
+  }
+  return lods;
+}
+
+Mesh Mesh::loadFromDisk(const Renderer &renderer,
+                        const std::string &assetPath,
+                        const std::string &name,
+                        const MeshLoadOptions &opts)
+{
+  std::string modelPath{filesystem::path{assetPath} / filesystem::path{name}};
+  if (!filesystem::exists(modelPath)) {
+    seng::log::error("Could not locate {}, returning empty mesh", name);
+    return Mesh(renderer);
+  }
+
+  Timestamp start = Clock::now();
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  std::vector<Lod> lods;
+
+  // The cache is valid only if the model did not change since it was written
+  std::string cacheFile;
+  uint64_t hash = 0;
+  uint32_t flags = opts.optimize ? smesh::FLAG_OPTIMIZED : 0;
+  if (!opts.cachePath.empty()) {
+    try {
+      internal::MappedFile source(modelPath);
+      hash = internal::fnv1a(source.data(), source.size());
+      cacheFile = meshCacheFile(opts.cachePath, modelPath);
+    } catch (const std::exception &e) {
+      seng::log::warning("Could not hash {}: {}, skipping cache", name, e.what());
+    }
+  }
+  if (!cacheFile.empty() &&
+      readMeshCache(cacheFile, modelPath, hash, flags, opts.lodLevels, vertices, indices,
+                    lods)) {
+    seng::log::dbg("Loaded mesh {} from cache in {}ms", name,
+                   inSeconds(Clock::now() - start) * 1000);
+    VertexLayout layout = chooseLayout(vertices, opts.layout, name);
+    return Mesh(renderer, std::move(vertices), std::move(indices), layout,
+                std::move(lods));
+  }
+
+  if (!loadObj(modelPath, name, opts.jobs, vertices, indices)) return Mesh(renderer);
+  seng::log::dbg("Parsed mesh {} in {}ms", name,
+                 inSeconds(Clock::now() - start) * 1000);
+
+  if (opts.optimize) {
+    Timestamp optStart = Clock::now();
+    auto [before, after] = optimizeMesh(vertices, indices);
+    seng::log::dbg("Optimized mesh {} in {}ms: ACMR {:.3f} -> {:.3f}, "
+                   "ATVR {:.3f} -> {:.3f}",
+                   name, inSeconds(Clock::now() - optStart) * 1000, before.acmr,
+                   after.acmr, before.atvr, after.atvr);
+  }
+  if (opts.lodLevels > 0) {
+    Timestamp lodStart = Clock::now();
+    lods = buildLods(vertices, indices, opts.lodLevels, opts.optimize);
+    seng::log::dbg("Generated {} levels of detail for mesh {} in {}ms", lods.size() - 1,
+                   name, inSeconds(Clock::now() - lodStart) * 1000);
+  }
+  if (!cacheFile.empty()) {
+    try {
+      writeMeshCache(cacheFile, modelPath, hash, flags, opts.lodLevels, vertices, indices,
+                     lods);
+    } catch (const std::exception &e) {
+      seng::log::warning("Could not cache mesh {}: {}", name, e.what());
+    }
+  }
+  VertexLayout layout = chooseLayout(vertices, opts.layout, name);
+  return Mesh(renderer, std::move(vertices), std::move(indices), layout, std::move(lods));
 }
@@ -0,0 +1,162 @@
+#include <seng/log.hpp>
+#include <seng/rendering/primitive_types.hpp>
+#include <seng/resources/mesh.hpp>
+#include <seng/resources/mesh_cache.hpp>
+#include <seng/utils.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+using namespace seng;
+using namespace seng::rendering;
+using namespace std;
+namespace fs = std::filesystem;
+
+static size_t padded(size_t size)
+{
+  return (size + 3) & ~size_t{3};
+}
+
+// Random suffix for temporary files. Each thread has its own generator, seeded
+// from the system, so that concurrent writers never pick the same one.
+static string tempSuffix()
+{
+  thread_local mt19937_64 rng(random_device{}());
+  char suffix[17];
+  snprintf(suffix, sizeof(suffix), "%016llx", static_cast<unsigned long long>(rng()));
+  return suffix;
+}
+
+string seng::meshCacheFile(const string &cacheDir, const string &modelPath)
+{
+  char name[32];
+  uint64_t hash = internal::fnv1a(modelPath.data(), modelPath.size());
+  snprintf(name, sizeof(name), "%016llx.smesh", static_cast<unsigned long long>(hash));
+  return fs::path{cacheDir} / name;
+}
+
+bool seng::readMeshCache(const string &cacheFile,
+                         const string &modelPath,
+                         uint64_t sourceHash,
+                         uint32_t flags,
+                         uint32_t lodLevels,
+                         vector<Vertex> &vertices,
+                         vector<uint32_t> &indices,
+                         vector<Mesh::Lod> &lods)
+{
+  error_code err;
+  if (!fs::exists(cacheFile, err)) return false;
+
+  try {
+    internal::MappedFile file(cacheFile);
+    if (file.size() < sizeof(smesh::Header)) return false;
+
+    smesh::Header header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, smesh::MAGIC, sizeof(smesh::MAGIC)) != 0 ||
+        header.version != smesh::VERSION || header.vertexSize != sizeof(Vertex) ||
+        header.sourceHash != sourceHash || header.flags != flags ||
+        header.lodLevels != lodLevels)
+      return false;
+
+    // 64 bit math, so that nothing can overflow
+    uint64_t pathOffset = sizeof(smesh::Header);
+    uint64_t lodOffset = pathOffset + padded(header.pathLength);
+    uint64_t vertexOffset = lodOffset + uint64_t{header.lodCount} * sizeof(smesh::Lod);
+    uint64_t indexOffset = vertexOffset + uint64_t{header.vertexCount} * sizeof(Vertex);
+    uint64_t end = indexOffset + uint64_t{header.indexCount} * sizeof(uint32_t);
+    if (end != file.size()) return false;
+    string_view sourcePath(file.data() + pathOffset, header.pathLength);
+    if (sourcePath != modelPath) return false;
+
+    // Levels must cover all indices, in order
+    vector<Mesh::Lod> readLods;
+    uint64_t first = 0;
+    for (uint32_t l = 0; l < header.lodCount; l++) {
+      smesh::Lod lod;
+      memcpy(&lod, file.data() + lodOffset + l * sizeof(smesh::Lod), sizeof(lod));
+      readLods.push_back({static_cast<uint32_t>(first), lod.indexCount, lod.error});
+      first += lod.indexCount;
+    }
+    if (header.lodCount > 0 && first != header.indexCount) return false;
+
+    const auto *v = reinterpret_cast<const Vertex *>(file.data() + vertexOffset);
+    const auto *i = reinterpret_cast<const uint32_t *>(file.data() + indexOffset);
+    vertices.assign(v, v + header.vertexCount);
+    indices.assign(i, i + header.indexCount);
+    lods = std::move(readLods);
+    return true;
+  } catch (const exception &e) {
+    log::warning("Unable to read mesh cache {}: {}", cacheFile, e.what());
+    return false;
+  }
+}
+
+void seng::writeMeshCache(const string &cacheFile,
+                          const string &modelPath,
+                          uint64_t sourceHash,
+                          uint32_t flags,
+                          uint32_t lodLevels,
+                          const vector<Vertex> &vertices,
+                          const vector<uint32_t> &indices,
+                          const vector<Mesh::Lod> &lods)
+{
+  fs::path path{cacheFile};
+  error_code err;
+  if (path.has_parent_path()) fs::create_directories(path.parent_path(), err);
+  if (err) throw runtime_error("Unable to create " + path.parent_path().string());
+
+  smesh::Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, smesh::MAGIC, sizeof(header.magic));
+  header.version = smesh::VERSION;
+  header.sourceHash = sourceHash;
+  header.vertexSize = sizeof(Vertex);
+  header.vertexCount = vertices.size();
+  header.indexCount = indices.size();
+  header.pathLength = modelPath.size();
+  header.flags = flags;
+  header.lodLevels = lodLevels;
+  header.lodCount = lods.size();
+
+  // Written aside and then renamed, readers see either the old or the new file.
+  // Each writer has its own temporary file, so that concurrent writes of the
+  // same mesh (from other threads or processes) don't interleave.
+  fs::path temp = path;
+  temp += "." + tempSuffix() + ".tmp";
+  {
+    ofstream out(temp, ios::binary | ios::trunc);
+    const char padding[4] = {0, 0, 0, 0};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(modelPath.data(), modelPath.size());
+    out.write(padding, padded(modelPath.size()) - modelPath.size());
+    for (const auto &lod : lods) {
+      smesh::Lod written{lod.indexCount, lod.error};
+      out.write(reinterpret_cast<const char *>(&written), sizeof(written));
+    }
+    out.write(reinterpret_cast<const char *>(vertices.data()),
+              vertices.size() * sizeof(Vertex));
+    out.write(reinterpret_cast<const char *>(indices.data()),
+              indices.size() * sizeof(uint32_t));
+    if (!out) {
+      out.close();
+      fs::remove(temp, err);
+      throw runtime_error("Unable to write " + temp.string());
+    }
+  }
+  fs::rename(temp, path, err);
+  if (err) {
+    fs::remove(temp, err);
+    throw runtime_error("Unable to write " + path.string());
+  }
+}
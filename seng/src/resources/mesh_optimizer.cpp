@@ -0,0 +1,307 @@
+#include <seng/rendering/primitive_types.hpp>
+#include <seng/resources/mesh_optimizer.hpp>
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace seng;
+using namespace seng::rendering;
+using namespace std;
+
+static constexpr uint32_t NONE = UINT32_MAX;
+
+// Simulated FIFO post-transform cache. Each vertex remembers the time of the miss
+// that loaded it, and it is evicted once `size` other misses happened.
+class FifoCache {
+ public:
+  FifoCache(size_t vertexCount, unsigned int size) :
+      m_loadedAt(vertexCount, 0), m_time(size + 1), m_size(size)
+  {
+  }
+
+  // Access the vertex, return true if it had to be transformed
+  bool access(uint32_t vertex)
+  {
+    if (m_time - m_loadedAt[vertex] <= m_size) return false;
+    m_loadedAt[vertex] = m_time++;
+    return true;
+  }
+
+  // Access the vertices of the given triangle, return the number of misses
+  size_t access(const uint32_t *triangle)
+  {
+    return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+  }
+
+  void flush() { m_time += m_size + 1; }
+
+ private:
+  vector<size_t> m_loadedAt;
+  size_t m_time;
+  size_t m_size;
+};
+
+VertexCacheStats seng::analyzeVertexCache(const vector<uint32_t> &indices,
+                                          size_t vertexCount,
+                                          unsigned int cacheSize)
+{
+  VertexCacheStats stats;
+  if (indices.size() < 3 || vertexCount == 0) return stats;
+
+  FifoCache cache(vertexCount, cacheSize);
+  for (uint32_t v : indices) stats.transformed += cache.access(v);
+  stats.acmr = static_cast<float>(stats.transformed) / (indices.size() / 3);
+  stats.atvr = static_cast<float>(stats.transformed) / vertexCount;
+  return stats;
+}
+
+// Triangles using each vertex, those of vertex v are in
+// triangles[offsets[v]..offsets[v + 1]]
+struct Adjacency {
+  vector<uint32_t> offsets;
+  vector<uint32_t> triangles;
+};
+
+static Adjacency buildAdjacency(const vector<uint32_t> &indices, size_t vertexCount)
+{
+  Adjacency adj;
+  adj.offsets.assign(vertexCount + 1, 0);
+  for (uint32_t v : indices) adj.offsets[v + 1]++;
+  for (size_t v = 0; v < vertexCount; v++) adj.offsets[v + 1] += adj.offsets[v];
+
+  vector<uint32_t> next(adj.offsets.begin(), adj.offsets.end() - 1);
+  adj.triangles.resize(indices.size());
+  for (size_t i = 0; i < indices.size(); i++)
+    adj.triangles[next[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  return adj;
+}
+
+// Tipsify's fallback when the fanned vertex has no good successor: the most
+// recently used vertex that still has triangles left, or the first one in input
+// order if there is none.
+static uint32_t skipDeadEnd(vector<uint32_t> &deadEnd,
+                            const vector<uint32_t> &live,
+                            size_t &cursor)
+{
+  while (!deadEnd.empty()) {
+    uint32_t v = deadEnd.back();
+    deadEnd.pop_back();
+    if (live[v] > 0) return v;
+  }
+  for (; cursor < live.size(); cursor++)
+    if (live[cursor] > 0) return static_cast<uint32_t>(cursor);
+  return NONE;
+}
+
+vector<size_t> seng::optimizeVertexCache(vector<uint32_t> &indices,
+                                         size_t vertexCount,
+                                         unsigned int cacheSize)
+{
+  vector<size_t> clusters;
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) return clusters;
+
+  Adjacency adj = buildAdjacency(indices, vertexCount);
+  vector<uint32_t> live(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++) live[v] = adj.offsets[v + 1] - adj.offsets[v];
+
+  // Same timestamps as FifoCache, but kept here since Tipsify needs to read them
+  vector<size_t> cacheTime(vertexCount, 0);
+  size_t time = cacheSize + 1;
+
+  vector<bool> emitted(triangleCount, false);
+  vector<uint32_t> deadEnd, candidates, out;
+  out.reserve(3 * triangleCount);
+  size_t cursor = 0;
+
+  uint32_t fanning = skipDeadEnd(deadEnd, live, cursor);
+  clusters.push_back(0);
+  while (fanning != NONE) {
+    // Emit all remaining triangles around the fanning vertex
+    candidates.clear();
+    for (uint32_t k = adj.offsets[fanning]; k < adj.offsets[fanning + 1]; k++) {
+      uint32_t t = adj.triangles[k];
+      if (emitted[t]) continue;
+      emitted[t] = true;
+      for (size_t j = 0; j < 3; j++) {
+        uint32_t v = indices[3 * t + j];
+        out.push_back(v);
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if (time - cacheTime[v] > cacheSize) cacheTime[v] = time++;
+      }
+    }
+
+    // Prefer the oldest candidate that would still be cached after fanning it
+    // (each of its triangles adds at most two vertices), any other one if none
+    uint32_t next = NONE;
+    size_t bestPriority = 0;
+    for (uint32_t v : candidates) {
+      if (live[v] == 0) continue;
+      size_t priority = 0;
+      if (time - cacheTime[v] + 2 * live[v] <= cacheSize) priority = time - cacheTime[v];
+      if (next == NONE || priority > bestPriority) {
+        next = v;
+        bestPriority = priority;
+      }
+    }
+
+    if (next == NONE) {
+      next = skipDeadEnd(deadEnd, live, cursor);
+      if (next != NONE) clusters.push_back(out.size() / 3);
+    }
+    fanning = next;
+  }
+
+  indices = std::move(out);
+  return clusters;
+}
+
+// Split the given clusters where the cache miss ratio of the part before the
+// split is already within threshold times the one of the whole cluster. The
+// cache is assumed to be flushed at each split.
+static vector<size_t> splitClusters(const vector<uint32_t> &indices,
+                                    size_t vertexCount,
+                                    const vector<size_t> &clusters,
+                                    float threshold,
+                                    unsigned int cacheSize)
+{
+  size_t triangleCount = indices.size() / 3;
+  FifoCache cache(vertexCount, cacheSize);
+  vector<size_t> ret;
+
+  for (size_t c = 0; c < clusters.size(); c++) {
+    size_t begin = clusters[c];
+    size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+    if (begin >= end) continue;
+
+    cache.flush();
+    size_t misses = 0;
+    for (size_t t = begin; t < end; t++) misses += cache.access(&indices[3 * t]);
+    float clusterAcmr = static_cast<float>(misses) / (end - begin);
+
+    cache.flush();
+    ret.push_back(begin);
+    size_t start = begin;
+    misses = 0;
+    for (size_t t = begin; t + 1 < end; t++) {
+      misses += cache.access(&indices[3 * t]);
+      if (static_cast<float>(misses) / (t + 1 - start) <= threshold * clusterAcmr) {
+        ret.push_back(t + 1);
+        start = t + 1;
+        misses = 0;
+        cache.flush();
+      }
+    }
+  }
+  return ret;
+}
+
+// Return the triangles of the given list with the clusters starting at `bounds`
+// sorted so that those whose surface points away from the center of the mesh,
+// and are thus in front of the others from most points of view, come first
+static vector<uint32_t> sortClusters(const vector<uint32_t> &indices,
+                                     const vector<Vertex> &vertices,
+                                     const glm::vec3 &meshCentroid,
+                                     const vector<size_t> &bounds)
+{
+  struct Cluster {
+    size_t begin, end;
+    float sortKey;
+  };
+  size_t triangleCount = indices.size() / 3;
+  vector<Cluster> sorted;
+  sorted.reserve(bounds.size());
+  for (size_t c = 0; c < bounds.size(); c++) {
+    Cluster cluster{bounds[c], c + 1 < bounds.size() ? bounds[c + 1] : triangleCount, 0};
+
+    // Area weighted, the cross product's length is twice the triangle's area
+    glm::vec3 normal(0.0f), centroid(0.0f);
+    float area = 0.0f;
+    for (size_t t = cluster.begin; t < cluster.end; t++) {
+      const glm::vec3 &p0 = vertices[indices[3 * t + 0]].pos;
+      const glm::vec3 &p1 = vertices[indices[3 * t + 1]].pos;
+      const glm::vec3 &p2 = vertices[indices[3 * t + 2]].pos;
+      glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+      float a = glm::length(n);
+      normal += n;
+      centroid += (p0 + p1 + p2) * (a / 3.0f);
+      area += a;
+    }
+    float normalLength = glm::length(normal);
+    if (area > 0.0f && normalLength > 0.0f)
+      cluster.sortKey = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+    sorted.push_back(cluster);
+  }
+  stable_sort(sorted.begin(), sorted.end(), [](const Cluster &lhs, const Cluster &rhs) {
+    return lhs.sortKey > rhs.sortKey;
+  });
+
+  vector<uint32_t> out;
+  out.reserve(indices.size());
+  for (const auto &cluster : sorted)
+    out.insert(out.end(), indices.begin() + 3 * cluster.begin,
+               indices.begin() + 3 * cluster.end);
+  return out;
+}
+
+void seng::optimizeOverdraw(vector<uint32_t> &indices,
+                            const vector<Vertex> &vertices,
+                            const vector<size_t> &clusters,
+                            float threshold,
+                            unsigned int cacheSize)
+{
+  if (indices.size() < 3 || clusters.empty()) return;
+
+  glm::vec3 meshCentroid(0.0f);
+  for (const auto &v : vertices) meshCentroid += v.pos;
+  meshCentroid /= static_cast<float>(vertices.size());
+
+  // Sorting also loses the cache hits between consecutive clusters, which the
+  // split can't account for. If that costs too much, fall back to sorting only
+  // the original clusters, and then to not sorting at all.
+  size_t vertexCount = vertices.size();
+  float maxAcmr = threshold * analyzeVertexCache(indices, vertexCount, cacheSize).acmr;
+  vector<size_t> softBounds =
+      splitClusters(indices, vertexCount, clusters, threshold, cacheSize);
+  const vector<size_t> *attempts[] = {&softBounds, &clusters};
+  for (const auto *bounds : attempts) {
+    vector<uint32_t> sorted = sortClusters(indices, vertices, meshCentroid, *bounds);
+    if (analyzeVertexCache(sorted, vertexCount, cacheSize).acmr <= maxAcmr) {
+      indices = std::move(sorted);
+      return;
+    }
+  }
+}
+
+void seng::optimizeVertexFetch(vector<Vertex> &vertices, vector<uint32_t> &indices)
+{
+  vector<uint32_t> remap(vertices.size(), NONE);
+  vector<Vertex> reordered;
+  reordered.reserve(vertices.size());
+  for (auto &index : indices) {
+    if (remap[index] == NONE) {
+      remap[index] = static_cast<uint32_t>(reordered.size());
+      reordered.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+  vertices = std::move(reordered);
+}
+
+pair<VertexCacheStats, VertexCacheStats> seng::optimizeMesh(vector<Vertex> &vertices,
+                                                            vector<uint32_t> &indices)
+{
+  VertexCacheStats before = analyzeVertexCache(indices, vertices.size());
+  vector<size_t> clusters = optimizeVertexCache(indices, vertices.size());
+  optimizeOverdraw(indices, vertices, clusters);
+  optimizeVertexFetch(vertices, indices);
+  return {before, analyzeVertexCache(indices, vertices.size())};
+}
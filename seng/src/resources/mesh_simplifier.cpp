@@ -0,0 +1,437 @@
+#include <seng/rendering/primitive_types.hpp>
+#include <seng/resources/mesh_simplifier.hpp>
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+using namespace seng;
+using namespace seng::rendering;
+using namespace std;
+
+// Constraint planes along borders and seams weigh this much more than the
+// surface ones, so that they stay straight
+static constexpr double BORDER_WEIGHT = 10.0;
+
+// Sum of squared distances from a set of weighted planes, stored as the upper
+// half of a symmetric 4x4 matrix, along with the total weight of the planes
+struct Quadric {
+  double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+  double a11 = 0, a12 = 0, a13 = 0;
+  double a22 = 0, a23 = 0;
+  double a33 = 0;
+  double weight = 0;
+
+  Quadric() = default;
+
+  // Plane through p with the given unit normal
+  Quadric(const glm::vec3 &n, const glm::vec3 &p, double w)
+  {
+    double d = -glm::dot(n, p);
+    a00 = w * n.x * n.x, a01 = w * n.x * n.y, a02 = w * n.x * n.z, a03 = w * n.x * d;
+    a11 = w * n.y * n.y, a12 = w * n.y * n.z, a13 = w * n.y * d;
+    a22 = w * n.z * n.z, a23 = w * n.z * d;
+    a33 = w * d * d;
+    weight = w;
+  }
+
+  Quadric &operator+=(const Quadric &q)
+  {
+    a00 += q.a00, a01 += q.a01, a02 += q.a02, a03 += q.a03;
+    a11 += q.a11, a12 += q.a12, a13 += q.a13;
+    a22 += q.a22, a23 += q.a23;
+    a33 += q.a33;
+    weight += q.weight;
+    return *this;
+  }
+
+  // Weighted mean of the squared distances of p from the planes
+  double error(const glm::vec3 &p) const
+  {
+    double x = p.x, y = p.y, z = p.z;
+    double e = a00 * x * x + a11 * y * y + a22 * z * z +
+               2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+               2 * (a03 * x + a13 * y + a23 * z) + a33;
+    return weight > 0 ? std::abs(e) / weight : 0;
+  }
+};
+
+// How a position can move. Manifold ones can collapse onto any neighbour,
+// border and seam ones only onto neighbours along the border or seam.
+enum struct Kind : uint8_t { eManifold, eBorder, eSeam, eLocked };
+
+// Edge collapse simplification state.
+//
+// Vertices sharing the same position (wedges) are grouped in points, which are
+// what is actually collapsed: when a point collapses onto another, each of its
+// wedges is replaced by the wedge of the other point it shares triangles with.
+class Simplifier {
+ public:
+  Simplifier(const vector<Vertex> &vertices, const vector<uint32_t> &indices);
+
+  // Collapse edges until at most `targetTriangles` are left or the next collapse
+  // would have an error over maxError, return the largest one reached
+  float run(size_t targetTriangles, float maxError);
+
+  // Return the triangles left
+  vector<uint32_t> indices() const;
+
+ private:
+  struct Candidate {
+    double cost;
+    uint32_t from, to;
+    uint32_t fromVersion, toVersion;
+
+    bool operator>(const Candidate &rhs) const { return cost > rhs.cost; }
+  };
+
+  struct Edge {
+    uint32_t count;
+    uint32_t from, to;  // Wedges of its first triangle
+    bool seam;
+  };
+
+  vector<uint32_t> m_tris;
+  vector<bool> m_deadTri;
+  size_t m_liveTris = 0;
+
+  vector<uint32_t> m_pointOf;
+  vector<glm::vec3> m_pos;
+  vector<Kind> m_kind;
+  vector<Quadric> m_quadric;
+  vector<uint32_t> m_version;
+  vector<vector<uint32_t>> m_pointTris;
+
+  priority_queue<Candidate, vector<Candidate>, greater<Candidate>> m_queue;
+  vector<uint32_t> m_mark;
+  uint32_t m_stamp = 0;
+
+  uint32_t point(uint32_t tri, size_t corner) const
+  {
+    return m_pointOf[m_tris[3 * tri + corner]];
+  }
+
+  void weld(const vector<Vertex> &vertices);
+  void classify(const unordered_map<uint64_t, Edge> &edges);
+  void computeQuadrics(const unordered_map<uint64_t, Edge> &edges);
+  void push(uint32_t from, uint32_t to);
+  bool collapse(uint32_t p, uint32_t q);
+};
+
+static uint64_t edgeKey(uint32_t p, uint32_t q)
+{
+  return (uint64_t{min(p, q)} << 32) | max(p, q);
+}
+
+Simplifier::Simplifier(const vector<Vertex> &vertices, const vector<uint32_t> &indices) :
+    m_tris(indices.begin(), indices.end() - indices.size() % 3),
+    m_deadTri(m_tris.size() / 3, false)
+{
+  weld(vertices);
+
+  // Triangles degenerate to a segment or point can't be collapsed properly
+  for (uint32_t t = 0; t < m_deadTri.size(); t++) {
+    uint32_t p0 = point(t, 0), p1 = point(t, 1), p2 = point(t, 2);
+    if (p0 == p1 || p1 == p2 || p2 == p0) {
+      m_deadTri[t] = true;
+      continue;
+    }
+    m_liveTris++;
+    for (size_t k = 0; k < 3; k++) m_pointTris[point(t, k)].push_back(t);
+  }
+
+  // Half-edges with the same points and the same wedges (in opposite order) are
+  // the two sides of a smooth edge, otherwise they are on a seam
+  unordered_map<uint64_t, Edge> edges;
+  edges.reserve(m_liveTris * 2);
+  for (uint32_t t = 0; t < m_deadTri.size(); t++) {
+    if (m_deadTri[t]) continue;
+    for (size_t k = 0; k < 3; k++) {
+      uint32_t a = m_tris[3 * t + k], b = m_tris[3 * t + (k + 1) % 3];
+      auto [it, inserted] =
+          edges.try_emplace(edgeKey(m_pointOf[a], m_pointOf[b]), Edge{0, a, b, false});
+      Edge &edge = it->second;
+      if (!inserted && (edge.from != b || edge.to != a)) edge.seam = true;
+      edge.count++;
+    }
+  }
+
+  classify(edges);
+  computeQuadrics(edges);
+
+  m_version.assign(m_pos.size(), 0);
+  m_mark.assign(m_pos.size(), 0);
+  for (const auto &[key, edge] : edges) {
+    uint32_t p = m_pointOf[edge.from], q = m_pointOf[edge.to];
+    push(p, q);
+    push(q, p);
+  }
+}
+
+// Group vertices with the same position in points, positions are scaled to the
+// unit cube
+void Simplifier::weld(const vector<Vertex> &vertices)
+{
+  vector<uint32_t> order(vertices.size());
+  iota(order.begin(), order.end(), 0);
+  auto less = [&](uint32_t lhs, uint32_t rhs) {
+    const glm::vec3 &a = vertices[lhs].pos, &b = vertices[rhs].pos;
+    if (a.x != b.x) return a.x < b.x;
+    if (a.y != b.y) return a.y < b.y;
+    return a.z < b.z;
+  };
+  sort(order.begin(), order.end(), less);
+
+  m_pointOf.assign(vertices.size(), 0);
+  for (size_t i = 0; i < order.size(); i++) {
+    if (i == 0 || less(order[i - 1], order[i])) m_pos.push_back(vertices[order[i]].pos);
+    m_pointOf[order[i]] = static_cast<uint32_t>(m_pos.size() - 1);
+  }
+  m_pointTris.resize(m_pos.size());
+
+  glm::vec3 lo(0.0f), hi(0.0f);
+  if (!m_pos.empty()) lo = hi = m_pos[0];
+  for (const auto &p : m_pos) lo = glm::min(lo, p), hi = glm::max(hi, p);
+  glm::vec3 extent = hi - lo;
+  float size = max(extent.x, max(extent.y, extent.z));
+  for (auto &p : m_pos) p = size > 0.0f ? (p - lo) / size : glm::vec3(0.0f);
+}
+
+void Simplifier::classify(const unordered_map<uint64_t, Edge> &edges)
+{
+  struct Counts {
+    uint32_t border = 0, seam = 0;
+    bool nonManifold = false;
+  };
+  vector<Counts> counts(m_pos.size());
+  for (const auto &[key, edge] : edges) {
+    for (uint32_t p : {m_pointOf[edge.from], m_pointOf[edge.to]}) {
+      if (edge.count > 2) counts[p].nonManifold = true;
+      if (edge.count == 1) counts[p].border++;
+      if (edge.count == 2 && edge.seam) counts[p].seam++;
+    }
+  }
+
+  // Distinct wedges used by the triangles of each point
+  vector<uint32_t> wedges(m_pos.size(), 0);
+  vector<bool> seen(m_pointOf.size(), false);
+  for (uint32_t t = 0; t < m_deadTri.size(); t++) {
+    if (m_deadTri[t]) continue;
+    for (size_t k = 0; k < 3; k++) {
+      uint32_t w = m_tris[3 * t + k];
+      if (!seen[w]) wedges[m_pointOf[w]]++;
+      seen[w] = true;
+    }
+  }
+
+  m_kind.assign(m_pos.size(), Kind::eLocked);
+  for (size_t p = 0; p < m_pos.size(); p++) {
+    const Counts &c = counts[p];
+    if (c.nonManifold) continue;
+    if (wedges[p] == 1 && c.border == 0 && c.seam == 0) m_kind[p] = Kind::eManifold;
+    if (wedges[p] == 1 && c.border == 2 && c.seam == 0) m_kind[p] = Kind::eBorder;
+    if (wedges[p] == 2 && c.border == 0 && c.seam == 2) m_kind[p] = Kind::eSeam;
+  }
+}
+
+void Simplifier::computeQuadrics(const unordered_map<uint64_t, Edge> &edges)
+{
+  m_quadric.assign(m_pos.size(), Quadric());
+  for (uint32_t t = 0; t < m_deadTri.size(); t++) {
+    if (m_deadTri[t]) continue;
+    uint32_t p[3] = {point(t, 0), point(t, 1), point(t, 2)};
+    glm::vec3 n = glm::cross(m_pos[p[1]] - m_pos[p[0]], m_pos[p[2]] - m_pos[p[0]]);
+    float area = glm::length(n);
+    if (area == 0.0f) continue;
+    n /= area;
+
+    Quadric face(n, m_pos[p[0]], area / 2.0);
+    for (size_t k = 0; k < 3; k++) m_quadric[p[k]] += face;
+
+    // Planes perpendicular to the face through its border and seam edges
+    for (size_t k = 0; k < 3; k++) {
+      uint32_t a = p[k], b = p[(k + 1) % 3];
+      const Edge &edge = edges.at(edgeKey(a, b));
+      if (edge.count != 1 && !edge.seam) continue;
+      glm::vec3 side = m_pos[b] - m_pos[a];
+      glm::vec3 m = glm::cross(side, n);
+      float length = glm::length(m);
+      if (length == 0.0f) continue;
+      Quadric constraint(m / length, m_pos[a], BORDER_WEIGHT * glm::dot(side, side));
+      m_quadric[a] += constraint;
+      m_quadric[b] += constraint;
+    }
+  }
+}
+
+void Simplifier::push(uint32_t from, uint32_t to)
+{
+  if (m_kind[from] == Kind::eLocked) return;
+  Quadric q = m_quadric[from];
+  q += m_quadric[to];
+  m_queue.push({q.error(m_pos[to]), from, to, m_version[from], m_version[to]});
+}
+
+// Collapse point p onto point q, if it does not break the mesh. Returns false
+// otherwise.
+bool Simplifier::collapse(uint32_t p, uint32_t q)
+{
+  // Pair each wedge of p with the one of q it shares triangles with
+  uint32_t mapFrom[2], mapTo[2];
+  size_t mapped = 0, shared = 0;
+  for (uint32_t t : m_pointTris[p]) {
+    if (m_deadTri[t]) continue;
+    uint32_t a = 0, b = 0;
+    bool hasQ = false;
+    for (size_t k = 0; k < 3; k++) {
+      if (point(t, k) == p) a = m_tris[3 * t + k];
+      if (point(t, k) == q) b = m_tris[3 * t + k], hasQ = true;
+    }
+    if (!hasQ) continue;
+    shared++;
+    size_t m = 0;
+    while (m < mapped && mapFrom[m] != a) m++;
+    if (m == mapped) {
+      if (mapped == 2) return false;
+      mapFrom[mapped] = a;
+      mapTo[mapped++] = b;
+    } else if (mapTo[m] != b) {
+      return false;
+    }
+  }
+
+  // Borders and seams must be collapsed along themselves
+  switch (m_kind[p]) {
+    case Kind::eManifold:
+      if (shared != 2 || mapped != 1) return false;
+      break;
+    case Kind::eBorder:
+      if (shared != 1 || mapped != 1) return false;
+      break;
+    case Kind::eSeam:
+      if (shared != 2 || mapped != 2) return false;
+      break;
+    case Kind::eLocked:
+      return false;
+  }
+
+  // Link condition: p and q must have no common neighbours besides those of
+  // the triangles being removed, or the result would not be a manifold
+  m_stamp += 2;
+  for (uint32_t t : m_pointTris[q]) {
+    if (m_deadTri[t]) continue;
+    for (size_t k = 0; k < 3; k++) m_mark[point(t, k)] = m_stamp;
+  }
+  size_t common = 0;
+  for (uint32_t t : m_pointTris[p]) {
+    if (m_deadTri[t]) continue;
+    for (size_t k = 0; k < 3; k++) {
+      uint32_t r = point(t, k);
+      if (r == p || r == q || m_mark[r] != m_stamp) continue;
+      m_mark[r] = m_stamp + 1;
+      common++;
+    }
+  }
+  if (common != shared) return false;
+
+  // No remaining triangle can flip
+  for (uint32_t t : m_pointTris[p]) {
+    if (m_deadTri[t]) continue;
+    glm::vec3 before[3], after[3];
+    bool hasQ = false;
+    for (size_t k = 0; k < 3; k++) {
+      uint32_t r = point(t, k);
+      hasQ |= r == q;
+      before[k] = m_pos[r];
+      after[k] = r == p ? m_pos[q] : m_pos[r];
+    }
+    if (hasQ) continue;
+    glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+    glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+    if (glm::dot(n0, n1) <= 0.0f) return false;
+  }
+
+  for (uint32_t t : m_pointTris[p]) {
+    if (m_deadTri[t]) continue;
+    bool hasQ = point(t, 0) == q || point(t, 1) == q || point(t, 2) == q;
+    if (hasQ) {
+      m_deadTri[t] = true;
+      m_liveTris--;
+      continue;
+    }
+    for (size_t k = 0; k < 3; k++) {
+      uint32_t &w = m_tris[3 * t + k];
+      if (m_pointOf[w] != p) continue;
+      w = mapFrom[0] == w ? mapTo[0] : mapTo[1];
+    }
+    m_pointTris[q].push_back(t);
+  }
+  m_pointTris[p].clear();
+  auto &qTris = m_pointTris[q];
+  auto dead = [&](uint32_t t) { return m_deadTri[t]; };
+  qTris.erase(remove_if(qTris.begin(), qTris.end(), dead), qTris.end());
+
+  m_quadric[q] += m_quadric[p];
+  m_version[p]++;
+  m_version[q]++;
+  m_kind[p] = Kind::eLocked;
+  return true;
+}
+
+float Simplifier::run(size_t targetTriangles, float maxError)
+{
+  double maxCost = double{maxError} * maxError;
+  double reached = 0.0;
+  while (m_liveTris > targetTriangles && !m_queue.empty()) {
+    Candidate c = m_queue.top();
+    m_queue.pop();
+    if (c.fromVersion != m_version[c.from] || c.toVersion != m_version[c.to]) continue;
+    if (c.cost > maxCost) break;
+    if (!collapse(c.from, c.to)) continue;
+    reached = max(reached, c.cost);
+
+    // Costs of the edges around q changed along with its quadric
+    for (uint32_t t : m_pointTris[c.to]) {
+      for (size_t k = 0; k < 3; k++) {
+        uint32_t r = point(t, k);
+        if (r == c.to) continue;
+        push(c.to, r);
+        push(r, c.to);
+      }
+    }
+  }
+  return static_cast<float>(sqrt(reached));
+}
+
+vector<uint32_t> Simplifier::indices() const
+{
+  vector<uint32_t> out;
+  out.reserve(3 * m_liveTris);
+  for (uint32_t t = 0; t < m_deadTri.size(); t++)
+    if (!m_deadTri[t]) out.insert(out.end(), &m_tris[3 * t], &m_tris[3 * t] + 3);
+  return out;
+}
+
+vector<uint32_t> seng::simplifyMesh(const vector<Vertex> &vertices,
+                                    const vector<uint32_t> &indices,
+                                    size_t targetIndexCount,
+                                    float maxError,
+                                    float *error)
+{
+  if (error != nullptr) *error = 0.0f;
+  if (targetIndexCount >= indices.size()) return indices;
+
+  Simplifier simplifier(vertices, indices);
+  float reached = simplifier.run(targetIndexCount / 3, maxError);
+  if (error != nullptr) *error = reached;
+  return simplifier.indices();
+}
@@ -0,0 +1,267 @@
+#include <seng/jobs/job_system.hpp>
+#include <seng/resources/obj_parser.hpp>
+#include <seng/utils.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+using namespace seng;
+using namespace std;
+
+// Chunks smaller than this are not worth a job
+static constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+// A face as written in the file. Relative indices are resolved only once all
+// chunks have been parsed, so the number of attributes read in the chunk before
+// the face is saved along with it.
+struct ObjFace {
+  uint32_t line;   // Inside the chunk, 1-based
+  uint32_t first;  // First index in ObjChunk::faceIndices, three per vertex
+  uint32_t size;   // Number of vertices
+  uint32_t positions;
+  uint32_t normals;
+  uint32_t texcoords;
+};
+
+// A line-aligned slice of the file and what has been read from it
+struct ObjChunk {
+  const char *begin;
+  const char *end;
+
+  vector<float> positions;
+  vector<float> normals;
+  vector<float> texcoords;
+  vector<int32_t> faceIndices;  // v/vt/vn as written, 0 if missing
+  vector<ObjFace> faces;
+
+  size_t lines = 0;
+  size_t triangles = 0;
+  size_t errorLine = 0;  // 1-based, 0 if no error
+  string error;
+};
+
+static bool isSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char *skipSpaces(const char *p, const char *end)
+{
+  while (p < end && isSpace(*p)) p++;
+  return p;
+}
+
+static const char *tokenEnd(const char *p, const char *end)
+{
+  while (p < end && !isSpace(*p)) p++;
+  return p;
+}
+
+// Missing or malformed values are read as 0, like tinyobjloader did
+static float parseFloat(const char *&p, const char *end)
+{
+  p = skipSpaces(p, end);
+  const char *tokEnd = tokenEnd(p, end);
+  const char *start = p < tokEnd && *p == '+' ? p + 1 : p;  // not accepted by from_chars
+  p = tokEnd;
+
+  // Parsed as double and then narrowed, like tinyobjloader did
+  double value = 0.0;
+  if (from_chars(start, tokEnd, value).ec != errc()) return 0.0f;
+  return static_cast<float>(value);
+}
+
+static bool parseIndex(const char *&p, const char *end, int32_t &out)
+{
+  out = 0;
+  if (p == end || *p == '/') return true;  // missing
+  const char *start = *p == '+' ? p + 1 : p;
+  auto res = from_chars(start, end, out);
+  if (res.ec != errc()) return false;
+  p = res.ptr;
+  return true;
+}
+
+// Parse `v`, `v/vt`, `v//vn` or `v/vt/vn`
+static bool parseFaceVertex(const char *p, const char *end, int32_t *indices)
+{
+  if (!parseIndex(p, end, indices[0]) || indices[0] == 0) return false;
+  indices[1] = indices[2] = 0;
+  for (int i = 1; i < 3 && p < end && *p == '/'; i++)
+    if (!parseIndex(++p, end, indices[i])) return false;
+  return p == end;
+}
+
+static void parseChunk(ObjChunk &chunk)
+{
+  const char *p = chunk.begin;
+  while (p < chunk.end) {
+    const char *eol = static_cast<const char *>(memchr(p, '\n', chunk.end - p));
+    if (eol == nullptr) eol = chunk.end;
+    const char *line = skipSpaces(p, eol);
+    p = eol < chunk.end ? eol + 1 : chunk.end;
+    chunk.lines++;
+    if (line == eol || *line == '#') continue;
+
+    const char *args = tokenEnd(line, eol);
+    string_view keyword(line, args - line);
+    if (keyword == "v") {
+      for (int i = 0; i < 3; i++) chunk.positions.push_back(parseFloat(args, eol));
+    } else if (keyword == "vn") {
+      for (int i = 0; i < 3; i++) chunk.normals.push_back(parseFloat(args, eol));
+    } else if (keyword == "vt") {
+      for (int i = 0; i < 2; i++) chunk.texcoords.push_back(parseFloat(args, eol));
+    } else if (keyword == "f") {
+      ObjFace face;
+      face.line = chunk.lines;
+      face.first = chunk.faceIndices.size();
+      face.size = 0;
+      face.positions = chunk.positions.size() / 3;
+      face.normals = chunk.normals.size() / 3;
+      face.texcoords = chunk.texcoords.size() / 2;
+
+      for (args = skipSpaces(args, eol); args < eol; args = skipSpaces(args, eol)) {
+        const char *tokEnd = tokenEnd(args, eol);
+        int32_t indices[3];
+        if (!parseFaceVertex(args, tokEnd, indices)) {
+          chunk.errorLine = chunk.lines;
+          chunk.error = "malformed face vertex '" + string(args, tokEnd) + "'";
+          return;
+        }
+        chunk.faceIndices.insert(chunk.faceIndices.end(), indices, indices + 3);
+        face.size++;
+        args = tokEnd;
+      }
+      if (face.size >= 3) chunk.triangles += face.size - 2;
+      chunk.faces.push_back(face);
+    }
+  }
+}
+
+// Turn a v/vt/vn index as written in the file into an absolute one
+static bool resolve(int32_t raw, size_t base, size_t local, size_t total, int32_t &out)
+{
+  if (raw == 0) {
+    out = -1;
+    return true;
+  }
+  int64_t index = raw > 0 ? int64_t{raw} - 1 : static_cast<int64_t>(base + local) + raw;
+  if (index < 0 || index >= static_cast<int64_t>(total)) return false;
+  out = static_cast<int32_t>(index);
+  return true;
+}
+
+// Call f for each chunk index, in parallel if possible
+template <typename F>
+static void forEachChunk(jobs::JobSystem *jobs, size_t count, F &&f)
+{
+  if (jobs == nullptr) {
+    for (size_t i = 0; i < count; i++) f(i);
+    return;
+  }
+  jobs->parallelFor(0, count, 1, [&](size_t b, size_t e) {
+    for (size_t i = b; i < e; i++) f(i);
+  });
+}
+
+// Throw the error of the first chunk that has one, with its line in the file
+static void checkErrors(const string &path, const vector<ObjChunk> &chunks)
+{
+  size_t lines = 0;
+  for (const auto &chunk : chunks) {
+    if (chunk.errorLine != 0)
+      throw runtime_error(path + ":" + to_string(lines + chunk.errorLine) + ": " +
+                          chunk.error);
+    lines += chunk.lines;
+  }
+}
+
+ObjData seng::parseObj(const string &path, jobs::JobSystem *jobs)
+{
+  internal::MappedFile file(path);
+  const char *data = file.data();
+  const char *end = data + file.size();
+
+  // Split at the first line break after evenly spaced boundaries
+  size_t count = 1;
+  if (jobs != nullptr && file.size() >= 2 * MIN_CHUNK_SIZE)
+    count = min(file.size() / MIN_CHUNK_SIZE, 4 * (jobs->workerCount() + 1));
+  vector<ObjChunk> chunks;
+  const char *begin = data;
+  for (size_t i = 1; i <= count && begin < end; i++) {
+    const char *split = i == count ? end : data + file.size() / count * i;
+    if (split < begin) split = begin;
+    const char *eol = static_cast<const char *>(memchr(split, '\n', end - split));
+    split = eol == nullptr ? end : eol + 1;
+
+    ObjChunk &chunk = chunks.emplace_back();
+    chunk.begin = begin;
+    chunk.end = split;
+    begin = split;
+  }
+
+  forEachChunk(jobs, chunks.size(), [&](size_t i) { parseChunk(chunks[i]); });
+  checkErrors(path, chunks);
+
+  // Merge attributes in file order, remembering where each chunk's ones start
+  ObjData ret;
+  vector<size_t> positionBase, normalBase, texcoordBase, triangleBase;
+  size_t triangles = 0;
+  for (const auto &chunk : chunks) {
+    positionBase.push_back(ret.positions.size() / 3);
+    normalBase.push_back(ret.normals.size() / 3);
+    texcoordBase.push_back(ret.texcoords.size() / 2);
+    triangleBase.push_back(triangles);
+    ret.positions.insert(ret.positions.end(), chunk.positions.begin(),
+                         chunk.positions.end());
+    ret.normals.insert(ret.normals.end(), chunk.normals.begin(), chunk.normals.end());
+    ret.texcoords.insert(ret.texcoords.end(), chunk.texcoords.begin(),
+                         chunk.texcoords.end());
+    triangles += chunk.triangles;
+  }
+  size_t positionCount = ret.positions.size() / 3;
+  size_t normalCount = ret.normals.size() / 3;
+  size_t texcoordCount = ret.texcoords.size() / 2;
+
+  // Each chunk writes its triangles in its own slice of the index array
+  ret.indices.resize(3 * triangles);
+  forEachChunk(jobs, chunks.size(), [&](size_t i) {
+    ObjChunk &chunk = chunks[i];
+    ObjIndex *out = ret.indices.data() + 3 * triangleBase[i];
+    vector<ObjIndex> face;
+    for (const auto &f : chunk.faces) {
+      face.clear();
+      for (uint32_t v = 0; v < f.size; v++) {
+        const int32_t *raw = &chunk.faceIndices[f.first + 3 * v];
+        ObjIndex index;
+        if (!resolve(raw[0], positionBase[i], f.positions, positionCount, index.vertex) ||
+            !resolve(raw[1], texcoordBase[i], f.texcoords, texcoordCount,
+                     index.texcoord) ||
+            !resolve(raw[2], normalBase[i], f.normals, normalCount, index.normal)) {
+          chunk.errorLine = f.line;
+          chunk.error = "face index out of range";
+          return;
+        }
+        face.push_back(index);
+      }
+
+      // Triangle fan
+      for (size_t k = 2; k < face.size(); k++) {
+        *out++ = face[0];
+        *out++ = face[k - 1];
+        *out++ = face[k];
+      }
+    }
+  });
+  checkErrors(path, chunks);
+
+  return ret;
+}
@@ -19,15 +19,32 @@
 using namespace seng;
 using namespace seng::rendering;
 
+// Create a pipeline drawing vertices of type V with the given stages
+template <typename V>
+static Pipeline createPipeline(Renderer& renderer,
+                               std::vector<vk::DescriptorSetLayout>& descriptors,
+                               std::vector<vk::PipelineShaderStageCreateInfo>& stages)
+{
+  auto descs = V::attributeDescriptions();
+  std::vector<vk::VertexInputAttributeDescription> attributes(descs.begin(), descs.end());
+  auto instanceDescs = InstanceData::attributeDescriptions();
+  attributes.insert(attributes.end(), instanceDescs.begin(), instanceDescs.end());
+  Pipeline::CreateInfo pipeInfo{
+      attributes, sizeof(V), descriptors, stages, false, sizeof(InstanceData)};
+  return Pipeline(renderer, renderer.renderPass(), pipeInfo);
+}
+
 ObjectShader::ObjectShader(Renderer& renderer,
                            std::string name,
                            std::vector<TextureType> textures,
-                           const std::vector<const ShaderStage*>& stages) :
+                           const std::vector<const ShaderStage*>& stages,
+                           const ShaderStage* packedVertexStage) :
     m_renderer(std::addressof(renderer)),
     m_name(std::move(name)),
     m_texLayout(std::move(textures)),
     m_texSetLayout(nullptr),
-    m_pipeline(nullptr)
+    m_pipeline(nullptr),
+    m_packedPipeline(nullptr)
 {
   // Create texture descriptor set, if any present
   if (m_texLayout.size() > 0) {
@@ -48,9 +65,6 @@ ObjectShader::ObjectShader(Renderer& renderer,
   }
 
   // === Pipeline creation
-  // Attributes
-  AttributeDescriptions attributes{Vertex::attributeDescriptions()};
-
   // Descriptor layouts
   std::vector<vk::DescriptorSetLayout> descriptors;
   descriptors.reserve(STAGES);
@@ -63,36 +77,37 @@ ObjectShader::ObjectShader(Renderer& renderer,
   for (size_t i = 0; i < ObjectShader::STAGES; i++)
     stageCreateInfo.emplace_back(stages[i]->stageCreateInfo());
 
-  Pipeline::CreateInfo pipeInfo{attributes, descriptors, stageCreateInfo, false};
-  m_pipeline = Pipeline(renderer, renderer.renderPass(), pipeInfo);
-  log::dbg("Created object shader {}", name);
-}
+  m_pipeline = createPipeline<Vertex>(renderer, descriptors, stageCreateInfo);
 
-void ObjectShader::use(const CommandBuffer& buffer) const
-{
-  m_pipeline.bind(buffer, vk::PipelineBindPoint::eGraphics);
+  // Same as the regular one, with the vertex stage swapped
+  if (packedVertexStage != nullptr) {
+    stageCreateInfo[0] = packedVertexStage->stageCreateInfo();
+    m_packedPipeline =
+        createPipeline<PackedVertex>(renderer, descriptors, stageCreateInfo);
+  }
+  log::dbg("Created object shader {}", m_name);
 }
 
-void ObjectShader::bindDescriptorSets(const rendering::CommandBuffer& buf,
-                                      const std::vector<vk::DescriptorSet>& sets) const
+bool ObjectShader::supports(VertexLayout layout) const
 {
-  buf.buffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *m_pipeline.layout(),
-                                  0, sets, {});
+  if (layout == VertexLayout::ePacked)
+    return *m_packedPipeline.handle() != vk::Pipeline(nullptr);
+  return true;
 }
 
-void ObjectShader::updateModelState(const CommandBuffer& buf,
-                                    const glm::mat4& model) const
+void ObjectShader::use(const CommandBuffer& buffer, VertexLayout layout) const
 {
-  buf.buffer().pushConstants<glm::mat4>(*m_pipeline.layout(),
-                                        vk::ShaderStageFlagBits::eVertex,
-                                        offsetof(PushConstants, modelMatrix), model);
+  if (layout == VertexLayout::ePacked)
+    m_packedPipeline.bind(buffer, vk::PipelineBindPoint::eGraphics);
+  else
+    m_pipeline.bind(buffer, vk::PipelineBindPoint::eGraphics);
 }
 
-void ObjectShader::updateUVScale(const CommandBuffer& buf, glm::vec2 scale) const
+void ObjectShader::bindDescriptorSets(const rendering::CommandBuffer& buf,
+                                      const std::vector<vk::DescriptorSet>& sets) const
 {
-  buf.buffer().pushConstants<glm::vec2>(*m_pipeline.layout(),
-                                        vk::ShaderStageFlagBits::eVertex,
-                                        offsetof(PushConstants, uvScale), scale);
+  buf.buffer().bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *m_pipeline.layout(),
+                                  0, sets, {});
 }
 
 ObjectShader::~ObjectShader()
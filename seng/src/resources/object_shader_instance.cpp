@@ -127,15 +127,3 @@ void ObjectShaderInstance::bindDescriptorSets(const rendering::FrameHandle& hand
   // Bind
   m_shader->bindDescriptorSets(buf, sets);
 }
-
-void ObjectShaderInstance::updateModelState(const rendering::CommandBuffer& buf,
-                                            const glm::mat4& model) const
-{
-  m_shader->updateModelState(buf, model);
-}
-
-void ObjectShaderInstance::updateUVScale(const rendering::CommandBuffer& buf,
-                                         glm::vec2 scale) const
-{
-  m_shader->updateUVScale(buf, scale);
-}
@@ -85,6 +85,12 @@ void ShaderCache::parseShaders(rendering::Renderer &renderer,
     std::transform(stageNames.begin(), stageNames.end(), stages.begin(),
                    [&](const auto &name) { return &m_stages.at(name); });
 
+    // Optional vertex stage for meshes in the packed vertex layout
+    const ShaderStage *packedVert = nullptr;
+    if (shader["packedVert"])
+      packedVert = &m_stages.at(parseStage(renderer, shaderPath, ShaderStageType::eVertex,
+                                           shader["packedVert"]));
+
     // Texture types
     std::vector<TextureType> textures;
     if (shader["textureTypes"] && shader["textureTypes"].IsSequence()) {
@@ -102,7 +108,8 @@ void ShaderCache::parseShaders(rendering::Renderer &renderer,
       }
     }
 
-    auto ret = m_shaders.try_emplace(name, renderer, name, std::move(textures), stages);
+    auto ret = m_shaders.try_emplace(name, renderer, name, std::move(textures), stages,
+                                     packedVert);
     if (!ret.second)
       seng::log::warning("Duplicated shader name {}", name);
     else
@@ -2,21 +2,19 @@
 #include <seng/rendering/buffer.hpp>
 #include <seng/rendering/command_buffer.hpp>
 #include <seng/rendering/renderer.hpp>
+#include <seng/rendering/upload_batch.hpp>
 #include <seng/resources/texture.hpp>
 
 #include <stb_image.h>
 #include <vulkan/vulkan_raii.hpp>
 
 #include <filesystem>
+#include <optional>
 #include <stdexcept>
 
 using namespace seng;
 namespace fs = std::filesystem;
 
-static vk::BufferUsageFlags STAGING_BUFFER_USAGE = vk::BufferUsageFlagBits::eTransferSrc;
-static vk::MemoryPropertyFlags STAGING_BUFFER_MEM =
-    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
-
 SamplerOptions SamplerOptions::optimal(const rendering::Renderer &renderer)
 {
   SamplerOptions opts;
@@ -38,10 +36,11 @@ void Texture::fill(Texture &tex,
                    rendering::Renderer &renderer,
                    TextureType typ,
                    SamplerOptions opts,
-                   void *pixelData,
+                   const void *pixelData,
                    vk::DeviceSize size,
                    unsigned int width,
-                   unsigned int height)
+                   unsigned int height,
+                   rendering::UploadBatch &batch)
 {
   tex.m_type = typ;
 
@@ -76,23 +75,18 @@ void Texture::fill(Texture &tex,
   tex.m_image = rendering::Image(renderer.device(), imgInfo);
 
   seng::log::dbg("Uploading pixel data to device");
-  rendering::Buffer staging(renderer.device(), STAGING_BUFFER_USAGE, size,
-                            STAGING_BUFFER_MEM, true);
-  staging.load(pixelData, 0, size, {});
-  rendering::CommandBuffer::recordSingleUse(
-      renderer.device(), renderer.commandPool(), renderer.device().graphicsQueue(),
-      [&](auto &cmd) {
-        tex.image().transitionLayout(cmd, imgInfo.format, vk::ImageLayout::eUndefined,
-                                     vk::ImageLayout::eTransferDstOptimal);
-        tex.image().copyFromBuffer(cmd, staging);
-        if (tex.image().hasMipMaps()) {
-          tex.image().generateMipMapsBeforeShader(cmd, imgInfo.format);
-        } else {
-          tex.image().transitionLayout(cmd, imgInfo.format,
-                                       vk::ImageLayout::eTransferDstOptimal,
-                                       vk::ImageLayout::eShaderReadOnlyOptimal);
-        }
-      });
+  auto staged = batch.stage(pixelData, size);
+  batch.record([&tex, staged, format = imgInfo.format](auto &cmd) {
+    tex.image().transitionLayout(cmd, format, vk::ImageLayout::eUndefined,
+                                 vk::ImageLayout::eTransferDstOptimal);
+    tex.image().copyFromBuffer(cmd, *staged.buffer, staged.offset);
+    if (tex.image().hasMipMaps()) {
+      tex.image().generateMipMapsBeforeShader(cmd, format);
+    } else {
+      tex.image().transitionLayout(cmd, format, vk::ImageLayout::eTransferDstOptimal,
+                                   vk::ImageLayout::eShaderReadOnlyOptimal);
+    }
+  });
   tex.m_image.createView(imgInfo.viewType, imgInfo.format, imgInfo.aspectFlags);
 
   vk::SamplerCreateInfo samplerInfo;
@@ -119,7 +113,20 @@ Texture::Texture(rendering::Renderer &renderer,
                  glm::vec<4, unsigned char> color) :
     seng::Texture()
 {
-  fill(*this, renderer, type, {}, &color, sizeof(color), 1, 1);
+  rendering::UploadBatch batch(renderer.uploader());
+  fill(*this, renderer, type, {}, &color, sizeof(color), 1, 1, batch);
+  batch.submit();
+}
+
+Texture::Texture(rendering::Renderer &renderer,
+                 TextureType type,
+                 SamplerOptions opts,
+                 const Pixels &pixels,
+                 rendering::UploadBatch &batch) :
+    seng::Texture()
+{
+  fill(*this, renderer, type, opts, pixels.data.get(), pixels.width * pixels.height * 4,
+       pixels.width, pixels.height, batch);
 }
 
 Texture Texture::loadFromDisk(rendering::Renderer &renderer,
@@ -127,25 +134,40 @@ Texture Texture::loadFromDisk(rendering::Renderer &renderer,
                               SamplerOptions opts,
                               const std::string &assetPath,
                               const std::string &name)
+{
+  auto pixels = decodeFromDisk(assetPath, name);
+  if (!pixels.has_value()) {
+    seng::log::error("Allocating fallback texture for {}", name);
+    return Texture(renderer, typ);
+  }
+
+  rendering::UploadBatch batch(renderer.uploader());
+  Texture ret;
+  fill(ret, renderer, typ, opts, pixels->data.get(), pixels->width * pixels->height * 4,
+       pixels->width, pixels->height, batch);
+  batch.submit();
+  return ret;
+}
+
+std::optional<Texture::Pixels> Texture::decodeFromDisk(const std::string &assetPath,
+                                                       const std::string &name)
 {
   std::string texPath{fs::path{assetPath} / fs::path{name}};
   if (!fs::exists(texPath)) {
-    seng::log::error("Could not locate {}, allocating fallback texture", name);
-    return Texture(renderer, typ);
+    seng::log::error("Could not locate {}", name);
+    return std::nullopt;
   }
 
   int texWidth, texHeight, texChannels;
   stbi_uc *pixels =
       stbi_load(texPath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
   if (!pixels) {
-    seng::log::error("Could not load {}, allocating fallback texture", name);
-    return Texture(renderer, typ);
+    seng::log::error("Could not load {}", name);
+    return std::nullopt;
   }
   seng::log::dbg("Loaded {} from disk", name);
 
-  Texture ret;
-  fill(ret, renderer, typ, opts, pixels, texWidth * texHeight * 4, texWidth, texHeight);
-
-  stbi_image_free(pixels);
-  return ret;
+  return Pixels{{pixels, stbi_image_free},
+                static_cast<unsigned int>(texWidth),
+                static_cast<unsigned int>(texHeight)};
 }
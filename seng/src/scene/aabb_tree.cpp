@@ -0,0 +1,488 @@
+#include <seng/math.hpp>
+#include <seng/scene/aabb_tree.hpp>
+#include <seng/scene/frustum.hpp>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+using namespace seng;
+using namespace std;
+
+// Fat boxes grown past this many margins around their box are shrunk back
+static constexpr float MAX_SLACK = 4.0f;
+
+// Nodes still to visit during a traversal. Balanced trees are shallow, so they
+// rarely need more than the inline storage.
+namespace {
+class TraversalStack {
+ public:
+  bool empty() const { return m_size == 0; }
+
+  void push(int32_t node)
+  {
+    if (m_size < INLINE)
+      m_inline[m_size] = node;
+    else
+      m_spill.push_back(node);
+    m_size++;
+  }
+
+  int32_t pop()
+  {
+    m_size--;
+    if (m_size < INLINE) return m_inline[m_size];
+    int32_t node = m_spill.back();
+    m_spill.pop_back();
+    return node;
+  }
+
+ private:
+  static constexpr size_t INLINE = 64;
+  int32_t m_inline[INLINE];
+  vector<int32_t> m_spill;
+  size_t m_size = 0;
+};
+}  // namespace
+
+AabbTree::AabbTree(float margin)
+{
+  m_margin = margin;
+  m_root = NULL_NODE;
+  m_free = NULL_NODE;
+  m_leaves = 0;
+}
+
+int32_t AabbTree::allocateNode()
+{
+  if (m_free == NULL_NODE) {
+    m_nodes.emplace_back();
+    m_free = static_cast<int32_t>(m_nodes.size() - 1);
+    m_nodes[m_free].parent = NULL_NODE;
+  }
+  int32_t node = m_free;
+  Node &n = m_nodes[node];
+  m_free = n.parent;
+  n.entity = nullptr;
+  n.parent = NULL_NODE;
+  n.child1 = NULL_NODE;
+  n.child2 = NULL_NODE;
+  n.height = 0;
+  return node;
+}
+
+void AabbTree::freeNode(int32_t node)
+{
+  m_nodes[node].parent = m_free;
+  m_nodes[node].height = -1;
+  m_free = node;
+}
+
+int32_t AabbTree::insert(const Aabb &box, Entity *entity)
+{
+  int32_t leaf = allocateNode();
+  Node &n = m_nodes[leaf];
+  n.tight = box;
+  n.box = {box.min - glm::vec3(m_margin), box.max + glm::vec3(m_margin)};
+  n.entity = entity;
+  insertLeaf(leaf);
+  m_leaves++;
+  return leaf;
+}
+
+void AabbTree::remove(int32_t proxy)
+{
+  removeLeaf(proxy);
+  freeNode(proxy);
+  m_leaves--;
+}
+
+bool AabbTree::move(int32_t proxy, const Aabb &box)
+{
+  Node &n = m_nodes[proxy];
+  n.tight = box;
+
+  glm::vec3 slack(MAX_SLACK * m_margin);
+  Aabb loose{box.min - slack, box.max + slack};
+  if (n.box.contains(box) && loose.contains(n.box)) return false;
+
+  removeLeaf(proxy);
+  n.box = {box.min - glm::vec3(m_margin), box.max + glm::vec3(m_margin)};
+  insertLeaf(proxy);
+  return true;
+}
+
+void AabbTree::clear()
+{
+  m_nodes.clear();
+  m_root = NULL_NODE;
+  m_free = NULL_NODE;
+  m_leaves = 0;
+}
+
+void AabbTree::rebuild()
+{
+  vector<BuildItem> items;
+  items.reserve(m_leaves);
+  for (size_t i = 0; i < m_nodes.size(); i++) {
+    int32_t index = static_cast<int32_t>(i);
+    if (m_nodes[i].height < 0) continue;
+    if (m_nodes[i].isLeaf())
+      items.push_back({m_nodes[i].box.center(), index});
+    else
+      freeNode(index);
+  }
+  if (items.empty()) return;
+  m_root = build(items.data(), items.size());
+  m_nodes[m_root].parent = NULL_NODE;
+}
+
+// Recursively split the leaves in half along the longest axis of the box
+// containing their centers
+int32_t AabbTree::build(BuildItem *items, size_t count)
+{
+  if (count == 1) return items[0].leaf;
+
+  glm::vec3 lo = items[0].center, hi = lo;
+  for (size_t i = 1; i < count; i++) {
+    lo = glm::min(lo, items[i].center);
+    hi = glm::max(hi, items[i].center);
+  }
+  glm::vec3 size = hi - lo;
+  int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+
+  size_t mid = count / 2;
+  nth_element(items, items + mid, items + count,
+              [&](const BuildItem &a, const BuildItem &b) {
+                return a.center[axis] < b.center[axis];
+              });
+  int32_t child1 = build(items, mid);
+  int32_t child2 = build(items + mid, count - mid);
+
+  int32_t index = allocateNode();
+  Node &n = m_nodes[index];
+  const Node &c1 = m_nodes[child1];
+  const Node &c2 = m_nodes[child2];
+  n.child1 = child1;
+  n.child2 = child2;
+  n.box = c1.box.merged(c2.box);
+  n.height = 1 + max(c1.height, c2.height);
+  m_nodes[child1].parent = index;
+  m_nodes[child2].parent = index;
+  return index;
+}
+
+void AabbTree::insertLeaf(int32_t leaf)
+{
+  if (m_root == NULL_NODE) {
+    m_root = leaf;
+    m_nodes[leaf].parent = NULL_NODE;
+    return;
+  }
+
+  // Find the sibling that makes the total area of the internal nodes grow the
+  // least with branch and bound (Catto, "Dynamic Bounding Volume Hierarchies",
+  // GDC 2019). Choosing a node costs the area of its new parent plus how much
+  // its ancestors grow, and the leaf's area plus the latter bounds the cost of
+  // its descendants. Candidates are visited best first.
+  Aabb box = m_nodes[leaf].box;
+  float leafArea = box.area();
+  int32_t sibling = m_root;
+  float best = numeric_limits<float>::infinity();
+
+  auto &queue = m_candidates;
+  auto cheaper = [](const Candidate &a, const Candidate &b) { return a.bound > b.bound; };
+  queue.clear();
+  queue.push_back({m_root, 0.0f, leafArea});
+  while (!queue.empty()) {
+    pop_heap(queue.begin(), queue.end(), cheaper);
+    Candidate c = queue.back();
+    queue.pop_back();
+    if (c.bound >= best) break;
+
+    const Node &n = m_nodes[c.node];
+    float merged = n.box.merged(box).area();
+    if (merged + c.ancestors < best) {
+      best = merged + c.ancestors;
+      sibling = c.node;
+    }
+    if (n.isLeaf()) continue;
+
+    float growth = c.ancestors + merged - n.box.area();
+    if (leafArea + growth >= best) continue;
+    queue.push_back({n.child1, growth, leafArea + growth});
+    push_heap(queue.begin(), queue.end(), cheaper);
+    queue.push_back({n.child2, growth, leafArea + growth});
+    push_heap(queue.begin(), queue.end(), cheaper);
+  }
+
+  // Make a new parent for the sibling and the leaf
+  int32_t oldParent = m_nodes[sibling].parent;
+  int32_t newParent = allocateNode();
+  Node &p = m_nodes[newParent];
+  p.parent = oldParent;
+  p.box = m_nodes[sibling].box.merged(box);
+  p.height = m_nodes[sibling].height + 1;
+  p.child1 = sibling;
+  p.child2 = leaf;
+  m_nodes[sibling].parent = newParent;
+  m_nodes[leaf].parent = newParent;
+
+  if (oldParent == NULL_NODE)
+    m_root = newParent;
+  else if (m_nodes[oldParent].child1 == sibling)
+    m_nodes[oldParent].child1 = newParent;
+  else
+    m_nodes[oldParent].child2 = newParent;
+
+  refit(m_nodes[leaf].parent);
+}
+
+void AabbTree::removeLeaf(int32_t leaf)
+{
+  if (leaf == m_root) {
+    m_root = NULL_NODE;
+    return;
+  }
+
+  // The sibling takes the place of the parent
+  int32_t parent = m_nodes[leaf].parent;
+  int32_t grandParent = m_nodes[parent].parent;
+  int32_t sibling =
+      m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+  freeNode(parent);
+  m_nodes[sibling].parent = grandParent;
+
+  if (grandParent == NULL_NODE) {
+    m_root = sibling;
+    return;
+  }
+  if (m_nodes[grandParent].child1 == parent)
+    m_nodes[grandParent].child1 = sibling;
+  else
+    m_nodes[grandParent].child2 = sibling;
+  refit(grandParent);
+}
+
+// Walk up to the root rebalancing and fixing boxes and heights
+void AabbTree::refit(int32_t index)
+{
+  while (index != NULL_NODE) {
+    index = balance(index);
+    Node &n = m_nodes[index];
+    const Node &c1 = m_nodes[n.child1];
+    const Node &c2 = m_nodes[n.child2];
+    n.height = 1 + max(c1.height, c2.height);
+    n.box = c1.box.merged(c2.box);
+    index = n.parent;
+  }
+}
+
+// If one of the children of A is more than one level taller than the other,
+// rotate it up in place of A: with B and C the children of A, and F and G the
+// ones of C, the taller C becomes the parent of A and of its own taller child,
+// while the shorter takes the place of C under A. Returns the index of the
+// subtree's new root.
+int32_t AabbTree::balance(int32_t iA)
+{
+  Node &a = m_nodes[iA];
+  if (a.isLeaf() || a.height < 2) return iA;
+
+  int32_t iB = a.child1;
+  int32_t iC = a.child2;
+  int32_t diff = m_nodes[iC].height - m_nodes[iB].height;
+  if (diff >= -1 && diff <= 1) return iA;
+
+  // Rotating the left child up is the mirror image of rotating the right one
+  bool right = diff > 1;
+  int32_t iUp = right ? iC : iB;
+  int32_t iStay = right ? iB : iC;
+  Node &up = m_nodes[iUp];
+
+  int32_t iF = up.child1;
+  int32_t iG = up.child2;
+  if (m_nodes[iF].height < m_nodes[iG].height) swap(iF, iG);
+  // F is now the tallest grandchild, which stays attached to the lifted node
+
+  up.child1 = iA;
+  up.child2 = iF;
+  up.parent = a.parent;
+  a.parent = iUp;
+  if (up.parent == NULL_NODE)
+    m_root = iUp;
+  else if (m_nodes[up.parent].child1 == iA)
+    m_nodes[up.parent].child1 = iUp;
+  else
+    m_nodes[up.parent].child2 = iUp;
+
+  if (right)
+    a.child2 = iG;
+  else
+    a.child1 = iG;
+  m_nodes[iG].parent = iA;
+
+  const Node &stay = m_nodes[iStay];
+  const Node &g = m_nodes[iG];
+  const Node &f = m_nodes[iF];
+  a.box = stay.box.merged(g.box);
+  a.height = 1 + max(stay.height, g.height);
+  up.box = a.box.merged(f.box);
+  up.height = 1 + max(a.height, f.height);
+  return iUp;
+}
+
+void AabbTree::collectLeaves(int32_t node, std::vector<Entity *> &out) const
+{
+  TraversalStack stack;
+  stack.push(node);
+  while (!stack.empty()) {
+    const Node &n = m_nodes[stack.pop()];
+    if (n.isLeaf()) {
+      out.push_back(n.entity);
+    } else {
+      stack.push(n.child1);
+      stack.push(n.child2);
+    }
+  }
+}
+
+void AabbTree::query(const Aabb &box, std::vector<Entity *> &out) const
+{
+  if (m_root == NULL_NODE) return;
+  TraversalStack stack;
+  stack.push(m_root);
+  while (!stack.empty()) {
+    const Node &n = m_nodes[stack.pop()];
+    if (!n.box.overlaps(box)) continue;
+    if (n.isLeaf()) {
+      if (n.tight.overlaps(box)) out.push_back(n.entity);
+    } else {
+      stack.push(n.child1);
+      stack.push(n.child2);
+    }
+  }
+}
+
+// Squared distance between a point and the closest point of a box to it
+static float distance2(const Aabb &box, glm::vec3 p)
+{
+  glm::vec3 d = glm::max(glm::max(box.min - p, p - box.max), glm::vec3(0.0f));
+  return glm::dot(d, d);
+}
+
+void AabbTree::query(glm::vec3 center, float radius, std::vector<Entity *> &out) const
+{
+  if (m_root == NULL_NODE) return;
+  float radius2 = radius * radius;
+  TraversalStack stack;
+  stack.push(m_root);
+  while (!stack.empty()) {
+    const Node &n = m_nodes[stack.pop()];
+    if (distance2(n.box, center) > radius2) continue;
+    if (n.isLeaf()) {
+      if (distance2(n.tight, center) <= radius2) out.push_back(n.entity);
+    } else {
+      stack.push(n.child1);
+      stack.push(n.child2);
+    }
+  }
+}
+
+enum struct Containment { eOutside, eIntersecting, eInside };
+
+// Same test as the culling kernels, also telling apart boxes that are entirely
+// on the inner side of all planes
+static Containment classify(const Frustum &f, const Aabb &box)
+{
+  glm::vec3 c = box.center(), e = box.extent();
+  Containment res = Containment::eInside;
+  for (const auto &p : f.planes) {
+    float distance = p.x * c.x + p.y * c.y + p.z * c.z + p.w;
+    float radius = abs(p.x) * e.x + abs(p.y) * e.y + abs(p.z) * e.z;
+    if (distance + radius < 0.0f) return Containment::eOutside;
+    if (distance - radius < 0.0f) res = Containment::eIntersecting;
+  }
+  return res;
+}
+
+void AabbTree::query(const Frustum &frustum, std::vector<Entity *> &out) const
+{
+  if (m_root == NULL_NODE) return;
+  TraversalStack stack;
+  stack.push(m_root);
+  while (!stack.empty()) {
+    int32_t index = stack.pop();
+    const Node &n = m_nodes[index];
+    Containment c = classify(frustum, n.box);
+    if (c == Containment::eOutside) continue;
+
+    // Everything below a node inside the frustum is inside as well
+    if (c == Containment::eInside) {
+      collectLeaves(index, out);
+    } else if (n.isLeaf()) {
+      if (classify(frustum, n.tight) != Containment::eOutside) out.push_back(n.entity);
+    } else {
+      stack.push(n.child1);
+      stack.push(n.child2);
+    }
+  }
+}
+
+// Slab test, returns the distance at which the ray enters the box, or a
+// negative value if it misses it within the given distance
+static float rayEnter(const Aabb &box, glm::vec3 origin, glm::vec3 inv, float maxT)
+{
+  glm::vec3 t0 = (box.min - origin) * inv;
+  glm::vec3 t1 = (box.max - origin) * inv;
+  glm::vec3 tmin = glm::min(t0, t1), tmax = glm::max(t0, t1);
+  float enter = max({tmin.x, tmin.y, tmin.z, 0.0f});
+  float exit = min({tmax.x, tmax.y, tmax.z, maxT});
+  return enter <= exit ? enter : -1.0f;
+}
+
+bool AabbTree::raycast(glm::vec3 origin,
+                       glm::vec3 direction,
+                       float maxDistance,
+                       RayHit &hit) const
+{
+  float length = glm::length(direction);
+  if (m_root == NULL_NODE || length == 0.0f) return false;
+  glm::vec3 inv = 1.0f / (direction / length);
+
+  bool found = false;
+  float best = maxDistance;
+  TraversalStack stack;
+  if (rayEnter(m_nodes[m_root].box, origin, inv, best) >= 0.0f) stack.push(m_root);
+  while (!stack.empty()) {
+    const Node &n = m_nodes[stack.pop()];
+    if (n.isLeaf()) {
+      float t = rayEnter(n.tight, origin, inv, best);
+      if (t >= 0.0f) {
+        found = true;
+        best = t;
+        hit = {n.entity, t};
+      }
+      continue;
+    }
+
+    // Visit the nearest child first, so that hits in it prune the other
+    float t1 = rayEnter(m_nodes[n.child1].box, origin, inv, best);
+    float t2 = rayEnter(m_nodes[n.child2].box, origin, inv, best);
+    int32_t first = n.child1, second = n.child2;
+    if (t2 >= 0.0f && (t1 < 0.0f || t2 < t1)) {
+      swap(first, second);
+      swap(t1, t2);
+    }
+    if (t2 >= 0.0f) stack.push(second);
+    if (t1 >= 0.0f) stack.push(first);
+  }
+  return found;
+}
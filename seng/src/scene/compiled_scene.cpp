@@ -0,0 +1,316 @@
+#include <seng/components/transform.hpp>
+#include <seng/log.hpp>
+#include <seng/scene/compiled_scene.hpp>
+#include <seng/yaml_utils.hpp>
+
+#include <yaml-cpp/yaml.h>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace seng;
+using namespace std;
+
+// Records being built by compileScene
+struct CompilerOutput {
+  vector<sscene::String> strings;
+  string stringData;
+  unordered_map<string, uint32_t> interned;
+  vector<sscene::Entity> entities;
+  vector<sscene::Component> components;
+  vector<sscene::Node> nodes;
+};
+
+static uint32_t intern(CompilerOutput &out, const string &str)
+{
+  auto it = out.interned.find(str);
+  if (it != out.interned.end()) return it->second;
+
+  uint32_t index = out.strings.size();
+  out.strings.push_back({static_cast<uint32_t>(out.stringData.size()),
+                         static_cast<uint32_t>(str.size())});
+  out.stringData += str;
+  out.interned.emplace(str, index);
+  return index;
+}
+
+static uint32_t reserveNodes(CompilerOutput &out, size_t count)
+{
+  uint32_t first = out.nodes.size();
+  out.nodes.resize(out.nodes.size() + count);
+  return first;
+}
+
+// Children are reserved before being filled, so that they are contiguous
+static void fillNode(CompilerOutput &out, uint32_t index, const YAML::Node &node)
+{
+  sscene::Node rec{sscene::NodeKind::eNull, 0, 0};
+  switch (node.Type()) {
+    case YAML::NodeType::Scalar:
+      rec.kind = sscene::NodeKind::eScalar;
+      rec.value = intern(out, node.Scalar());
+      break;
+    case YAML::NodeType::Sequence: {
+      rec.kind = sscene::NodeKind::eSequence;
+      rec.size = node.size();
+      rec.value = reserveNodes(out, rec.size);
+      uint32_t i = rec.value;
+      for (const auto &child : node) fillNode(out, i++, child);
+      break;
+    }
+    case YAML::NodeType::Map: {
+      rec.kind = sscene::NodeKind::eMap;
+      rec.size = 2 * node.size();
+      rec.value = reserveNodes(out, rec.size);
+      uint32_t i = rec.value;
+      for (const auto &entry : node) {
+        fillNode(out, i++, entry.first);
+        fillNode(out, i++, entry.second);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  out.nodes[index] = rec;
+}
+
+static void copyVec(const glm::vec3 &v, float *dst)
+{
+  for (int i = 0; i < 3; i++) dst[i] = v[i];
+}
+
+static void copyVec(const glm::vec4 &v, float *dst)
+{
+  for (int i = 0; i < 4; i++) dst[i] = v[i];
+}
+
+static void compileLight(const YAML::Node &light, sscene::Header &header)
+{
+  if (light["ambient"] && light["ambient"].IsSequence()) {
+    copyVec(light["ambient"].as<glm::vec4>(), header.ambient);
+    header.lightFlags |= sscene::eAmbient;
+  }
+  if (light["color"] && light["color"].IsSequence()) {
+    copyVec(light["color"].as<glm::vec4>(), header.lightColor);
+    header.lightFlags |= sscene::eColor;
+  }
+  if (light["direction"] && light["direction"].IsSequence()) {
+    copyVec(light["direction"].as<glm::vec3>(), header.lightDirection);
+    header.lightFlags |= sscene::eDirection;
+  }
+}
+
+// Mirrors Scene::parseEntity, parents are resolved to the first entity with
+// that name defined before, like Scene::findByName would at load time
+static void compileEntity(CompilerOutput &out,
+                          unordered_map<string, uint32_t> &byName,
+                          const YAML::Node &node)
+{
+  if (!node.IsMap()) {
+    seng::log::warning("Malformed YAML node");
+    return;
+  }
+
+  string name = "Entity";
+  if (node["name"] && node["name"].IsScalar()) name = node["name"].as<string>();
+
+  optional<string> parentName;
+  glm::vec3 pos = Transform::DEFAULT_POS;
+  glm::vec3 scale = Transform::DEFAULT_SCALE;
+  glm::vec3 rot = Transform::DEFAULT_ROT;
+  if (node["transform"] && node["transform"].IsMap())
+    Transform::parseConfig(node["transform"], parentName, pos, scale, rot);
+
+  sscene::Entity rec;
+  rec.name = intern(out, name);
+  rec.parent = sscene::NO_PARENT;
+  if (parentName.has_value()) {
+    auto parent = byName.find(*parentName);
+    if (parent != byName.end())
+      rec.parent = parent->second;
+    else
+      seng::log::warning("Parent {} of {} has not been defined, defaulting to null",
+                         *parentName, name);
+  }
+  copyVec(pos, rec.position);
+  copyVec(scale, rec.scale);
+  copyVec(rot, rec.rotation);
+  rec.firstComponent = out.components.size();
+  rec.componentCount = 0;
+
+  if (node["components"] && node["components"].IsSequence()) {
+    for (const auto &comp : node["components"]) {
+      if (!comp.IsMap() || !comp["id"] || !comp["id"].IsScalar()) {
+        seng::log::warning("Malformed YAML component, skipping...");
+        continue;
+      }
+      uint32_t id = intern(out, comp["id"].as<string>());
+      uint32_t root = reserveNodes(out, 1);
+      fillNode(out, root, comp);
+      out.components.push_back({id, root});
+      rec.componentCount++;
+    }
+  }
+
+  byName.emplace(name, static_cast<uint32_t>(out.entities.size()));
+  out.entities.push_back(rec);
+}
+
+template <typename T>
+static void writeSection(ostream &out, const vector<T> &records)
+{
+  out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(T));
+}
+
+void seng::compileScene(const YAML::Node &scene, ostream &stream)
+{
+  CompilerOutput out;
+  sscene::Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, sscene::MAGIC, sizeof(header.magic));
+  header.version = sscene::VERSION;
+
+  try {
+    if (scene["Light"] && scene["Light"].IsMap()) compileLight(scene["Light"], header);
+
+    unordered_map<string, uint32_t> byName;
+    if (scene["Entities"] && scene["Entities"].IsSequence())
+      for (const auto &e : scene["Entities"]) compileEntity(out, byName, e);
+  } catch (const YAML::Exception &e) {
+    throw runtime_error(string("Malformed scene: ") + e.what());
+  }
+
+  // Keep every section aligned to 4 bytes
+  while (out.stringData.size() % 4 != 0) out.stringData.push_back('\0');
+
+  uint32_t offset = sizeof(sscene::Header);
+  auto place = [&](sscene::Section &s, size_t count, size_t recordSize) {
+    s.offset = offset;
+    s.count = count;
+    offset += count * recordSize;
+  };
+  place(header.strings, out.strings.size(), sizeof(sscene::String));
+  place(header.stringData, out.stringData.size(), 1);
+  place(header.entities, out.entities.size(), sizeof(sscene::Entity));
+  place(header.components, out.components.size(), sizeof(sscene::Component));
+  place(header.nodes, out.nodes.size(), sizeof(sscene::Node));
+
+  stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  writeSection(stream, out.strings);
+  stream.write(out.stringData.data(), out.stringData.size());
+  writeSection(stream, out.entities);
+  writeSection(stream, out.components);
+  writeSection(stream, out.nodes);
+  if (!stream) throw runtime_error("Unable to write compiled scene");
+}
+
+CompiledScene::CompiledScene(const std::string &path) : m_file(path)
+{
+  if (m_file.size() < sizeof(sscene::Header))
+    throw runtime_error(path + " is too small to be a compiled scene");
+  validate();
+}
+
+template <typename T>
+const T *CompiledScene::section(const sscene::Section &s) const
+{
+  // 64 bit math, so that nothing can overflow
+  uint64_t end = uint64_t{s.offset} + uint64_t{s.count} * sizeof(T);
+  if (s.offset % alignof(T) != 0 || end > m_file.size())
+    throw runtime_error("Compiled scene section out of bounds");
+  return reinterpret_cast<const T *>(m_file.data() + s.offset);
+}
+
+void CompiledScene::validate()
+{
+  m_header = reinterpret_cast<const sscene::Header *>(m_file.data());
+  if (memcmp(m_header->magic, sscene::MAGIC, sizeof(sscene::MAGIC)) != 0)
+    throw runtime_error("Not a compiled scene");
+  if (m_header->version != sscene::VERSION)
+    throw runtime_error("Unsupported compiled scene version " +
+                        to_string(m_header->version));
+
+  m_strings = section<sscene::String>(m_header->strings);
+  m_stringData = section<char>(m_header->stringData);
+  m_entities = section<sscene::Entity>(m_header->entities);
+  m_components = section<sscene::Component>(m_header->components);
+  m_nodes = section<sscene::Node>(m_header->nodes);
+
+  const auto &h = *m_header;
+  for (uint32_t i = 0; i < h.strings.count; i++) {
+    uint64_t end = uint64_t{m_strings[i].offset} + m_strings[i].length;
+    if (end > h.stringData.count) throw runtime_error("Invalid string record");
+  }
+  for (uint32_t i = 0; i < h.entities.count; i++) {
+    const auto &e = m_entities[i];
+    uint64_t end = uint64_t{e.firstComponent} + e.componentCount;
+    if (e.name >= h.strings.count || end > h.components.count ||
+        (e.parent != sscene::NO_PARENT && e.parent >= i))
+      throw runtime_error("Invalid entity record");
+  }
+  for (uint32_t i = 0; i < h.components.count; i++) {
+    const auto &c = m_components[i];
+    if (c.id >= h.strings.count || c.node >= h.nodes.count)
+      throw runtime_error("Invalid component record");
+  }
+  // Children always come after their parent, so trees can't have cycles
+  for (uint32_t i = 0; i < h.nodes.count; i++) {
+    const auto &n = m_nodes[i];
+    bool valid = true;
+    switch (n.kind) {
+      case sscene::NodeKind::eNull:
+        break;
+      case sscene::NodeKind::eScalar:
+        valid = n.value < h.strings.count;
+        break;
+      case sscene::NodeKind::eMap:
+        valid = n.size % 2 == 0;
+        [[fallthrough]];
+      case sscene::NodeKind::eSequence:
+        valid = valid && (n.size == 0 || (n.value > i && uint64_t{n.value} + n.size <=
+                                                               h.nodes.count));
+        break;
+      default:
+        valid = false;
+    }
+    if (!valid) throw runtime_error("Invalid node record");
+  }
+}
+
+string_view CompiledScene::string(uint32_t index) const
+{
+  const auto &s = m_strings[index];
+  return string_view(m_stringData + s.offset, s.length);
+}
+
+YAML::Node CompiledScene::node(uint32_t index) const
+{
+  const auto &n = m_nodes[index];
+  switch (n.kind) {
+    case sscene::NodeKind::eScalar:
+      return YAML::Node(std::string(string(n.value)));
+    case sscene::NodeKind::eSequence: {
+      YAML::Node seq(YAML::NodeType::Sequence);
+      for (uint32_t i = 0; i < n.size; i++) seq.push_back(node(n.value + i));
+      return seq;
+    }
+    case sscene::NodeKind::eMap: {
+      YAML::Node map(YAML::NodeType::Map);
+      for (uint32_t i = 0; i < n.size; i += 2)
+        map.force_insert(node(n.value + i), node(n.value + i + 1));
+      return map;
+    }
+    default:
+      return YAML::Node(YAML::NodeType::Null);
+  }
+}
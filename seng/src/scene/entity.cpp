@@ -4,20 +4,20 @@
 #include <seng/scene/entity.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
 
 using namespace seng;
 using namespace std;
 
-uint64_t Entity::INDEX_COUNTER = 0;
+std::atomic<uint64_t> Entity::INDEX_COUNTER = 0;
 const Entity::ComponentList Entity::EMPTY_VECTOR;
 
 Entity::Entity(Application& app, Scene& s, std::string n) :
     m_app(std::addressof(app)),
     m_scene(std::addressof(s)),
     m_id(INDEX_COUNTER++),
-    m_name(std::move(n)),
-    m_transform(std::make_unique<Transform>(*this))
+    m_name(std::move(n))
 {
 }
 
@@ -40,7 +40,7 @@ void Entity::transform(ComponentPtr&& t)
 void Entity::untypedInsert(const ComponentIdType& id, ComponentPtr&& cmp)
 {
   if (!checkAndWarnCompPtr(cmp)) {
-    m_components[id].push_back(std::move(cmp));
+    m_components[componentTypeId(id)].push_back(std::move(cmp));
   }
 }
 
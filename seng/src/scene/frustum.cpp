@@ -0,0 +1,161 @@
+#include <seng/scene/frustum.hpp>
+
+#include <glm/geometric.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SENG_CULL_X86
+#include <immintrin.h>
+#endif
+
+using namespace seng;
+using namespace std;
+
+Frustum Frustum::fromMatrix(const glm::mat4 &m)
+{
+  // glm is column major, so rows have to be gathered
+  glm::vec4 r0(m[0][0], m[1][0], m[2][0], m[3][0]);
+  glm::vec4 r1(m[0][1], m[1][1], m[2][1], m[3][1]);
+  glm::vec4 r2(m[0][2], m[1][2], m[2][2], m[3][2]);
+  glm::vec4 r3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+  Frustum f;
+  f.planes[eLeft] = r3 + r0;
+  f.planes[eRight] = r3 - r0;
+  f.planes[eBottom] = r3 + r1;
+  f.planes[eTop] = r3 - r1;
+  f.planes[eNear] = r2;  // Depth goes from 0, not -w
+  f.planes[eFar] = r3 - r2;
+  for (auto &p : f.planes) {
+    float length = glm::length(glm::vec3(p));
+    if (length > 0.0f) p /= length;
+  }
+  return f;
+}
+
+// Processes batch elements starting from the given one, returns the index of
+// the first element left unprocessed
+using KernelFunc = size_t (*)(const Frustum &, const AabbBatch &, size_t, uint8_t *);
+
+struct CullKernel {
+  const char *name;
+  KernelFunc func;
+};
+
+// A box is outside a plane if even its corner furthest along the plane's normal
+// is, i.e. if its center is further away than the box's extent projected on it
+static size_t cullScalar(const Frustum &f, const AabbBatch &b, size_t i, uint8_t *visible)
+{
+  for (; i < b.count; i++) {
+    bool inside = true;
+    for (const auto &p : f.planes) {
+      float distance = p.x * b.cx[i] + p.y * b.cy[i] + p.z * b.cz[i] + p.w;
+      float radius = abs(p.x) * b.ex[i] + abs(p.y) * b.ey[i] + abs(p.z) * b.ez[i];
+      inside &= distance + radius >= 0.0f;
+    }
+    visible[i] = inside;
+  }
+  return i;
+}
+
+#ifdef SENG_CULL_X86
+__attribute__((target("sse2"))) static size_t cullSSE(const Frustum &f,
+                                                      const AabbBatch &b,
+                                                      size_t i,
+                                                      uint8_t *visible)
+{
+  const __m128 zero = _mm_setzero_ps();
+  for (; i + 4 <= b.count; i += 4) {
+    __m128 cx = _mm_loadu_ps(b.cx + i), cy = _mm_loadu_ps(b.cy + i);
+    __m128 cz = _mm_loadu_ps(b.cz + i);
+    __m128 ex = _mm_loadu_ps(b.ex + i), ey = _mm_loadu_ps(b.ey + i);
+    __m128 ez = _mm_loadu_ps(b.ez + i);
+
+    __m128 inside = _mm_cmpeq_ps(zero, zero);
+    for (const auto &p : f.planes) {
+      __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), cx), _mm_mul_ps(_mm_set1_ps(p.y), cy)),
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.z), cz), _mm_set1_ps(p.w)));
+      __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(abs(p.x)), ex),
+                                            _mm_mul_ps(_mm_set1_ps(abs(p.y)), ey)),
+                                 _mm_mul_ps(_mm_set1_ps(abs(p.z)), ez));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+    }
+
+    int mask = _mm_movemask_ps(inside);
+    for (int k = 0; k < 4; k++) visible[i + k] = (mask >> k) & 1;
+  }
+  return i;
+}
+
+__attribute__((target("avx"))) static size_t cullAVX(const Frustum &f,
+                                                     const AabbBatch &b,
+                                                     size_t i,
+                                                     uint8_t *visible)
+{
+  const __m256 zero = _mm256_setzero_ps();
+  for (; i + 8 <= b.count; i += 8) {
+    __m256 cx = _mm256_loadu_ps(b.cx + i), cy = _mm256_loadu_ps(b.cy + i);
+    __m256 cz = _mm256_loadu_ps(b.cz + i);
+    __m256 ex = _mm256_loadu_ps(b.ex + i), ey = _mm256_loadu_ps(b.ey + i);
+    __m256 ez = _mm256_loadu_ps(b.ez + i);
+
+    __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+    for (const auto &p : f.planes) {
+      __m256 distance = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.x), cx),
+                        _mm256_mul_ps(_mm256_set1_ps(p.y), cy)),
+          _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.z), cz), _mm256_set1_ps(p.w)));
+      __m256 radius =
+          _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(abs(p.x)), ex),
+                                      _mm256_mul_ps(_mm256_set1_ps(abs(p.y)), ey)),
+                        _mm256_mul_ps(_mm256_set1_ps(abs(p.z)), ez));
+      inside = _mm256_and_ps(
+          inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+    }
+
+    int mask = _mm256_movemask_ps(inside);
+    for (int k = 0; k < 8; k++) visible[i + k] = (mask >> k) & 1;
+  }
+
+  // Leftovers are still enough for a round of SSE
+  return cullSSE(f, b, i, visible);
+}
+#endif
+
+static CullKernel pickKernel()
+{
+#ifdef SENG_CULL_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx")) return {"avx", cullAVX};
+  if (__builtin_cpu_supports("sse2")) return {"sse2", cullSSE};
+#endif
+  return {"scalar", cullScalar};
+}
+
+static const CullKernel &kernel()
+{
+  static const CullKernel k = pickKernel();
+  return k;
+}
+
+size_t seng::cullAabbs(const Frustum &frustum, const AabbBatch &batch, uint8_t *visible)
+{
+  size_t done = kernel().func(frustum, batch, 0, visible);
+  cullScalar(frustum, batch, done, visible);
+
+  size_t count = 0;
+  for (size_t i = 0; i < batch.count; i++) count += visible[i];
+  return count;
+}
+
+const char *seng::cullKernelName()
+{
+  return kernel().name;
+}
@@ -3,72 +3,178 @@
 #include <seng/components/mesh_renderer.hpp>
 #include <seng/components/transform.hpp>
 #include <seng/log.hpp>
+#include <seng/math.hpp>
 #include <seng/rendering/primitive_types.hpp>
+#include <seng/rendering/render_queue.hpp>
 #include <seng/rendering/renderer.hpp>
+#include <seng/resources/mesh.hpp>
+#include <seng/scene/compiled_scene.hpp>
 #include <seng/scene/entity.hpp>
+#include <seng/scene/frustum.hpp>
 #include <seng/scene/scene.hpp>
 #include <seng/yaml_utils.hpp>
 
 #include <yaml-cpp/yaml.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 #include <vulkan/vulkan_raii.hpp>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <filesystem>
+#include <functional>
+#include <initializer_list>
 #include <memory>
 #include <string>
+#include <system_error>
+#include <vector>
 
 using namespace seng;
 using namespace seng::rendering;
 using namespace std;
 
 Scene::Scene(Application &app) :
-    m_app(std::addressof(app)), m_renderer(app.renderer().get()), m_mainCamera(nullptr)
+    m_app(std::addressof(app)),
+    m_renderer(app.renderer().get()),
+    m_drawLayout(VertexLayout::eFull),
+    m_queue(*m_renderer),
+    m_scripts(app, m_transforms),
+    m_mainCamera(nullptr)
 {
   seng::log::dbg("Created new scene");
 }
 
-std::unique_ptr<Scene> Scene::loadFromDisk(Application &app, std::string sceneName)
+// Return the compiled version of the given scene, if there is a valid one that
+// is not older than its source
+static unique_ptr<CompiledScene> openCompiled(const filesystem::path &source,
+                                              const filesystem::path &compiled)
 {
+  error_code err;
+  if (!filesystem::exists(compiled, err)) return nullptr;
+
+  // A missing source has the minimum possible time
+  auto sourceTime = filesystem::last_write_time(source, err);
+  auto compiledTime = filesystem::last_write_time(compiled, err);
+  if (sourceTime > compiledTime) {
+    seng::log::info("Compiled scene {} is older than its source, ignoring it",
+                    compiled.string());
+    return nullptr;
+  }
+
+  try {
+    return make_unique<CompiledScene>(compiled.string());
+  } catch (const exception &e) {
+    seng::log::warning("Ignoring compiled scene: {}", e.what());
+    return nullptr;
+  }
+}
+
+std::unique_ptr<Scene> Scene::loadFromDisk(Application &app,
+                                           std::string sceneName,
+                                           std::function<void(float)> progress)
+{
+  Timestamp start = Clock::now();
   std::unique_ptr<Scene> s = std::make_unique<Scene>(app);
   auto &config = s->m_app->config();
 
-  // Parse config file
   filesystem::path scene{filesystem::path{config.scenePath} /
                          filesystem::path{sceneName + ".yml"}};
+  filesystem::path compiled{filesystem::path{config.scenePath} /
+                            filesystem::path{sceneName + ".sscene"}};
+
+  if (auto file = openCompiled(scene, compiled); file != nullptr) {
+    s->loadCompiled(*file, progress);
+  } else {
+    // Parse config file
+    YAML::Node sceneConfig;
+
+    try {
+      sceneConfig = YAML::LoadFile(scene.string());
+    } catch (exception &e) {
+      seng::log::error("Unable to load scene: {}", e.what());
+      return nullptr;
+    }
+    s->loadYaml(sceneConfig, progress);
+  }
 
-  YAML::Node sceneConfig;
-
-  try {
-    sceneConfig = YAML::LoadFile(scene.string());
-  } catch (exception &e) {
-    seng::log::error("Unable to load scene: {}", e.what());
-    return nullptr;
+  for (auto &e : s->m_entities) {
+    e.transform()->lateInit();
+    for (auto &cmpType : e.components()) {
+      for (auto &c : cmpType.second) c->lateInit();
+    }
   }
 
+  if (progress) progress(1.0f);
+  seng::log::dbg("Loaded scene {} ({} entities) in {}s", sceneName, s->m_entities.size(),
+                 inSeconds(Clock::now() - start));
+  return s;
+}
+
+void Scene::loadYaml(const YAML::Node &sceneConfig,
+                     const std::function<void(float)> &progress)
+{
   // Parse light
   if (sceneConfig["Light"] && sceneConfig["Light"].IsMap()) {
     auto light = sceneConfig["Light"];
     if (light["ambient"] && light["ambient"].IsSequence())
-      s->m_ambient = light["ambient"].as<glm::vec4>();
+      m_ambient = light["ambient"].as<glm::vec4>();
     if (light["color"] && light["color"].IsSequence())
-      s->m_directLight.color(light["color"].as<glm::vec4>());
+      m_directLight.color(light["color"].as<glm::vec4>());
     if (light["direction"] && light["direction"].IsSequence())
-      s->m_directLight.direction(light["direction"].as<glm::vec3>());
+      m_directLight.direction(light["direction"].as<glm::vec3>());
   }
 
-  // Load entities
+  // Load entities, late initialization counts as one more step
   if (sceneConfig["Entities"] && sceneConfig["Entities"].IsSequence()) {
     auto e = sceneConfig["Entities"];
-    for (YAML::const_iterator i = e.begin(); i != e.end(); ++i) s->parseEntity(*i);
+    float steps = e.size() + 1.0f;
+    size_t done = 0;
+    for (YAML::const_iterator i = e.begin(); i != e.end(); ++i) {
+      parseEntity(*i);
+      if (progress) progress(++done / steps);
+    }
   }
+}
 
-  for (auto &e : s->m_entities) {
-    e.transform()->lateInit();
-    for (auto &cmpType : e.components()) {
-      for (auto &c : cmpType.second) c->lateInit();
+void Scene::loadCompiled(const CompiledScene &file,
+                         const std::function<void(float)> &progress)
+{
+  const auto &header = file.header();
+  const float *a = header.ambient, *c = header.lightColor, *d = header.lightDirection;
+  if (header.lightFlags & sscene::eAmbient) m_ambient = glm::vec4(a[0], a[1], a[2], a[3]);
+  if (header.lightFlags & sscene::eColor)
+    m_directLight.color(glm::vec4(c[0], c[1], c[2], c[3]));
+  if (header.lightFlags & sscene::eDirection)
+    m_directLight.direction(glm::vec3(d[0], d[1], d[2]));
+
+  // Parents are referenced by index, so keep track of what we create
+  vector<Entity *> created;
+  created.reserve(file.entityCount());
+  float steps = file.entityCount() + 1.0f;
+
+  for (size_t i = 0; i < file.entityCount(); i++) {
+    const auto &rec = file.entity(i);
+    Transform *parent =
+        rec.parent == sscene::NO_PARENT ? nullptr : created[rec.parent]->transform();
+
+    auto it = insertEntity(std::string(file.string(rec.name)));
+    it->m_transform = makeComponent<Transform>(
+        *it, parent, glm::vec3(rec.position[0], rec.position[1], rec.position[2]),
+        glm::vec3(rec.scale[0], rec.scale[1], rec.scale[2]),
+        glm::vec3(rec.rotation[0], rec.rotation[1], rec.rotation[2]));
+    created.push_back(std::addressof(*it));
+
+    for (uint32_t j = 0; j < rec.componentCount; j++) {
+      const auto &comp = file.component(rec.firstComponent + j);
+      std::string id(file.string(comp.id));
+      auto ptr = SceneConfigComponentFactory::create(*it, id, file.node(comp.node));
+      it->untypedInsert(id, std::move(ptr));
     }
+    if (progress) progress((i + 1) / steps);
   }
-
-  return s;
 }
 
 void Scene::parseEntity(const YAML::Node &node)
@@ -105,42 +211,69 @@ void Scene::parseEntity(const YAML::Node &node)
 
 Scene::EntityList::const_iterator Scene::findByName(const std::string &name) const
 {
-  return std::find_if(m_entities.begin(), m_entities.end(),
-                      [&](const auto &elem) { return elem.name() == name; });
+  auto bucket = m_nameIndex.find(name);
+  if (bucket == m_nameIndex.end()) return m_entities.end();
+  return bucket->second.front();
 }
 
 Scene::EntityList::iterator Scene::findByName(const std::string &name)
 {
-  return std::find_if(m_entities.begin(), m_entities.end(),
-                      [&](const auto &elem) { return elem.name() == name; });
+  auto bucket = m_nameIndex.find(name);
+  if (bucket == m_nameIndex.end()) return m_entities.end();
+  return bucket->second.front();
 }
 
 std::vector<const Entity *> Scene::findAllByName(const std::string &name) const
 {
   vector<const Entity *> ptrs;
-  for (const auto &e : m_entities) {
-    if (e.name() == name) ptrs.push_back(std::addressof(e));
-  }
+  auto bucket = m_nameIndex.find(name);
+  if (bucket == m_nameIndex.end()) return ptrs;
+  ptrs.reserve(bucket->second.size());
+  for (const auto &it : bucket->second) ptrs.push_back(std::addressof(*it));
   return ptrs;
 }
 
 std::vector<Entity *> Scene::findAllByName(const std::string &name)
 {
   vector<Entity *> ptrs;
-  for (auto &e : m_entities) {
-    if (e.name() == name) ptrs.push_back(std::addressof(e));
-  }
+  auto bucket = m_nameIndex.find(name);
+  if (bucket == m_nameIndex.end()) return ptrs;
+  ptrs.reserve(bucket->second.size());
+  for (const auto &it : bucket->second) ptrs.push_back(std::addressof(*it));
   return ptrs;
 }
 
 Entity *Scene::newEntity(std::string name)
 {
-  m_entities.push_back(Entity(*m_app, *this, name));
-  return &m_entities.back();
+  auto it = insertEntity(std::move(name));
+  // Attach the transform only now that the entity has reached its final address
+  it->m_transform = makeComponent<Transform>(*it);
+  return std::addressof(*it);
+}
+
+Scene::EntityList::iterator Scene::insertEntity(std::string name)
+{
+  auto it = m_entities.insert(m_entities.end(), Entity(*m_app, *this, std::move(name)));
+  auto &bucket = m_nameIndex[it->name()];
+  auto byName = bucket.insert(bucket.end(), it);
+  m_idIndex.emplace(it->id(), IndexEntry{it, byName});
+  return it;
 }
 
 void Scene::removeEntity(EntityList::const_iterator i)
 {
+  if (auto proxy = m_proxies.find(i->id()); proxy != m_proxies.end()) {
+    m_spatialIndex.remove(proxy->second);
+    m_proxies.erase(proxy);
+  }
+
+  auto entry = m_idIndex.find(i->id());
+  if (entry != m_idIndex.end()) {
+    auto bucket = m_nameIndex.find(i->name());
+    bucket->second.erase(entry->second.byName);
+    if (bucket->second.empty()) m_nameIndex.erase(bucket);
+    m_idIndex.erase(entry);
+  }
   m_entities.erase(i);
 }
 
@@ -150,14 +283,14 @@ void Scene::removeEntity(const Entity *e)
     seng::log::warning("Tried to remove a null entity... Something is wrong");
     return;
   }
-  auto it = std::find(m_entities.begin(), m_entities.end(), *e);
-  if (it == m_entities.end()) {
+  auto entry = m_idIndex.find(e->id());
+  if (entry == m_idIndex.end()) {
     seng::log::warning(
         "Tried to remove an entity not registered in the scene graph... Something is "
         "wrong");
     return;
   }
-  this->removeEntity(it);
+  this->removeEntity(entry->second.entity);
 }
 
 void Scene::removeEntity(const string &name)
@@ -172,7 +305,12 @@ void Scene::removeEntity(const string &name)
 
 void Scene::removeAllEntities()
 {
-  m_entities.clear();
+  // One at a time, so that the indices only ever reference live entities while
+  // components are being destroyed
+  while (!m_entities.empty()) removeEntity(m_entities.cbegin());
+  m_spatialIndex.clear();
+  m_proxies.clear();
+  m_staleBounds.clear();
 }
 
 void Scene::mainCamera(Camera *cam)
@@ -193,18 +331,136 @@ HookRegistrar<const rendering::CommandBuffer &> &Scene::onShaderInstanceDraw(
   return m_renderers[instance].registrar();
 }
 
+// Insertions into the spatial index past which it is rebuilt
+static constexpr size_t REBUILD_THRESHOLD = 64;
+
+void Scene::updateSpatialIndex()
+{
+  size_t inserted = m_spatialIndex.size();
+  for (Transform *t : m_transforms.consumeMoved()) {
+    uint64_t id = t->attachedTo().id();
+    if (m_proxies.count(id) > 0) refitBounds(id);
+  }
+  for (uint64_t id : m_staleBounds) refitBounds(id);
+  m_staleBounds.clear();
+
+  // Inserting lots of entities at once, e.g. after loading, makes for a worse
+  // tree than building it in one go
+  inserted = m_spatialIndex.size() > inserted ? m_spatialIndex.size() - inserted : 0;
+  if (inserted > REBUILD_THRESHOLD && inserted * 2 > m_spatialIndex.size())
+    m_spatialIndex.rebuild();
+}
+
+void Scene::refitBounds(uint64_t id)
+{
+  auto entry = m_idIndex.find(id);
+  auto proxy = m_proxies.find(id);
+
+  // Bounds of all meshes, if the entity still exists
+  bool found = false;
+  Aabb bounds;
+  Entity *e = entry != m_idIndex.end() ? std::addressof(*entry->second.entity) : nullptr;
+  if (e != nullptr) {
+    glm::mat4 world = e->transform()->worldMartix();
+    for (const auto &ptr : e->componentsOfType<MeshRenderer>()) {
+      const Mesh &mesh = m_renderer->requestMesh(ptr.sureGet<MeshRenderer>()->meshName());
+      if (mesh.vertices().empty()) continue;
+      Aabb box = transformAabb(mesh.bounds(), world);
+      bounds = found ? bounds.merged(box) : box;
+      found = true;
+    }
+  }
+
+  if (!found) {
+    if (proxy == m_proxies.end()) return;
+    m_spatialIndex.remove(proxy->second);
+    m_proxies.erase(proxy);
+  } else if (proxy == m_proxies.end()) {
+    m_proxies.emplace(id, m_spatialIndex.insert(bounds, e));
+  } else {
+    m_spatialIndex.move(proxy->second, bounds);
+  }
+}
+
+void Scene::cull(const glm::mat4 &viewProjection)
+{
+  CullBatch &c = m_cull;
+  c.renderers.clear();
+  c.meshes.clear();
+  for (auto *v : {&c.cx, &c.cy, &c.cz, &c.ex, &c.ey, &c.ez}) v->clear();
+
+  // Gather the world space boxes of the renderers that would be drawn
+  view<MeshRenderer>().each([&](Entity &e, MeshRenderer &mr) {
+    if (!mr.enabled()) return;
+    Mesh &mesh = m_renderer->requestMesh(mr.meshName());
+    Aabb box = transformAabb(mesh.bounds(), e.transform()->worldMartix());
+    glm::vec3 center = box.center();
+    glm::vec3 extent = box.extent();
+    c.renderers.push_back(&mr);
+    c.meshes.push_back(&mesh);
+    c.cx.push_back(center.x);
+    c.cy.push_back(center.y);
+    c.cz.push_back(center.z);
+    c.ex.push_back(extent.x);
+    c.ey.push_back(extent.y);
+    c.ez.push_back(extent.z);
+  });
+
+  size_t count = c.renderers.size();
+  c.visible.resize(count);
+  AabbBatch batch{count,       c.cx.data(), c.cy.data(), c.cz.data(),
+                  c.ex.data(), c.ey.data(), c.ez.data()};
+  Frustum frustum = Frustum::fromMatrix(viewProjection);
+  size_t visible = cullAabbs(frustum, batch, c.visible.data());
+  for (size_t i = 0; i < count; i++) c.renderers[i]->visible(c.visible[i]);
+  m_cullStats = {visible, count - visible};
+}
+
+void Scene::enqueue(const glm::mat4 &view)
+{
+  const auto &instances = m_renderer->shaders().objectShaderInstances();
+  m_queue.clear();
+  for (size_t i = 0; i < m_cull.renderers.size(); i++) {
+    if (!m_cull.visible[i]) continue;
+    const MeshRenderer &mr = *m_cull.renderers[i];
+    Mesh &mesh = *m_cull.meshes[i];
+    if (mesh.vertices().empty()) continue;
+
+    auto instance = instances.find(mr.shaderInstanceName());
+    if (instance == instances.end()) continue;
+    if (!instance->second.instanceOf().supports(mesh.vertexLayout())) continue;
+    if (!mesh.synced()) mesh.sync();
+
+    // Draw with the last level of detail available, if the chosen one isn't
+    size_t lod = std::min(mr.lod(), mesh.lodCount() - 1);
+    const Entity &e = mr.attachedTo();
+    rendering::DrawItem item{std::addressof(instance->second), &mesh, lod,
+                             e.transform()->worldMartix(), mr.uvScale()};
+
+    // Depth of the center of the world space box computed while culling
+    glm::vec4 center(m_cull.cx[i], m_cull.cy[i], m_cull.cz[i], 1.0f);
+    m_queue.push(item, (view * center).z);
+  }
+  m_queue.sort();
+}
+
 void Scene::draw(const FrameHandle &handle)
 {
   const auto &cmd = m_renderer->getCommandBuffer(handle);
 
   if (m_mainCamera == nullptr) return;
 
+  glm::mat4 projection = m_mainCamera->projectionMatrix();
+  glm::mat4 viewMatrix = m_mainCamera->viewMatrix();
+  cull(projection * viewMatrix);
+  enqueue(viewMatrix);
+
   // Begin main render pass
   m_renderer->beginMainRenderPass(handle);
 
   // Update projection binding
-  m_renderer->globalUniform().projection().projection = m_mainCamera->projectionMatrix();
-  m_renderer->globalUniform().projection().view = m_mainCamera->viewMatrix();
+  m_renderer->globalUniform().projection().projection = projection;
+  m_renderer->globalUniform().projection().view = viewMatrix;
 
   // Update lighting binding
   m_renderer->globalUniform().lighting().ambientColor = m_ambient;
@@ -216,46 +472,67 @@ void Scene::draw(const FrameHandle &handle)
   // Push to device
   m_renderer->globalUniform().update(handle);
 
-  // For each pipeline
-  for (auto &shader : m_renderer->shaders().objectShaders()) {
-    // Bind said pipeline
-    shader.second.use(cmd);
+  m_renderStats = m_queue.record(handle, cmd);
+  drawHooks(handle);
 
-    // For each instance of that pipeline
-    for (auto instancePtr : shader.second.instances()) {
-      // Check if any MeshRenderers are using it
-      auto renderers = m_renderers.find(instancePtr->name());
-      if (renderers == m_renderers.end()) continue;
-      if (renderers->second.empty()) continue;
+  // End main render pass
+  m_renderer->endMainRenderPass(handle);
+}
 
-      // If there are any, bind the descriptors
-      instancePtr->bindDescriptorSets(handle, cmd);
+void Scene::drawHooks(const FrameHandle &handle)
+{
+  const auto &cmd = m_renderer->getCommandBuffer(handle);
 
-      // For each registered MeshRenderer, render it
-      renderers->second(cmd);
+  // For each pipeline, one for each supported vertex layout
+  for (auto &shader : m_renderer->shaders().objectShaders()) {
+    for (auto layout : {VertexLayout::eFull, VertexLayout::ePacked}) {
+      if (!shader.second.supports(layout)) continue;
+      bool bound = false;
+
+      // For each instance of that pipeline
+      for (auto instancePtr : shader.second.instances()) {
+        // Check if anyone is using it
+        auto renderers = m_renderers.find(instancePtr->name());
+        if (renderers == m_renderers.end()) continue;
+        if (renderers->second.empty()) continue;
+
+        // Bind said pipeline, if not done yet
+        if (!bound) {
+          shader.second.use(cmd, layout);
+          m_drawLayout = layout;
+          bound = true;
+        }
+
+        // If there are any, bind the descriptors and call them
+        instancePtr->bindDescriptorSets(handle, cmd);
+        renderers->second(cmd);
+      }
     }
   }
-
-  // End main render pass
-  m_renderer->endMainRenderPass(handle);
 }
 
 void Scene::update(Duration frameTime, const FrameHandle &handle)
 {
   float deltaTime = inSeconds(frameTime);
   m_earlyUpdate(deltaTime);
+  m_scripts.run(ScriptPhase::eEarlyUpdate, deltaTime);
 
   // Update
   m_update(deltaTime);
+  m_scripts.run(ScriptPhase::eUpdate, deltaTime);
+  m_transforms.update();
+  updateSpatialIndex();
   draw(handle);
 
   // Late update
   m_lateUpdate(deltaTime);
+  m_scripts.run(ScriptPhase::eLateUpdate, deltaTime);
 }
 
 Scene::~Scene()
 {
-  // Ensure that every operation relative to this scene has been completed
-  m_renderer->device().logical().waitIdle();
+  // Destroy entities while the indices are still alive, so that components can
+  // still query the scene graph during destruction (see removeAllEntities)
+  removeAllEntities();
   seng::log::dbg("Deallocated scene");
 }
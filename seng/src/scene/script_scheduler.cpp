@@ -0,0 +1,222 @@
+#include <seng/application.hpp>
+#include <seng/components/base_component.hpp>
+#include <seng/components/script.hpp>
+#include <seng/components/transform.hpp>
+#include <seng/jobs/job_system.hpp>
+#include <seng/log.hpp>
+#include <seng/scene/script_scheduler.hpp>
+#include <seng/scene/transform_system.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace seng;
+using namespace std;
+
+ScriptAccess &ScriptAccess::reads(const Transform *transform)
+{
+  readAncestors(transform);
+  return *this;
+}
+
+ScriptAccess &ScriptAccess::writes(const Transform *transform)
+{
+  if (transform == nullptr) return *this;
+
+  // Setters may look at the parents (e.g. lookAt) and invalidate the children
+  writeSubtree(transform);
+  readAncestors(transform->m_parent);
+  return *this;
+}
+
+ScriptAccess &ScriptAccess::reads(const BaseComponent *component)
+{
+  if (component != nullptr) m_reads.push_back(component);
+  return *this;
+}
+
+ScriptAccess &ScriptAccess::writes(const BaseComponent *component)
+{
+  if (component != nullptr) m_writes.push_back(component);
+  return *this;
+}
+
+// Transforms are keyed as components, so that declaring one either way is the same
+void ScriptAccess::readAncestors(const Transform *transform)
+{
+  for (auto t = transform; t != nullptr; t = t->m_parent)
+    m_reads.push_back(static_cast<const BaseComponent *>(t));
+}
+
+void ScriptAccess::writeSubtree(const Transform *transform)
+{
+  m_writes.push_back(static_cast<const BaseComponent *>(transform));
+  for (auto c : transform->m_children) writeSubtree(c);
+}
+
+void ScriptAccess::clear()
+{
+  m_reads.clear();
+  m_writes.clear();
+}
+
+ScriptScheduler::ScriptScheduler(Application &app, TransformSystem &transforms) :
+    m_app(std::addressof(app)), m_transforms(std::addressof(transforms))
+{
+}
+
+void ScriptScheduler::add(ScriptComponent *script)
+{
+  script->m_scriptIndex = m_scripts.size();
+  m_scripts.push_back(script);
+}
+
+void ScriptScheduler::remove(ScriptComponent *script)
+{
+  // Just leave a hole, so that indices held while running stay valid
+  m_scripts[script->m_scriptIndex] = nullptr;
+  m_holes++;
+}
+
+void ScriptScheduler::run(ScriptPhase phase, float deltaTime)
+{
+  if (m_running) {
+    seng::log::error("Scripts are already running, ignoring... Something is wrong");
+    return;
+  }
+  if (m_holes > 0) compact();
+  m_running = true;
+
+  // Scripts registered from now on will be run starting from the next phase
+  m_batchCount = 0;
+  m_serial.clear();
+  for (size_t i = 0; i < m_scripts.size(); i++) {
+    ScriptComponent *script = m_scripts[i];
+    if (script == nullptr || !script->enabled()) continue;
+
+    m_access.clear();
+    if (script->declareAccess(m_access)) {
+      // A script always writes its own state
+      m_access.writes(script);
+      schedule(i);
+    } else {
+      m_serial.push_back(i);
+    }
+  }
+
+  try {
+    for (size_t i = 0; i < m_batchCount; i++) runBatch(m_batches[i], phase, deltaTime);
+
+    // Undeclared scripts may add or remove other scripts, so check every time
+    for (size_t i : m_serial)
+      if (m_scripts[i] != nullptr) runScript(m_scripts[i], phase, deltaTime);
+  } catch (...) {
+    m_running = false;
+    throw;
+  }
+  m_running = false;
+}
+
+void ScriptScheduler::schedule(size_t index)
+{
+  // Place the script right after the last batch it conflicts with
+  size_t target = 0;
+  for (size_t b = m_batchCount; b > 0; b--) {
+    if (conflicts(m_batches[b - 1], m_access)) {
+      target = b;
+      break;
+    }
+  }
+
+  if (target == m_batchCount) {
+    if (m_batches.size() == m_batchCount) m_batches.emplace_back();
+    Batch &fresh = m_batches[m_batchCount++];
+    fresh.scripts.clear();
+    fresh.reads.clear();
+    fresh.writes.clear();
+  }
+
+  Batch &batch = m_batches[target];
+  batch.scripts.push_back(index);
+  batch.reads.insert(m_access.m_reads.begin(), m_access.m_reads.end());
+  batch.writes.insert(m_access.m_writes.begin(), m_access.m_writes.end());
+}
+
+bool ScriptScheduler::conflicts(const Batch &batch, const ScriptAccess &access)
+{
+  for (auto w : access.m_writes)
+    if (batch.writes.count(w) > 0 || batch.reads.count(w) > 0) return true;
+  for (auto r : access.m_reads)
+    if (batch.writes.count(r) > 0) return true;
+  return false;
+}
+
+void ScriptScheduler::runBatch(Batch &batch, ScriptPhase phase, float deltaTime)
+{
+  if (batch.scripts.size() == 1) {
+    runScript(m_scripts[batch.scripts[0]], phase, deltaTime);
+    return;
+  }
+
+  // No world matrix can be dirty while the batch runs, except the ones of the
+  // transforms being written, which belong to a single script
+  m_transforms->update();
+
+  // The job system swallows exceptions escaping jobs, so keep the first one
+  // thrown and rethrow it once the batch is over, like a serial script would.
+  // Scripts not started yet are skipped.
+  mutex errorMutex;
+  exception_ptr error;
+  atomic<bool> failed = false;
+
+  auto &jobs = m_app->jobs();
+  size_t grain = max<size_t>(1, batch.scripts.size() / (4 * (jobs->workerCount() + 1)));
+  jobs->parallelFor(0, batch.scripts.size(), grain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end && !failed; i++) {
+      try {
+        runScript(m_scripts[batch.scripts[i]], phase, deltaTime);
+      } catch (...) {
+        lock_guard lock(errorMutex);
+        if (!error) error = current_exception();
+        failed = true;
+      }
+    }
+  });
+  if (error) rethrow_exception(error);
+}
+
+void ScriptScheduler::runScript(ScriptComponent *script, ScriptPhase phase, float deltaTime)
+{
+  if (!script->enabled()) return;
+  switch (phase) {
+    case ScriptPhase::eEarlyUpdate:
+      script->onEarlyUpdate(deltaTime);
+      break;
+    case ScriptPhase::eUpdate:
+      script->onUpdate(deltaTime);
+      break;
+    case ScriptPhase::eLateUpdate:
+      script->onLateUpdate(deltaTime);
+      break;
+  }
+}
+
+void ScriptScheduler::compact()
+{
+  // Stable, to keep the registration order
+  size_t next = 0;
+  for (size_t i = 0; i < m_scripts.size(); i++) {
+    if (m_scripts[i] == nullptr) continue;
+    m_scripts[next] = m_scripts[i];
+    m_scripts[next]->m_scriptIndex = next;
+    next++;
+  }
+  m_scripts.resize(next);
+  m_holes = 0;
+}
@@ -0,0 +1,165 @@
+#include <seng/components/transform.hpp>
+#include <seng/scene/transform_system.hpp>
+#include <seng/scene/trs_kernel.hpp>
+
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using namespace seng;
+using namespace std;
+
+void TransformSystem::add(Transform &t)
+{
+  // Parents are always registered before their children, so appending keeps the
+  // arrays topologically sorted
+  t.m_index = static_cast<uint32_t>(m_nodes.size());
+  m_nodes.push_back(&t);
+  m_parents.push_back(t.m_parent != nullptr ? static_cast<int32_t>(t.m_parent->m_index)
+                                            : NO_PARENT);
+  m_world.emplace_back(1.0f);
+  m_dirty.push_back(1);
+  m_moved.push_back(0);
+}
+
+void TransformSystem::remove(Transform &t)
+{
+  uint32_t i = t.m_index;
+
+  // Children get reparented to our parent, which comes before us, so the order
+  // is still valid
+  for (auto c : t.m_children) {
+    m_parents[c->m_index] = m_parents[i];
+    markDirty(c->m_index);
+  }
+
+  // Leave a hole, to be compacted at the next update
+  m_nodes[i] = nullptr;
+  m_dirty[i] = 0;
+  m_moved[i] = 0;
+  m_holes++;
+}
+
+void TransformSystem::markDirty(uint32_t index)
+{
+  // A dirty transform always has all its descendants dirty, so we can stop here
+  if (m_dirty[index]) return;
+  m_dirty[index] = 1;
+  for (auto c : m_nodes[index]->m_children) markDirty(c->m_index);
+}
+
+const glm::mat4 &TransformSystem::worldMatrix(uint32_t index)
+{
+  if (m_dirty[index]) recompute(index);
+  return m_world[index];
+}
+
+void TransformSystem::recompute(uint32_t index)
+{
+  int32_t parent = m_parents[index];
+  if (parent == NO_PARENT) {
+    m_world[index] = m_nodes[index]->localMatrix();
+  } else {
+    if (m_dirty[parent]) recompute(parent);
+    m_world[index] = m_world[parent] * m_nodes[index]->localMatrix();
+  }
+  m_dirty[index] = 0;
+  m_moved[index] = 1;
+  m_nodes[index]->m_changes |= Transform::CHANGE_TRACKER;
+}
+
+void TransformSystem::update()
+{
+  if (m_holes > 0) compact();
+  composeLocals();
+
+  // Parents come first, so each dirty transform finds its parent already clean
+  for (size_t i = 0; i < m_nodes.size(); i++) {
+    if (m_dirty[i]) {
+      int32_t parent = m_parents[i];
+      if (parent == NO_PARENT)
+        m_world[i] = m_nodes[i]->localMatrix();
+      else
+        m_world[i] = m_world[parent] * m_nodes[i]->localMatrix();
+      m_dirty[i] = 0;
+      m_moved[i] = 1;
+      m_nodes[i]->m_changes |= Transform::CHANGE_TRACKER;
+    }
+  }
+}
+
+const vector<Transform *> &TransformSystem::consumeMoved()
+{
+  // Holes are never flagged, so there is no need to compact first
+  m_movedList.clear();
+  for (size_t i = 0; i < m_nodes.size(); i++) {
+    if (m_moved[i]) {
+      m_movedList.push_back(m_nodes[i]);
+      m_moved[i] = 0;
+    }
+  }
+  return m_movedList;
+}
+
+void TransformSystem::compact()
+{
+  // Stable compaction, so the topological order is preserved
+  vector<int32_t> remap(m_nodes.size(), NO_PARENT);
+  size_t next = 0;
+  for (size_t i = 0; i < m_nodes.size(); i++) {
+    if (m_nodes[i] == nullptr) continue;
+    remap[i] = static_cast<int32_t>(next);
+    m_nodes[next] = m_nodes[i];
+    m_parents[next] = m_parents[i] == NO_PARENT ? NO_PARENT : remap[m_parents[i]];
+    m_world[next] = m_world[i];
+    m_dirty[next] = m_dirty[i];
+    m_moved[next] = m_moved[i];
+    m_nodes[next]->m_index = static_cast<uint32_t>(next);
+    next++;
+  }
+  m_nodes.resize(next);
+  m_parents.resize(next);
+  m_world.resize(next);
+  m_dirty.resize(next);
+  m_moved.resize(next);
+  m_holes = 0;
+}
+
+void TransformSystem::composeLocals()
+{
+  m_stale.clear();
+  for (size_t i = 0; i < m_nodes.size(); i++)
+    if (m_dirty[i] && (m_nodes[i]->m_changes & Transform::LOCAL_CHANGES))
+      m_stale.push_back(static_cast<uint32_t>(i));
+  if (m_stale.empty()) return;
+
+  // Gather into SoA layout, one array per component
+  size_t n = m_stale.size();
+  m_trs.resize(10 * n);
+  float *p = m_trs.data();
+  TRSBatch batch{n,         p,         p + n,     p + 2 * n, p + 3 * n, p + 4 * n,
+                 p + 5 * n, p + 6 * n, p + 7 * n, p + 8 * n, p + 9 * n};
+  for (size_t k = 0; k < n; k++) {
+    const Transform &t = *m_nodes[m_stale[k]];
+    p[k] = t.m_pos.x;
+    p[n + k] = t.m_pos.y;
+    p[2 * n + k] = t.m_pos.z;
+    p[3 * n + k] = t.m_rotation.x;
+    p[4 * n + k] = t.m_rotation.y;
+    p[5 * n + k] = t.m_rotation.z;
+    p[6 * n + k] = t.m_rotation.w;
+    p[7 * n + k] = t.m_scale.x;
+    p[8 * n + k] = t.m_scale.y;
+    p[9 * n + k] = t.m_scale.z;
+  }
+
+  m_locals.resize(n);
+  composeTRS(batch, m_locals.data());
+
+  for (size_t k = 0; k < n; k++) {
+    const Transform &t = *m_nodes[m_stale[k]];
+    t.m_local = m_locals[k];
+    t.m_changes &= ~Transform::LOCAL_CHANGES;
+  }
+}
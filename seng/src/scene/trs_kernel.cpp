@@ -0,0 +1,234 @@
+#include <seng/scene/trs_kernel.hpp>
+
+#include <glm/mat4x4.hpp>
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SENG_TRS_X86
+#include <immintrin.h>
+#endif
+
+using namespace seng;
+using namespace std;
+
+// Processes batch elements starting from the given one, returns the index of
+// the first element left unprocessed
+using KernelFunc = size_t (*)(const TRSBatch &, size_t, glm::mat4 *);
+
+struct TRSKernel {
+  const char *name;
+  KernelFunc func;
+};
+
+// The formulas are the ones used by glm's normalize() and mat3_cast(), so that
+// the results match the ones computed by Transform::localMatrix()
+static size_t composeScalar(const TRSBatch &b, size_t i, glm::mat4 *out)
+{
+  for (; i < b.count; i++) {
+    float x = b.qx[i], y = b.qy[i], z = b.qz[i], w = b.qw[i];
+    float len = sqrt((w * w + x * x) + (y * y + z * z));
+    if (len <= 0.0f) {
+      x = y = z = 0.0f;
+      w = 1.0f;
+    } else {
+      float inv = 1.0f / len;
+      x *= inv;
+      y *= inv;
+      z *= inv;
+      w *= inv;
+    }
+
+    float xx = x * x, yy = y * y, zz = z * z;
+    float xy = x * y, xz = x * z, yz = y * z;
+    float wx = w * x, wy = w * y, wz = w * z;
+
+    glm::mat4 &m = out[i];
+    m[0][0] = (1.0f - 2.0f * (yy + zz)) * b.sx[i];
+    m[0][1] = (2.0f * (xy + wz)) * b.sx[i];
+    m[0][2] = (2.0f * (xz - wy)) * b.sx[i];
+    m[0][3] = 0.0f;
+    m[1][0] = (2.0f * (xy - wz)) * b.sy[i];
+    m[1][1] = (1.0f - 2.0f * (xx + zz)) * b.sy[i];
+    m[1][2] = (2.0f * (yz + wx)) * b.sy[i];
+    m[1][3] = 0.0f;
+    m[2][0] = (2.0f * (xz + wy)) * b.sz[i];
+    m[2][1] = (2.0f * (yz - wx)) * b.sz[i];
+    m[2][2] = (1.0f - 2.0f * (xx + yy)) * b.sz[i];
+    m[2][3] = 0.0f;
+    m[3][0] = b.px[i];
+    m[3][1] = b.py[i];
+    m[3][2] = b.pz[i];
+    m[3][3] = 1.0f;
+  }
+  return i;
+}
+
+#ifdef SENG_TRS_X86
+// Transposes the lanes of the given rows, i.e. the components of a matrix column,
+// and writes them as the column `col` of 4 consecutive matrices
+__attribute__((target("sse2"))) static inline void storeColumnSSE(
+    __m128 r0, __m128 r1, __m128 r2, __m128 r3, glm::mat4 *out, int col)
+{
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  _mm_storeu_ps(&out[0][col][0], r0);
+  _mm_storeu_ps(&out[1][col][0], r1);
+  _mm_storeu_ps(&out[2][col][0], r2);
+  _mm_storeu_ps(&out[3][col][0], r3);
+}
+
+__attribute__((target("sse2"))) static size_t composeSSE(const TRSBatch &b,
+                                                         size_t i,
+                                                         glm::mat4 *out)
+{
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+
+  for (; i + 4 <= b.count; i += 4) {
+    __m128 x = _mm_loadu_ps(b.qx + i);
+    __m128 y = _mm_loadu_ps(b.qy + i);
+    __m128 z = _mm_loadu_ps(b.qz + i);
+    __m128 w = _mm_loadu_ps(b.qw + i);
+
+    // Normalize, null quaternions become the identity
+    __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(w, w), _mm_mul_ps(x, x)),
+                                        _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(z, z))));
+    __m128 valid = _mm_cmpgt_ps(len, zero);
+    __m128 inv = _mm_div_ps(one, len);
+    x = _mm_and_ps(valid, _mm_mul_ps(x, inv));
+    y = _mm_and_ps(valid, _mm_mul_ps(y, inv));
+    z = _mm_and_ps(valid, _mm_mul_ps(z, inv));
+    w = _mm_or_ps(_mm_and_ps(valid, _mm_mul_ps(w, inv)), _mm_andnot_ps(valid, one));
+
+    __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+    __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+    __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+    __m128 sx = _mm_loadu_ps(b.sx + i);
+    __m128 sy = _mm_loadu_ps(b.sy + i);
+    __m128 sz = _mm_loadu_ps(b.sz + i);
+
+    storeColumnSSE(
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx), zero, out + i, 0);
+    storeColumnSSE(
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy), zero, out + i, 1);
+    storeColumnSSE(
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz), zero,
+        out + i, 2);
+    storeColumnSSE(_mm_loadu_ps(b.px + i), _mm_loadu_ps(b.py + i),
+                   _mm_loadu_ps(b.pz + i), one, out + i, 3);
+  }
+  return i;
+}
+
+// Same as storeColumnSSE, but for 8 matrices: the transpose is done independently
+// on each 128-bit half
+__attribute__((target("avx2"))) static inline void storeColumnAVX2(
+    __m256 r0, __m256 r1, __m256 r2, __m256 r3, glm::mat4 *out, int col)
+{
+  __m256d t0 = _mm256_castps_pd(_mm256_unpacklo_ps(r0, r1));
+  __m256d t1 = _mm256_castps_pd(_mm256_unpacklo_ps(r2, r3));
+  __m256d t2 = _mm256_castps_pd(_mm256_unpackhi_ps(r0, r1));
+  __m256d t3 = _mm256_castps_pd(_mm256_unpackhi_ps(r2, r3));
+
+  __m256 c[4] = {
+      _mm256_castpd_ps(_mm256_unpacklo_pd(t0, t1)),
+      _mm256_castpd_ps(_mm256_unpackhi_pd(t0, t1)),
+      _mm256_castpd_ps(_mm256_unpacklo_pd(t2, t3)),
+      _mm256_castpd_ps(_mm256_unpackhi_pd(t2, t3)),
+  };
+  for (int k = 0; k < 4; k++) {
+    _mm_storeu_ps(&out[k][col][0], _mm256_castps256_ps128(c[k]));
+    _mm_storeu_ps(&out[k + 4][col][0], _mm256_extractf128_ps(c[k], 1));
+  }
+}
+
+__attribute__((target("avx2"))) static size_t composeAVX2(const TRSBatch &b,
+                                                          size_t i,
+                                                          glm::mat4 *out)
+{
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 two = _mm256_set1_ps(2.0f);
+
+  for (; i + 8 <= b.count; i += 8) {
+    __m256 x = _mm256_loadu_ps(b.qx + i);
+    __m256 y = _mm256_loadu_ps(b.qy + i);
+    __m256 z = _mm256_loadu_ps(b.qz + i);
+    __m256 w = _mm256_loadu_ps(b.qw + i);
+
+    // Normalize, null quaternions become the identity
+    __m256 len = _mm256_sqrt_ps(
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(w, w), _mm256_mul_ps(x, x)),
+                      _mm256_add_ps(_mm256_mul_ps(y, y), _mm256_mul_ps(z, z))));
+    __m256 valid = _mm256_cmp_ps(len, zero, _CMP_GT_OQ);
+    __m256 inv = _mm256_div_ps(one, len);
+    x = _mm256_and_ps(valid, _mm256_mul_ps(x, inv));
+    y = _mm256_and_ps(valid, _mm256_mul_ps(y, inv));
+    z = _mm256_and_ps(valid, _mm256_mul_ps(z, inv));
+    w = _mm256_blendv_ps(one, _mm256_mul_ps(w, inv), valid);
+
+    __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+    __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+    __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+    __m256 sx = _mm256_loadu_ps(b.sx + i);
+    __m256 sy = _mm256_loadu_ps(b.sy + i);
+    __m256 sz = _mm256_loadu_ps(b.sz + i);
+
+    storeColumnAVX2(
+        _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx),
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx),
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx), zero, out + i, 0);
+    storeColumnAVX2(
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy),
+        _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy),
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy), zero, out + i, 1);
+    storeColumnAVX2(
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz),
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz),
+        _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz),
+        zero, out + i, 2);
+    storeColumnAVX2(_mm256_loadu_ps(b.px + i), _mm256_loadu_ps(b.py + i),
+                    _mm256_loadu_ps(b.pz + i), one, out + i, 3);
+  }
+
+  // Leftovers are still enough for a round of SSE
+  return composeSSE(b, i, out);
+}
+#endif
+
+static TRSKernel pickKernel()
+{
+#ifdef SENG_TRS_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return {"avx2", composeAVX2};
+  if (__builtin_cpu_supports("sse2")) return {"sse2", composeSSE};
+#endif
+  return {"scalar", composeScalar};
+}
+
+static const TRSKernel &kernel()
+{
+  static const TRSKernel k = pickKernel();
+  return k;
+}
+
+void seng::composeTRS(const TRSBatch &batch, glm::mat4 *out)
+{
+  size_t done = kernel().func(batch, 0, out);
+  composeScalar(batch, done, out);
+}
+
+const char *seng::trsKernelName()
+{
+  return kernel().name;
+}
@@ -1,12 +1,21 @@
 #include <seng/utils.hpp>
 
+#include <fcntl.h>
 #include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 using namespace std;
+using namespace seng::internal;
 
 vector<char> seng::internal::readFile(const string& filename)
 {
@@ -22,3 +31,56 @@ vector<char> seng::internal::readFile(const string& filename)
 
   return buffer;
 }
+
+MappedFile::MappedFile(const string &path)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw runtime_error("Unable to open " + path + ": " + strerror(errno));
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    int err = errno;
+    close(fd);
+    throw runtime_error("Unable to stat " + path + ": " + strerror(err));
+  }
+  m_size = info.st_size;
+
+  // Empty files can't be mapped
+  if (m_size == 0) {
+    close(fd);
+    return;
+  }
+  void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  int err = errno;
+  close(fd);  // the mapping keeps the file alive
+  if (data == MAP_FAILED)
+    throw runtime_error("Unable to map " + path + ": " + strerror(err));
+  m_data = static_cast<const char *>(data);
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept :
+    m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0))
+{
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+  swap(m_data, other.m_data);
+  swap(m_size, other.m_size);
+  return *this;
+}
+
+MappedFile::~MappedFile()
+{
+  if (m_data != nullptr) munmap(const_cast<char *>(m_data), m_size);
+}
+
+uint64_t seng::internal::fnv1a(const void *data, size_t size, uint64_t hash)
+{
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
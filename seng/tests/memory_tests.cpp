@@ -0,0 +1,92 @@
+#include <seng/application.hpp>
+#include <seng/rendering/device.hpp>
+#include <seng/rendering/geometry_arena.hpp>
+#include <seng/rendering/memory_allocator.hpp>
+#include <seng/rendering/renderer.hpp>
+
+#include "tests.hpp"
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+using namespace seng;
+using namespace seng::rendering;
+
+void tests::allocatorBlockReuse()
+{
+  ApplicationConfig config;
+  config.appName = "seng-tests";
+  config.scenePath = (scratchDir("allocator_block_reuse") / "scenes").string();
+  withApplication(config, [](Application &app) {
+    // An allocator of its own, so that the renderer's allocations don't count
+    MemoryAllocator allocator(app.renderer()->device());
+    auto flags = vk::MemoryPropertyFlagBits::eDeviceLocal;
+    auto request = [&](vk::DeviceSize size) {
+      vk::MemoryRequirements requirements{size, MemoryAllocator::MIN_ALLOCATION, ~0u};
+      return allocator.allocate(requirements, flags, true);
+    };
+
+    // Fill a block with its two halves, once its size is known
+    vector<MemoryAllocator::Allocation> full;
+    full.push_back(request(MemoryAllocator::MIN_ALLOCATION));
+    vk::DeviceSize half = allocator.stats().blockBytes / 2;
+    full.clear();
+    full.push_back(request(half));
+    full.push_back(request(half));
+    CHECK(allocator.stats().blocks == 1);
+    CHECK(allocator.stats().freeBytes() == 0);
+
+    // Transient allocations need a second block, which has to stay around once
+    // empty since the first one is full
+    for (int i = 0; i < 16; i++) {
+      {
+        auto transient = request(MemoryAllocator::MIN_ALLOCATION);
+        CHECK(allocator.stats().blocks == 2);
+      }
+      CHECK(allocator.stats().blocks == 2);
+    }
+
+    // Only one empty block of each kind is kept
+    full.clear();
+    CHECK(allocator.stats().blocks == 1);
+    app.stop();
+  });
+}
+
+void tests::geometryDeferredRelease()
+{
+  ApplicationConfig config;
+  config.appName = "seng-tests";
+  config.scenePath = (scratchDir("geometry_deferred_release") / "scenes").string();
+  withApplication(config, [](Application &app) {
+    GeometryArena &arena = app.renderer()->geometry();
+    static constexpr size_t COUNT = 1000;
+    static constexpr vk::DeviceSize BYTES = COUNT * sizeof(uint32_t);
+    auto collectAll = [&]() {
+      for (size_t i = 0; i < app.renderer()->framesInFlight(); i++) arena.collect();
+    };
+
+    // Nothing released by the renderer is pending from now on
+    collectAll();
+    auto first = arena.allocateIndices(vk::IndexType::eUint32, COUNT);
+    vk::DeviceSize offset = first.offset();
+    vk::DeviceSize used = arena.usedBytes();
+
+    // Frames in flight may still be drawing from a released slice, so it must
+    // not be handed out again...
+    first = nullptr;
+    CHECK(arena.usedBytes() == used);
+    auto second = arena.allocateIndices(vk::IndexType::eUint32, COUNT);
+    CHECK(second.offset() >= offset + BYTES || second.offset() + BYTES <= offset);
+
+    // ...until they have all completed
+    second = nullptr;
+    collectAll();
+    CHECK(arena.usedBytes() == used - BYTES);
+    app.stop();
+  });
+}
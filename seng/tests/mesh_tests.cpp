@@ -0,0 +1,97 @@
+#include <seng/application.hpp>
+#include <seng/rendering/primitive_types.hpp>
+#include <seng/rendering/renderer.hpp>
+#include <seng/resources/mesh.hpp>
+
+#include "tests.hpp"
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace seng;
+using namespace seng::rendering;
+
+// Indices of a strip of triangles over the vertices in [first, last)
+static void appendStrip(vector<uint32_t> &indices, uint32_t first, uint32_t last)
+{
+  for (uint32_t v = first; v + 2 < last; v++)
+    indices.insert(indices.end(), {v, v + 1, v + 2});
+}
+
+// Check that the ranges of each level cover it in order, with indices that fit
+// in 16 bits once the vertex offset is subtracted
+static void check16BitRanges(const Mesh &mesh)
+{
+  CHECK(mesh.indexType() == vk::IndexType::eUint16);
+  for (size_t l = 0; l < mesh.lodCount(); l++) {
+    uint32_t next = mesh.lods()[l].firstIndex;
+    for (const auto &range : mesh.indexRanges(l)) {
+      CHECK(range.firstIndex == next);
+      next += range.indexCount;
+      for (uint32_t i = range.firstIndex; i < next; i++) {
+        CHECK(mesh.indices()[i] >= static_cast<uint32_t>(range.vertexOffset));
+        CHECK(mesh.indices()[i] - range.vertexOffset <= UINT16_MAX);
+      }
+    }
+    CHECK(next == mesh.lods()[l].firstIndex + mesh.lods()[l].indexCount);
+  }
+}
+
+// Check that each level is drawn as a single range of 32 bit indices
+static void check32BitRanges(const Mesh &mesh)
+{
+  CHECK(mesh.indexType() == vk::IndexType::eUint32);
+  for (size_t l = 0; l < mesh.lodCount(); l++) {
+    const auto &ranges = mesh.indexRanges(l);
+    CHECK(ranges.size() == 1);
+    CHECK(ranges[0].firstIndex == mesh.lods()[l].firstIndex);
+    CHECK(ranges[0].indexCount == mesh.lods()[l].indexCount);
+    CHECK(ranges[0].vertexOffset == 0);
+  }
+}
+
+void tests::meshIndexRanges()
+{
+  ApplicationConfig config;
+  config.appName = "seng-tests";
+  config.scenePath = (scratchDir("mesh_index_ranges") / "scenes").string();
+  withApplication(config, [](Application &app) {
+    const Renderer &renderer = *app.renderer();
+    vector<Vertex> vertices(200'000);
+
+    // More than 2^16 vertices, but every triangle is narrow: several ranges
+    vector<uint32_t> strip;
+    appendStrip(strip, 0, 200'000);
+    Mesh split(renderer, vertices, strip);
+    check16BitRanges(split);
+    CHECK(split.indexRanges(0).size() > 1);
+
+    // A triangle wider than 2^16 vertices can't fit in any range, be it the
+    // first one of the mesh...
+    Mesh wideFirst(renderer, vertices, {0, 70'000, 1, 1, 2, 3});
+    check32BitRanges(wideFirst);
+
+    // ...one right after a split...
+    vector<uint32_t> wideAfterSplit;
+    appendStrip(wideAfterSplit, 0, 100'000);
+    wideAfterSplit.insert(wideAfterSplit.end(), {1'000, 90'000, 1'001});
+    Mesh wideMiddle(renderer, vertices, std::move(wideAfterSplit));
+    check32BitRanges(wideMiddle);
+
+    // ...or the first one of a level of detail other than the first
+    vector<uint32_t> lods = strip;
+    lods.insert(lods.end(), {0, 70'000, 1});
+    auto total = static_cast<uint32_t>(lods.size());
+    auto full = static_cast<uint32_t>(strip.size());
+    Mesh wideLod(renderer, vertices, std::move(lods), VertexLayout::eFull,
+                 {{0, full, 0.0f}, {full, total - full, 0.1f}});
+    check32BitRanges(wideLod);
+
+    app.stop();
+  });
+}
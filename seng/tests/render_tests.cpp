@@ -0,0 +1,120 @@
+#include <seng/application.hpp>
+#include <seng/components/definitions.hpp>
+#include <seng/components/scene_config_component_factory.hpp>
+#include <seng/components/script.hpp>
+#include <seng/rendering/render_queue.hpp>
+#include <seng/scene/entity.hpp>
+#include <seng/scene/scene.hpp>
+
+#include "tests.hpp"
+
+#include <fmt/core.h>
+#include <yaml-cpp/yaml.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace seng;
+namespace fs = std::filesystem;
+
+// Copies of the same mesh and shader instance in front of the camera
+static constexpr size_t COPIES = 5;
+
+// What recording the last frame took, read once the application has stopped
+static rendering::RenderQueue::Stats s_stats;
+
+// Run at the end of the frame, after the scene has been drawn: keeps the render
+// stats of the second frame, when everything has surely been loaded
+class RenderStatsProbe : public ScriptComponent,
+                         public ConfigParsableComponent<RenderStatsProbe> {
+ public:
+  RenderStatsProbe(Entity &entity, bool enabled) : ScriptComponent(entity, enabled) {}
+
+  DECLARE_COMPONENT_ID("RenderStatsProbe");
+  DECLARE_CREATE_FROM_CONFIG();
+
+  void onLateUpdate(float) override
+  {
+    if (++m_frames < 2) return;
+    s_stats = entity->scene().renderStats();
+    entity->application().stop();
+  }
+
+ private:
+  size_t m_frames = 0;
+};
+
+REGISTER_TO_CONFIG_FACTORY(RenderStatsProbe);
+
+DEFINE_CREATE_FROM_CONFIG(RenderStatsProbe, entity, node)
+{
+  bool enabled = true;
+  if (node["enabled"] && node["enabled"].IsScalar()) enabled = node["enabled"].as<bool>();
+  return makeComponent<RenderStatsProbe>(entity, enabled);
+}
+
+// Return the value of the given environment variable, which must be set
+static string requireEnv(const char *name)
+{
+  const char *value = std::getenv(name);
+  if (value == nullptr) throw runtime_error(fmt::format("{} is not set", name));
+  return value;
+}
+
+void tests::instancedDraws()
+{
+  // Stages compiled from froggo's shaders, and a texture from its assets
+  string shaders = requireEnv("SENG_TEST_SHADERS");
+  string assets = requireEnv("SENG_TEST_ASSETS");
+
+  fs::path dir = scratchDir("instanced_draws");
+  fs::create_directories(dir / "scenes");
+  ofstream(dir / "shaders.yml") << "Shaders:\n"
+                                   "  - name: diffuse\n"
+                                   "    vert: simple_vert\n"
+                                   "    packedVert: packed_vert\n"
+                                   "    frag: diffuse\n"
+                                   "    textureTypes: [2d]\n"
+                                   "Instances:\n"
+                                   "  - name: white\n"
+                                   "    instanceOf: diffuse\n"
+                                   "    textures: [white_1x1.png]\n";
+
+  ofstream scene(dir / "scenes" / "default.yml");
+  scene << "Entities:\n"
+           "  - name: camera\n"
+           "    components:\n"
+           "      - id: Camera\n"
+           "        main: true\n"
+           "      - id: RenderStatsProbe\n";
+  for (size_t i = 0; i < COPIES; i++)
+    scene << fmt::format("  - name: monkey_{}\n"
+                         "    transform:\n"
+                         "      position: [{}, 0, 10]\n"
+                         "    components:\n"
+                         "      - id: MeshRenderer\n"
+                         "        model: suzanne.obj\n"
+                         "        instance: white\n",
+                         i, 1.5f * i - 3.0f);
+  scene.close();
+
+  ApplicationConfig config;
+  config.appName = "seng-tests";
+  config.shaderDefinitions = (dir / "shaders.yml").string();
+  config.shaderPath = shaders;
+  config.assetPath = assets;
+  config.meshCachePath = "";
+  config.scenePath = (dir / "scenes").string();
+  s_stats = {};
+  withApplication(config, [](Application &) {});
+
+  // All copies in a single instanced draw, recorded as a single command
+  CHECK(s_stats.draws == 1);
+  CHECK(s_stats.instances == COPIES);
+  CHECK(s_stats.calls == 1);
+}
@@ -0,0 +1,152 @@
+#include <seng/application.hpp>
+#include <seng/components/definitions.hpp>
+#include <seng/components/scene_config_component_factory.hpp>
+#include <seng/components/script.hpp>
+#include <seng/components/transform.hpp>
+#include <seng/scene/aabb_tree.hpp>
+#include <seng/scene/entity.hpp>
+#include <seng/scene/scene.hpp>
+#include <seng/scene/script_scheduler.hpp>
+
+#include "tests.hpp"
+
+#include <yaml-cpp/yaml.h>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+using namespace seng;
+namespace fs = std::filesystem;
+
+// Frames run before checking the spatial index, and distance covered by the
+// movers in each of them (well past the tree's margin)
+static constexpr size_t FRAMES = 3;
+static constexpr float STEP = 10.0f;
+
+// Outcome of the last check, read once the application has stopped
+static size_t s_movers = 0;
+static size_t s_refitted = 0;
+
+// Moves its own transform every frame. Movers don't conflict with one another,
+// so they are run in parallel batches: the transforms are updated before each
+// of them, well before the scene refits the spatial index.
+class RefitMover : public ScriptComponent, public ConfigParsableComponent<RefitMover> {
+ public:
+  RefitMover(Entity &entity, bool enabled) : ScriptComponent(entity, enabled) {}
+
+  DECLARE_COMPONENT_ID("RefitMover");
+  DECLARE_CREATE_FROM_CONFIG();
+
+  void onEarlyUpdate(float) override
+  {
+    entity->transform()->translate(glm::vec3(STEP, 0.0f, 0.0f));
+  }
+  bool declareAccess(ScriptAccess &access) const override
+  {
+    access.writes(entity->transform());
+    return true;
+  }
+};
+
+REGISTER_TO_CONFIG_FACTORY(RefitMover);
+
+DEFINE_CREATE_FROM_CONFIG(RefitMover, entity, node)
+{
+  bool enabled = true;
+  if (node["enabled"] && node["enabled"].IsScalar()) enabled = node["enabled"].as<bool>();
+  return makeComponent<RefitMover>(entity, enabled);
+}
+
+// Run serially at the end of the frame, after the spatial index has been
+// updated: looks for the movers where they are now
+class RefitChecker : public ScriptComponent,
+                     public ConfigParsableComponent<RefitChecker> {
+ public:
+  RefitChecker(Entity &entity, bool enabled) : ScriptComponent(entity, enabled) {}
+
+  DECLARE_COMPONENT_ID("RefitChecker");
+  DECLARE_CREATE_FROM_CONFIG();
+
+  void onLateUpdate(float) override
+  {
+    if (++m_frames < FRAMES) return;
+
+    Scene &scene = entity->scene();
+    vector<Entity *> movers = scene.findAllByName("mover"), found;
+    s_movers = movers.size();
+    s_refitted = 0;
+    for (Entity *e : movers) {
+      found.clear();
+      scene.spatialIndex().query(e->transform()->position(), 0.1f, found);
+      if (std::find(found.begin(), found.end(), e) != found.end()) s_refitted++;
+    }
+    entity->application().stop();
+  }
+
+ private:
+  size_t m_frames = 0;
+};
+
+REGISTER_TO_CONFIG_FACTORY(RefitChecker);
+
+DEFINE_CREATE_FROM_CONFIG(RefitChecker, entity, node)
+{
+  bool enabled = true;
+  if (node["enabled"] && node["enabled"].IsScalar()) enabled = node["enabled"].as<bool>();
+  return makeComponent<RefitChecker>(entity, enabled);
+}
+
+// Write a unit cube centered in the origin
+static void writeCube(const fs::path &path)
+{
+  ofstream out(path);
+  for (int i = 0; i < 8; i++)
+    out << "v " << (i & 1 ? 0.5 : -0.5) << ' ' << (i & 2 ? 0.5 : -0.5) << ' '
+        << (i & 4 ? 0.5 : -0.5) << '\n';
+  out << "f 1 3 2\nf 2 3 4\nf 5 6 7\nf 6 8 7\nf 1 2 5\nf 2 6 5\n"
+      << "f 3 7 4\nf 4 7 8\nf 1 5 3\nf 3 5 7\nf 2 4 6\nf 4 8 6\n";
+}
+
+void tests::transformRefit()
+{
+  fs::path dir = scratchDir("transform_refit");
+  fs::create_directories(dir / "assets");
+  fs::create_directories(dir / "scenes");
+  writeCube(dir / "assets" / "cube.obj");
+
+  // Movers far apart, so that each query finds only the one being looked for
+  ofstream(dir / "scenes" / "default.yml") << "Entities:\n"
+                                              "  - name: mover\n"
+                                              "    transform:\n"
+                                              "      position: [0, 0, 0]\n"
+                                              "    components:\n"
+                                              "      - id: MeshRenderer\n"
+                                              "        model: cube.obj\n"
+                                              "      - id: RefitMover\n"
+                                              "  - name: mover\n"
+                                              "    transform:\n"
+                                              "      position: [0, 0, 100]\n"
+                                              "    components:\n"
+                                              "      - id: MeshRenderer\n"
+                                              "        model: cube.obj\n"
+                                              "      - id: RefitMover\n"
+                                              "  - name: checker\n"
+                                              "    components:\n"
+                                              "      - id: RefitChecker\n";
+
+  ApplicationConfig config;
+  config.appName = "seng-tests";
+  config.assetPath = (dir / "assets").string();
+  config.meshCachePath = "";
+  config.scenePath = (dir / "scenes").string();
+  s_movers = s_refitted = 0;
+  withApplication(config, [](Application &) {});
+
+  CHECK(s_movers == 2);
+  CHECK(s_refitted == s_movers);
+}
@@ -0,0 +1,94 @@
+#include <seng/application.hpp>
+#include <seng/log.hpp>
+
+#include "tests.hpp"
+
+#include <fmt/core.h>
+
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <utility>
+
+using namespace std;
+using namespace seng;
+namespace fs = std::filesystem;
+
+struct Test {
+  const char *name;
+  void (*run)();
+};
+
+static const Test TESTS[] = {
+    {"allocator_block_reuse", tests::allocatorBlockReuse},
+    {"geometry_deferred_release", tests::geometryDeferredRelease},
+    {"instanced_draws", tests::instancedDraws},
+    {"mesh_index_ranges", tests::meshIndexRanges},
+    {"transform_refit", tests::transformRefit},
+};
+
+fs::path tests::scratchDir(const std::string &test)
+{
+  fs::path dir = fs::temp_directory_path() / ("seng-tests-" + test);
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  return dir;
+}
+
+void tests::withApplication(ApplicationConfig config,
+                            const std::function<void(Application &)> &f)
+{
+  fs::path defaultScene = fs::path{config.scenePath} / "default.yml";
+  if (!fs::exists(defaultScene)) {
+    fs::create_directories(config.scenePath);
+    ofstream(defaultScene) << "Entities: []\n";
+  }
+
+  Application app(std::move(config));
+  bool called = false;
+  exception_ptr error;
+
+  // Progress of the first scene is reported on the main thread, once the
+  // renderer is up
+  app.onSceneLoadProgress().insert([&](const std::string &, float) {
+    if (called) return;
+    called = true;
+    try {
+      f(app);
+    } catch (...) {
+      error = current_exception();
+      app.stop();
+    }
+  });
+  app.run(640, 480);
+  if (error) rethrow_exception(error);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *env = std::getenv("SENG_VERBOSE");
+  if (env == nullptr) seng::log::minimumLoggingLevel(seng::log::LogLevels::WARN);
+
+  bool found = false, failed = false;
+  for (const auto &test : TESTS) {
+    if (argc >= 2 && argv[1] != string(test.name)) continue;
+    found = true;
+    try {
+      test.run();
+      fmt::print("PASS {}\n", test.name);
+    } catch (const exception &e) {
+      fmt::print("FAIL {}: {}\n", test.name, e.what());
+      failed = true;
+    }
+  }
+
+  if (!found) {
+    seng::log::error("Usage: {} [<test>]", argv[0]);
+    for (const auto &test : TESTS) seng::log::error("  test: {}", test.name);
+    return EXIT_FAILURE;
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <seng/application_config.hpp>
+
+#include <fmt/core.h>
+
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+namespace seng {
+class Application;
+}
+
+/**
+ * Checks of the engine's behaviour, run by name with `seng-tests <test>` (or all
+ * of them, without arguments) and registered to CTest one by one.
+ *
+ * Like the benchmarks, tests that need the engine's objects start an
+ * Application, so they need a display and a Vulkan device.
+ */
+namespace seng::tests {
+
+/// Thrown by CHECK when its condition does not hold
+class Failure : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+/// Fail the current test if `cond` does not hold
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond))                                                        \
+      throw seng::tests::Failure(                                       \
+          fmt::format("{}:{}: {}", __FILE__, __LINE__, #cond));         \
+  } while (0)
+
+/// Return an empty directory for the given test, inside the temporary directory
+std::filesystem::path scratchDir(const std::string &test);
+
+/**
+ * Start an Application with the given configuration and call `f` on its main
+ * thread once the renderer is up. The application keeps running until `f`, or
+ * something it set up, stops it; if there is no `default` scene in the
+ * configured scene path, an empty one is created.
+ *
+ * Exceptions thrown by `f` are rethrown once the application has stopped.
+ */
+void withApplication(ApplicationConfig config,
+                     const std::function<void(Application &)> &f);
+
+// Tests
+void allocatorBlockReuse();
+void geometryDeferredRelease();
+void instancedDraws();
+void meshIndexRanges();
+void transformRefit();
+
+}  // namespace seng::tests
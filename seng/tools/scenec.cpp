@@ -0,0 +1,52 @@
+#include <seng/log.hpp>
+#include <seng/scene/compiled_scene.hpp>
+#include <seng/time.hpp>
+
+#include <yaml-cpp/yaml.h>
+
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Compile a scene YAML into a `.sscene` that Scene::loadFromDisk can map
+// directly. See `seng/scene/compiled_scene.hpp` for the format.
+int main(int argc, char *argv[])
+{
+  if (argc < 2 || argc > 3) {
+    seng::log::error("Usage: {} <scene.yml> [<output.sscene>]", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  fs::path input{argv[1]};
+  fs::path output{input};
+  if (argc == 3)
+    output = fs::path{argv[2]};
+  else
+    output.replace_extension(".sscene");
+
+  try {
+    seng::Timestamp start = seng::Clock::now();
+    YAML::Node scene = YAML::LoadFile(input.string());
+
+    ofstream out(output, ios::binary | ios::trunc);
+    if (!out) throw runtime_error("unable to open " + output.string());
+    seng::compileScene(scene, out);
+    out.close();
+    if (!out) throw runtime_error("unable to write " + output.string());
+
+    seng::log::info("Compiled {} into {} in {}s", input.string(), output.string(),
+                    seng::inSeconds(seng::Clock::now() - start));
+    return EXIT_SUCCESS;
+  } catch (const exception &e) {
+    seng::log::error("Unable to compile {}: {}", input.string(), e.what());
+    // Don't leave a partial file around, the engine would try to load it
+    error_code err;
+    fs::remove(output, err);
+    return EXIT_FAILURE;
+  }
+}